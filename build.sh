@@ -4,6 +4,6 @@ FFMPEG_BASEDIR=./ffmpeg/
 rm -rf lib
 mkdir lib
 
-gcc ffmpeg_fas.c seek_indices.c -Iffmpeg ffmpeg/libavformat/libavformat.a ffmpeg/libavcodec/libavcodec.a ffmpeg/libavutil/libavutil.a -O2 -shared -o lib/libffmpeg_fas.so
-gcc -c ffmpeg_fas.c seek_indices.c -O2 -I$FFMPEG_BASEDIR
-ar rc lib/libffmpeg_fas.a ffmpeg_fas.o seek_indices.o
+gcc ffmpeg_fas.c seek_indices.c seek_cache.c seek_builder.c frame_cache.c image_pool.c pixel_kernels.c decode_pool.c parallel_decode.c custom_io.c -Iffmpeg ffmpeg/libavformat/libavformat.a ffmpeg/libavcodec/libavcodec.a ffmpeg/libswscale/libswscale.a ffmpeg/libavutil/libavutil.a -O2 -shared -lpthread -o lib/libffmpeg_fas.so
+gcc -c ffmpeg_fas.c seek_indices.c seek_cache.c seek_builder.c frame_cache.c image_pool.c pixel_kernels.c decode_pool.c parallel_decode.c custom_io.c -O2 -I$FFMPEG_BASEDIR
+ar rc lib/libffmpeg_fas.a ffmpeg_fas.o seek_indices.o seek_cache.o seek_builder.o frame_cache.o image_pool.o pixel_kernels.o decode_pool.o parallel_decode.o custom_io.o
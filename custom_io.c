@@ -0,0 +1,268 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ *
+ * This file is part of the Frame Accurate Seeking extension library to
+ * ffmpeg (ffmpeg-fas).
+ *
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "custom_io.h"
+
+#if defined( _WIN32 ) && defined( STATIC_DLL )
+extern "C" 
+{
+#include "libavformat/avformat.h"
+}
+#else
+#include "libavformat/avformat.h"
+#endif /*  _WIN32 && STATIC_DLL */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DEFAULT_BUFFER_SIZE   32768
+#define PROBE_SIZE            2048     // read once to guess the format, then replayed
+
+/**** Private Types ***********************************************************/
+
+struct custom_io_struct
+{
+  fas_custom_io_type  io;
+  ByteIOContext      *pb;
+  unsigned char      *probe;           // the first probe_size bytes of the input
+  int                 probe_size;
+  int64_t             size;            // < 0 if unknown
+  int64_t             position;        // of the next byte the demuxer gets
+  int64_t             source_position; // of the next byte the read callback gives
+};
+
+static int     private_read        (void *opaque, uint8_t *buffer, int buffer_size);
+static int64_t private_seek        (void *opaque, int64_t offset, int whence);
+static int     private_read_source (custom_io_type *custom_io, uint8_t *buffer, int buffer_size);
+static void    private_free        (custom_io_type *custom_io);
+
+
+/* custom_io_open */
+
+fas_error_type custom_io_open (const fas_custom_io_type *io, AVFormatContext **format_context_ptr, custom_io_type **custom_io_ptr)
+{
+  custom_io_type *custom_io;
+  AVInputFormat  *format;
+  AVProbeData     probe_data;
+  unsigned char  *buffer;
+  int             buffer_size;
+  int             seekable;
+
+  *custom_io_ptr = NULL;
+
+  if (NULL == io->data && NULL == io->read)
+    return FAS_INVALID_ARGUMENT;
+
+  custom_io = (custom_io_type *) calloc (1, sizeof (custom_io_type));
+  if (NULL == custom_io)
+    return FAS_OUT_OF_MEMORY;
+
+  custom_io->io   = *io;
+  custom_io->size = io->data ? io->data_size : (io->size ? io->size (io->opaque) : -1);
+
+  /* the probe buffer stays around to be replayed; probing wants zeroed padding after the data */
+  custom_io->probe = (unsigned char *) av_mallocz (PROBE_SIZE + AVPROBE_PADDING_SIZE);
+  if (NULL == custom_io->probe)
+    {
+      private_free (custom_io);
+      return FAS_OUT_OF_MEMORY;
+    }
+
+  while (custom_io->probe_size < PROBE_SIZE)
+    {
+      int n = private_read_source (custom_io, custom_io->probe + custom_io->probe_size, PROBE_SIZE - custom_io->probe_size);
+      if (n <= 0)
+	break;
+      custom_io->probe_size += n;
+      custom_io->position   += n;
+    }
+  custom_io->position = 0;
+
+  if (custom_io->probe_size == 0)
+    {
+      private_free (custom_io);
+      return FAS_UNSUPPORTED_FORMAT;
+    }
+
+  probe_data.filename = io->name ? io->name : "";
+  probe_data.buf      = custom_io->probe;
+  probe_data.buf_size = custom_io->probe_size;
+
+  /* formats that open files of their own (image sequences) cannot read from a stream */
+  format = av_probe_input_format (&probe_data, 1);
+  if (NULL == format || (format->flags & AVFMT_NOFILE))
+    {
+      private_free (custom_io);
+      return FAS_UNSUPPORTED_FORMAT;
+    }
+
+  buffer_size = io->buffer_size > 0 ? io->buffer_size : DEFAULT_BUFFER_SIZE;
+  buffer = (unsigned char *) av_malloc (buffer_size);
+  if (NULL == buffer)
+    {
+      private_free (custom_io);
+      return FAS_OUT_OF_MEMORY;
+    }
+
+  seekable = (NULL != io->data || NULL != io->seek);
+  custom_io->pb = av_alloc_put_byte (buffer, buffer_size, 0, custom_io, private_read, NULL, seekable ? private_seek : NULL);
+  if (NULL == custom_io->pb)
+    {
+      av_free (buffer);
+      private_free (custom_io);
+      return FAS_OUT_OF_MEMORY;
+    }
+  custom_io->pb->is_streamed = !seekable;
+
+  if (av_open_input_stream (format_context_ptr, custom_io->pb, probe_data.filename, format, NULL) != 0)
+    {
+      private_free (custom_io);
+      return FAS_UNSUPPORTED_FORMAT;
+    }
+
+  *custom_io_ptr = custom_io;
+  return FAS_SUCCESS;
+}
+
+/* custom_io_close */
+
+void custom_io_close (AVFormatContext *format_context, custom_io_type *custom_io)
+{
+  /* unlike av_close_input_file, this leaves the ByteIOContext to its owner */
+  if (format_context)
+    av_close_input_stream (format_context);
+
+  if (custom_io)
+    private_free (custom_io);
+}
+
+/* custom_io_source */
+
+const fas_custom_io_type *custom_io_source (custom_io_type *custom_io)
+{
+  return &custom_io->io;
+}
+
+
+/* private_read */
+
+static int private_read (void *opaque, uint8_t *buffer, int buffer_size)
+{
+  custom_io_type *custom_io = (custom_io_type *) opaque;
+  int n;
+
+  if (custom_io->position < custom_io->probe_size)
+    {
+      n = custom_io->probe_size - (int) custom_io->position;
+      if (n > buffer_size)
+	n = buffer_size;
+      memcpy (buffer, custom_io->probe + custom_io->position, n);
+    }
+  else
+    n = private_read_source (custom_io, buffer, buffer_size);
+
+  if (n > 0)
+    custom_io->position += n;
+
+  return n;
+}
+
+/* private_seek */
+
+static int64_t private_seek (void *opaque, int64_t offset, int whence)
+{
+  custom_io_type *custom_io = (custom_io_type *) opaque;
+  int64_t target;
+
+  /* the source only moves on the next read, and not at all for the probed bytes */
+  switch (whence)
+    {
+    case AVSEEK_SIZE:
+      return custom_io->size;
+    case SEEK_SET:
+      target = offset;
+      break;
+    case SEEK_CUR:
+      target = custom_io->position + offset;
+      break;
+    case SEEK_END:
+      if (custom_io->size < 0)
+	return -1;
+      target = custom_io->size + offset;
+      break;
+    default:
+      return -1;
+    }
+
+  if (target < 0)
+    return -1;
+
+  custom_io->position = target;
+  return target;
+}
+
+/* private_read_source */
+
+static int private_read_source (custom_io_type *custom_io, uint8_t *buffer, int buffer_size)
+{
+  fas_custom_io_type *io = &custom_io->io;
+  int n;
+
+  if (io->data)
+    {
+      if (custom_io->position >= io->data_size)
+	return 0;
+      n = (io->data_size - custom_io->position < buffer_size) ? (int) (io->data_size - custom_io->position) : buffer_size;
+      memcpy (buffer, io->data + custom_io->position, n);
+      return n;
+    }
+
+  if (custom_io->source_position != custom_io->position)
+    {
+      if (NULL == io->seek || io->seek (io->opaque, custom_io->position, SEEK_SET) < 0)
+	return -1;
+      custom_io->source_position = custom_io->position;
+    }
+
+  n = io->read (io->opaque, buffer, buffer_size);
+  if (n > 0)
+    custom_io->source_position += n;
+
+  return n;
+}
+
+/* private_free */
+
+static void private_free (custom_io_type *custom_io)
+{
+  if (custom_io->pb)
+    {
+      av_free (custom_io->pb->buffer);
+      av_free (custom_io->pb);
+    }
+
+  if (custom_io->probe)
+    av_free (custom_io->probe);
+
+  free (custom_io);
+}
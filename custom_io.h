@@ -0,0 +1,61 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+
+#ifndef FAS_CUSTOM_IO_H
+#define FAS_CUSTOM_IO_H
+
+#include "ffmpeg_fas.h"
+
+/* If C++ then we need to __extern "C". Compiler defines __cplusplus */
+#ifdef __cplusplus
+#define __extern extern "C"
+#else
+#define __extern extern
+#endif
+
+
+/**********************************************************************
+ * Custom Input
+ *
+ * Demuxers reading from a memory buffer or the caller's callbacks
+ * (see fas_custom_io_type) instead of a file. The first bytes are
+ * read once to probe the format and then replayed to the demuxer, so
+ * inputs that cannot seek still open; inputs that can keep frame
+ * accurate seeking.
+ **********************************************************************/
+
+typedef struct custom_io_struct custom_io_type;
+
+struct AVFormatContext;
+
+/* opens a demuxer on io (which is copied; memory data is not). on success *format_context_ptr
+   is ready for av_find_stream_info and *custom_io_ptr owns its input */
+__extern fas_error_type custom_io_open  (const fas_custom_io_type *io, struct AVFormatContext **format_context_ptr,
+					 custom_io_type **custom_io_ptr);
+
+/* closes the demuxer (NULL if it was never opened) and frees the input */
+__extern void           custom_io_close (struct AVFormatContext *format_context, custom_io_type *custom_io);
+
+/* the io given to custom_io_open, for opening the same input again */
+__extern const fas_custom_io_type *custom_io_source (custom_io_type *custom_io);
+
+#endif
@@ -0,0 +1,770 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ *
+ * This file is part of the Frame Accurate Seeking extension library to
+ * ffmpeg (ffmpeg-fas).
+ *
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "private_errors.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#define CHUNK_FRAMES          250    // jobs are cut into chunks of at least this many frames
+#define INITIAL_QUEUE_SIZE    16
+
+/**** Private Types ***********************************************************/
+
+/* a submitted job. its tasks share it until the last one finishes */
+typedef struct
+{
+  fas_pool_job_type  spec;
+  int               *indices;         // sorted copy of spec.indices, NULL for a frame range
+  seek_table_type    table;           // for cutting the job and seeking in it; num_entries 0 if none
+  int                pending;         // tasks queued or running (pool lock)
+  fas_error_type     error;           // first failure (pool lock)
+} pool_job_type;
+
+/* split tasks look at a job for the first time and may cut it into run tasks. a run task covers
+   frames first to last, or for index sets indices[first] to indices[last] */
+typedef struct
+{
+  pool_job_type    *job;
+  fas_boolean_type  split;
+  int               first;
+  int               last;
+} pool_task_type;
+
+/* the owner pushes and pops at the back, thieves take from the front */
+typedef struct
+{
+  pthread_mutex_t   lock;
+  pool_task_type   *tasks;            // ring of size entries
+  int               head;
+  int               count;
+  int               size;
+} pool_queue_type;
+
+typedef struct
+{
+  struct fas_pool_struct *pool;
+  int                     id;
+  pool_queue_type         queue;
+  pthread_t               thread;
+  fas_boolean_type        started;
+  fas_context_ref_type    context;    // kept open for the next task of the same file
+  char                   *context_path;
+} pool_worker_type;
+
+struct fas_pool_struct
+{
+  pool_worker_type     *workers;
+  int                   n_workers;
+  fas_open_options_type options;
+
+  pthread_mutex_t       lock;
+  pthread_cond_t        work_ready;   // tasks queued, or shutting down
+  pthread_cond_t        jobs_done;    // no jobs outstanding
+  int                   queued;       // tasks in all queues
+  int                   jobs;         // submitted and not yet done
+  int                   next_worker;  // queue the next submission goes to
+  fas_boolean_type      shutdown;
+  fas_error_type        error;        // first job failure since the last fas_pool_wait
+  fas_pool_stats_type   stats;
+};
+
+static fas_error_type   private_show_error (const char *message, fas_error_type error);
+static fas_boolean_type private_push (pool_queue_type *queue, pool_task_type task);
+static fas_boolean_type private_pop (pool_queue_type *queue, pool_task_type *task, fas_boolean_type from_front);
+static void             private_queue_task (fas_pool_ref_type pool, pool_worker_type *worker, pool_task_type task);
+static fas_boolean_type private_next_task (pool_worker_type *worker, pool_task_type *task);
+static void            *private_run_worker (void *worker_ptr);
+static fas_error_type   private_open_context (pool_worker_type *worker, pool_job_type *job);
+static fas_error_type   private_split_job (pool_worker_type *worker, pool_job_type *job);
+static fas_error_type   private_run_whole (pool_worker_type *worker, pool_task_type whole);
+static fas_error_type   private_run_task (pool_worker_type *worker, pool_task_type *task);
+static fas_error_type   private_deliver (fas_context_ref_type context, pool_job_type *job);
+static void             private_finish_task (fas_pool_ref_type pool, pool_job_type *job, fas_error_type error, int new_tasks);
+static void             private_close_context (pool_worker_type *worker);
+static int              private_compare_ints (const void *a, const void *b);
+
+
+/* fas_pool_create */
+
+fas_error_type fas_pool_create (fas_pool_ref_type *pool_ptr, int n_workers, fas_open_options_type options)
+{
+  fas_pool_ref_type pool;
+  int i;
+
+  if (NULL == pool_ptr)
+    return private_show_error ("NULL pool pointer provided", FAS_INVALID_ARGUMENT);
+
+  *pool_ptr = NULL;
+
+  if (n_workers < 1)
+    return private_show_error ("a pool needs at least one worker", FAS_INVALID_ARGUMENT);
+
+  pool = (fas_pool_ref_type) calloc (1, sizeof (struct fas_pool_struct));
+  if (NULL == pool)
+    return private_show_error ("unable to allocate pool", FAS_OUT_OF_MEMORY);
+
+  pool->workers = (pool_worker_type *) calloc (n_workers, sizeof (pool_worker_type));
+  if (NULL == pool->workers)
+    {
+      free (pool);
+      return private_show_error ("unable to allocate pool workers", FAS_OUT_OF_MEMORY);
+    }
+
+  /* tables given to fas_put_seek_table must come from the same options; packet tables match
+     contexts decoding on one thread */
+  pool->options              = options;
+  pool->options.thread_count = 1;
+  pool->options.read_ahead   = 0;
+  pool->n_workers            = n_workers;
+  pool->error                = FAS_SUCCESS;
+
+  pthread_mutex_init (&pool->lock, NULL);
+  pthread_cond_init (&pool->work_ready, NULL);
+  pthread_cond_init (&pool->jobs_done, NULL);
+
+  for (i=0;i<n_workers;i++)
+    {
+      pool->workers[i].pool = pool;
+      pool->workers[i].id   = i;
+      pthread_mutex_init (&pool->workers[i].queue.lock, NULL);
+    }
+
+  for (i=0;i<n_workers;i++)
+    {
+      pool->workers[i].started = (pthread_create (&pool->workers[i].thread, NULL, private_run_worker, &pool->workers[i]) == 0)
+	? FAS_TRUE : FAS_FALSE;
+
+      if (!pool->workers[i].started)
+	{
+	  fas_pool_destroy (pool);
+	  return private_show_error ("unable to start pool worker", FAS_FAILURE);
+	}
+    }
+
+  *pool_ptr = pool;
+  return FAS_SUCCESS;
+}
+
+/* fas_pool_submit */
+
+fas_error_type fas_pool_submit (fas_pool_ref_type pool, const fas_pool_job_type *job_spec)
+{
+  pool_job_type *job;
+  pool_task_type task;
+  int i;
+
+  if (NULL == pool || NULL == job_spec || NULL == job_spec->file_path || NULL == job_spec->callback)
+    return private_show_error ("NULL pool, job, file path or callback", FAS_INVALID_ARGUMENT);
+
+  if (NULL != job_spec->indices)
+    {
+      if (job_spec->n_indices < 1)
+	return private_show_error ("empty index set", FAS_INVALID_ARGUMENT);
+      for (i=0;i<job_spec->n_indices;i++)
+	if (job_spec->indices[i] < 0)
+	  return private_show_error ("negative frame index", FAS_INVALID_ARGUMENT);
+    }
+  else if (job_spec->first_frame < 0 || (job_spec->last_frame != -1 && job_spec->last_frame < job_spec->first_frame))
+    return private_show_error ("invalid frame range", FAS_INVALID_ARGUMENT);
+
+  job = (pool_job_type *) calloc (1, sizeof (pool_job_type));
+  if (NULL == job)
+    return private_show_error ("unable to allocate job", FAS_OUT_OF_MEMORY);
+
+  job->spec      = *job_spec;
+  job->error     = FAS_SUCCESS;
+  job->pending   = 1;
+  job->spec.file_path = (char *) malloc (strlen (job_spec->file_path) + 1);
+  if (NULL != job->spec.file_path)
+    strcpy (job->spec.file_path, job_spec->file_path);
+
+  if (NULL != job_spec->indices)
+    {
+      job->indices = (int *) malloc (job_spec->n_indices * sizeof (int));
+      if (NULL != job->indices)
+	{
+	  memcpy (job->indices, job_spec->indices, job_spec->n_indices * sizeof (int));
+	  qsort (job->indices, job_spec->n_indices, sizeof (int), private_compare_ints);
+	}
+      job->spec.indices = job->indices;
+    }
+
+  if (NULL == job->spec.file_path || (NULL != job_spec->indices && NULL == job->indices))
+    {
+      free (job->spec.file_path);
+      free (job->indices);
+      free (job);
+      return private_show_error ("unable to allocate job", FAS_OUT_OF_MEMORY);
+    }
+
+  task.job   = job;
+  task.split = FAS_TRUE;
+  task.first = 0;
+  task.last  = 0;
+
+  pthread_mutex_lock (&pool->lock);
+  pool->jobs++;
+  i = pool->next_worker;
+  pool->next_worker = (pool->next_worker + 1) % pool->n_workers;
+  pthread_mutex_unlock (&pool->lock);
+
+  private_queue_task (pool, &pool->workers[i], task);
+  return FAS_SUCCESS;
+}
+
+/* fas_pool_wait */
+
+fas_error_type fas_pool_wait (fas_pool_ref_type pool)
+{
+  fas_error_type error;
+
+  if (NULL == pool)
+    return private_show_error ("NULL pool provided", FAS_INVALID_ARGUMENT);
+
+  pthread_mutex_lock (&pool->lock);
+  while (pool->jobs > 0)
+    pthread_cond_wait (&pool->jobs_done, &pool->lock);
+
+  error = pool->error;
+  pool->error = FAS_SUCCESS;
+  pthread_mutex_unlock (&pool->lock);
+
+  return error;
+}
+
+/* fas_pool_destroy */
+
+void fas_pool_destroy (fas_pool_ref_type pool)
+{
+  int i;
+
+  if (NULL == pool)
+    return;
+
+  fas_pool_wait (pool);
+
+  pthread_mutex_lock (&pool->lock);
+  pool->shutdown = FAS_TRUE;
+  pthread_cond_broadcast (&pool->work_ready);
+  pthread_mutex_unlock (&pool->lock);
+
+  /* all of them first: workers look into each other's queues until they stop */
+  for (i=0;i<pool->n_workers;i++)
+    if (pool->workers[i].started)
+      pthread_join (pool->workers[i].thread, NULL);
+
+  for (i=0;i<pool->n_workers;i++)
+    {
+      private_close_context (&pool->workers[i]);
+      free (pool->workers[i].queue.tasks);
+      pthread_mutex_destroy (&pool->workers[i].queue.lock);
+    }
+
+  pthread_cond_destroy (&pool->jobs_done);
+  pthread_cond_destroy (&pool->work_ready);
+  pthread_mutex_destroy (&pool->lock);
+
+  free (pool->workers);
+  free (pool);
+}
+
+/* fas_get_pool_stats */
+
+fas_error_type fas_get_pool_stats (fas_pool_ref_type pool, fas_pool_stats_type *stats)
+{
+  if (NULL == pool || NULL == stats)
+    return private_show_error ("NULL pool or stats", FAS_INVALID_ARGUMENT);
+
+  pthread_mutex_lock (&pool->lock);
+  *stats = pool->stats;
+  pthread_mutex_unlock (&pool->lock);
+
+  return FAS_SUCCESS;
+}
+
+
+/* private_push: grows the ring when full */
+
+static fas_boolean_type private_push (pool_queue_type *queue, pool_task_type task)
+{
+  if (queue->count == queue->size)
+    {
+      int new_size = queue->size ? 2 * queue->size : INITIAL_QUEUE_SIZE;
+      pool_task_type *tasks = (pool_task_type *) malloc (new_size * sizeof (pool_task_type));
+      int i;
+
+      if (NULL == tasks)
+	return FAS_FALSE;
+
+      for (i=0;i<queue->count;i++)
+	tasks[i] = queue->tasks[(queue->head + i) % queue->size];
+
+      free (queue->tasks);
+      queue->tasks = tasks;
+      queue->head  = 0;
+      queue->size  = new_size;
+    }
+
+  queue->tasks[(queue->head + queue->count) % queue->size] = task;
+  queue->count++;
+  return FAS_TRUE;
+}
+
+/* private_pop */
+
+static fas_boolean_type private_pop (pool_queue_type *queue, pool_task_type *task, fas_boolean_type from_front)
+{
+  fas_boolean_type found = FAS_FALSE;
+
+  pthread_mutex_lock (&queue->lock);
+  if (queue->count > 0)
+    {
+      if (from_front)
+	{
+	  *task = queue->tasks[queue->head];
+	  queue->head = (queue->head + 1) % queue->size;
+	}
+      else
+	*task = queue->tasks[(queue->head + queue->count - 1) % queue->size];
+
+      queue->count--;
+      found = FAS_TRUE;
+    }
+  pthread_mutex_unlock (&queue->lock);
+
+  return found;
+}
+
+/* private_queue_task: a task that cannot be queued fails its job */
+
+static void private_queue_task (fas_pool_ref_type pool, pool_worker_type *worker, pool_task_type task)
+{
+  pthread_mutex_lock (&worker->queue.lock);
+  fas_boolean_type pushed = private_push (&worker->queue, task);
+  pthread_mutex_unlock (&worker->queue.lock);
+
+  if (!pushed)
+    {
+      private_finish_task (pool, task.job, private_show_error ("unable to queue task", FAS_OUT_OF_MEMORY), 0);
+      return;
+    }
+
+  pthread_mutex_lock (&pool->lock);
+  pool->queued++;
+  pthread_cond_signal (&pool->work_ready);
+  pthread_mutex_unlock (&pool->lock);
+}
+
+/* private_next_task: the worker's own newest task, else the oldest one of another worker (the
+   far end of a job cut into chunks). blocks until there is one; FAS_FALSE on shutdown */
+
+static fas_boolean_type private_next_task (pool_worker_type *worker, pool_task_type *task)
+{
+  fas_pool_ref_type pool = worker->pool;
+  int i;
+
+  for (;;)
+    {
+      if (private_pop (&worker->queue, task, FAS_FALSE))
+	{
+	  pthread_mutex_lock (&pool->lock);
+	  pool->queued--;
+	  pthread_mutex_unlock (&pool->lock);
+	  return FAS_TRUE;
+	}
+
+      for (i=1;i<pool->n_workers;i++)
+	if (private_pop (&pool->workers[(worker->id + i) % pool->n_workers].queue, task, FAS_TRUE))
+	  {
+	    pthread_mutex_lock (&pool->lock);
+	    pool->queued--;
+	    pool->stats.steals++;
+	    pthread_mutex_unlock (&pool->lock);
+	    return FAS_TRUE;
+	  }
+
+      /* queued is only raised after the push, so a task pushed since the scan keeps it above 0 */
+      pthread_mutex_lock (&pool->lock);
+      while (pool->queued == 0 && !pool->shutdown)
+	pthread_cond_wait (&pool->work_ready, &pool->lock);
+
+      if (pool->queued == 0 && pool->shutdown)
+	{
+	  pthread_mutex_unlock (&pool->lock);
+	  return FAS_FALSE;
+	}
+      pthread_mutex_unlock (&pool->lock);
+    }
+}
+
+/* private_run_worker */
+
+static void *private_run_worker (void *worker_ptr)
+{
+  pool_worker_type *worker = (pool_worker_type *) worker_ptr;
+  pool_task_type task;
+  fas_error_type fas_error;
+
+  while (private_next_task (worker, &task))
+    {
+      pthread_mutex_lock (&worker->pool->lock);
+      fas_error = task.job->error;
+      pthread_mutex_unlock (&worker->pool->lock);
+
+      /* the rest of a failed job is dropped */
+      if (FAS_SUCCESS != fas_error)
+	{
+	  private_finish_task (worker->pool, task.job, FAS_SUCCESS, 0);
+	  continue;
+	}
+
+      if (task.split)
+	fas_error = private_split_job (worker, task.job);
+      else
+	fas_error = private_run_task (worker, &task);
+
+      if (FAS_SUCCESS != fas_error)
+	private_close_context (worker);
+
+      if (!task.split || FAS_SUCCESS != fas_error)
+	private_finish_task (worker->pool, task.job, fas_error, 0);
+    }
+
+  return NULL;
+}
+
+/* private_open_context: reuses the worker's context if it is on the job's file */
+
+static fas_error_type private_open_context (pool_worker_type *worker, pool_job_type *job)
+{
+  fas_error_type fas_error;
+
+  if (NULL != worker->context && !strcmp (worker->context_path, job->spec.file_path))
+    {
+      pthread_mutex_lock (&worker->pool->lock);
+      worker->pool->stats.reuses++;
+      pthread_mutex_unlock (&worker->pool->lock);
+    }
+  else
+    {
+      private_close_context (worker);
+
+      worker->context_path = (char *) malloc (strlen (job->spec.file_path) + 1);
+      if (NULL == worker->context_path)
+	return private_show_error ("unable to allocate buffer", FAS_OUT_OF_MEMORY);
+      strcpy (worker->context_path, job->spec.file_path);
+
+      fas_error = fas_open_video_with_options (&worker->context, job->spec.file_path, worker->pool->options);
+      if (FAS_SUCCESS != fas_error)
+	{
+	  private_close_context (worker);
+	  return private_show_error ("unable to open video for a job", fas_error);
+	}
+    }
+
+  /* without a complete table, seeks to later chunks would decode from the start */
+  if (job->table.num_entries > 0 && seek_true != fas_get_seek_table (worker->context).completed)
+    fas_put_seek_table (worker->context, job->table);
+
+  return FAS_SUCCESS;
+}
+
+/* private_split_job: cuts the job at keyframes into chunks of at least CHUNK_FRAMES frames and
+   queues them so the worker pops the first while thieves take the last. short jobs, and jobs
+   whose keyframes cannot be found without decoding, run as one chunk */
+
+static fas_error_type private_split_job (pool_worker_type *worker, pool_job_type *job)
+{
+  fas_pool_ref_type pool = worker->pool;
+  pool_task_type *chunks;
+  pool_task_type whole;
+  int n_chunks = 0;
+  int first, last, i, entry;
+  fas_error_type fas_error;
+
+  whole.job   = job;
+  whole.split = FAS_FALSE;
+
+  if (NULL != job->indices)
+    {
+      first = job->indices[0];
+      last  = job->indices[job->spec.n_indices - 1];
+      whole.first = 0;
+      whole.last  = job->spec.n_indices - 1;
+    }
+  else
+    {
+      first = job->spec.first_frame;
+      last  = job->spec.last_frame;
+      whole.first = first;
+      whole.last  = last;
+    }
+
+  if (last >= 0 && last - first < CHUNK_FRAMES)
+    return private_run_whole (worker, whole);
+
+  fas_error = private_open_context (worker, job);
+  if (FAS_SUCCESS != fas_error)
+    return fas_error;
+
+  seek_table_type table = fas_get_seek_table (worker->context);
+  if (seek_true == table.completed)
+    job->table = seek_copy_table (table);
+  else if (FAS_SUCCESS != fas_build_seek_table (job->spec.file_path, FAS_INDEX_PACKETS, &job->table))
+    seek_release_table (&job->table);
+
+  if (job->table.num_entries == 0 || seek_true != job->table.completed)
+    return private_run_whole (worker, whole);
+
+  if (NULL == job->indices)
+    {
+      if (last < 0)
+	last = job->table.num_frames - 1;
+      if (first > last || last >= job->table.num_frames)
+	return private_show_error ("frame range ends past the end of the video", FAS_NO_MORE_FRAMES);
+      whole.last = last;
+    }
+
+  chunks = (pool_task_type *) malloc ((job->table.num_entries + 1) * sizeof (pool_task_type));
+  if (NULL == chunks)
+    return private_run_whole (worker, whole);
+
+  if (NULL == job->indices)
+    {
+      int start = first;
+
+      for (entry=0;entry<job->table.num_entries;entry++)
+	{
+	  int key = job->table.array[entry].display_index;
+
+	  if (key > last)
+	    break;
+	  if (key - start >= CHUNK_FRAMES)
+	    {
+	      chunks[n_chunks] = whole;
+	      chunks[n_chunks].first = start;
+	      chunks[n_chunks].last  = key - 1;
+	      n_chunks++;
+	      start = key;
+	    }
+	}
+
+      chunks[n_chunks] = whole;
+      chunks[n_chunks].first = start;
+      n_chunks++;
+    }
+  else
+    {
+      /* only cut between indices in different GOPs, so no GOP is decoded twice */
+      int start = 0;
+
+      entry = 0;
+      for (i=1;i<job->spec.n_indices;i++)
+	{
+	  while (entry + 1 < job->table.num_entries && job->table.array[entry + 1].display_index <= job->indices[i])
+	    entry++;
+
+	  if (job->table.array[entry].display_index > job->indices[i - 1] &&
+	      job->indices[i] - job->indices[start] >= CHUNK_FRAMES)
+	    {
+	      chunks[n_chunks] = whole;
+	      chunks[n_chunks].first = start;
+	      chunks[n_chunks].last  = i - 1;
+	      n_chunks++;
+	      start = i;
+	    }
+	}
+
+      chunks[n_chunks] = whole;
+      chunks[n_chunks].first = start;
+      n_chunks++;
+    }
+
+  /* the split task stays pending until its chunks are queued */
+  pthread_mutex_lock (&pool->lock);
+  job->pending += n_chunks;
+  pthread_mutex_unlock (&pool->lock);
+
+  for (i=n_chunks-1;i>=0;i--)
+    private_queue_task (pool, worker, chunks[i]);
+
+  free (chunks);
+  private_finish_task (pool, job, FAS_SUCCESS, n_chunks);
+  return FAS_SUCCESS;
+}
+
+/* private_run_whole: queues the job as a single chunk in place of its split task */
+
+static fas_error_type private_run_whole (pool_worker_type *worker, pool_task_type whole)
+{
+  pthread_mutex_lock (&worker->pool->lock);
+  whole.job->pending++;
+  pthread_mutex_unlock (&worker->pool->lock);
+
+  private_queue_task (worker->pool, worker, whole);
+  private_finish_task (worker->pool, whole.job, FAS_SUCCESS, 1);
+  return FAS_SUCCESS;
+}
+
+/* private_run_task */
+
+static fas_error_type private_run_task (pool_worker_type *worker, pool_task_type *task)
+{
+  pool_job_type *job = task->job;
+  fas_error_type fas_error;
+  int i;
+
+  fas_error = private_open_context (worker, job);
+  if (FAS_SUCCESS != fas_error)
+    return fas_error;
+
+  if (NULL != job->indices)
+    {
+      for (i=task->first;i<=task->last;i++)
+	{
+	  if (i == task->first || job->indices[i] != job->indices[i - 1])
+	    {
+	      fas_error = fas_seek_to_frame (worker->context, job->indices[i]);
+	      if (FAS_SUCCESS != fas_error)
+		return private_show_error ("unable to seek to a requested frame", fas_error);
+	    }
+
+	  fas_error = private_deliver (worker->context, job);
+	  if (FAS_SUCCESS != fas_error)
+	    return fas_error;
+	}
+      return FAS_SUCCESS;
+    }
+
+  fas_error = fas_seek_to_frame (worker->context, task->first);
+  if (FAS_SUCCESS != fas_error)
+    return private_show_error ("unable to seek to the start of a chunk", fas_error);
+
+  for (;;)
+    {
+      fas_error = private_deliver (worker->context, job);
+      if (FAS_SUCCESS != fas_error)
+	return fas_error;
+
+      if (fas_get_frame_index (worker->context) == task->last)
+	return FAS_SUCCESS;
+
+      fas_error = fas_step_forward (worker->context);
+      if (FAS_SUCCESS != fas_error)
+	return private_show_error ("unable to step through a chunk", fas_error);
+
+      if (!fas_frame_available (worker->context))
+	{
+	  if (task->last < 0)
+	    return FAS_SUCCESS;
+	  return private_show_error ("frame range ends past the end of the video", FAS_NO_MORE_FRAMES);
+	}
+    }
+}
+
+/* private_deliver */
+
+static fas_error_type private_deliver (fas_context_ref_type context, pool_job_type *job)
+{
+  fas_frame_view_type view;
+  fas_error_type fas_error;
+
+  fas_error = fas_get_frame_view (context, &view);
+  if (FAS_SUCCESS != fas_error)
+    return private_show_error ("unable to get a frame for a job", fas_error);
+
+  job->spec.callback (job->spec.user_data, fas_get_frame_index (context), &view);
+  return FAS_SUCCESS;
+}
+
+/* private_finish_task: the last task of a job reports it and frees it. new_tasks are the run
+   tasks a split task queued */
+
+static void private_finish_task (fas_pool_ref_type pool, pool_job_type *job, fas_error_type error, int new_tasks)
+{
+  fas_boolean_type done;
+
+  pthread_mutex_lock (&pool->lock);
+  if (FAS_SUCCESS != error && FAS_SUCCESS == job->error)
+    job->error = error;
+  pool->stats.chunks += new_tasks;
+  job->pending--;
+  done = (job->pending == 0) ? FAS_TRUE : FAS_FALSE;
+  pthread_mutex_unlock (&pool->lock);
+
+  if (!done)
+    return;
+
+  /* nothing else refers to the job now */
+  if (NULL != job->spec.done)
+    job->spec.done (job->spec.user_data, job->error);
+
+  free (job->spec.file_path);
+  free (job->indices);
+  seek_release_table (&job->table);
+
+  pthread_mutex_lock (&pool->lock);
+  if (FAS_SUCCESS != job->error && FAS_SUCCESS == pool->error)
+    pool->error = job->error;
+  pool->stats.jobs++;
+  pool->jobs--;
+  if (pool->jobs == 0)
+    pthread_cond_broadcast (&pool->jobs_done);
+  pthread_mutex_unlock (&pool->lock);
+
+  free (job);
+}
+
+/* private_close_context */
+
+static void private_close_context (pool_worker_type *worker)
+{
+  if (NULL != worker->context)
+    fas_close_video (worker->context);
+
+  free (worker->context_path);
+  worker->context      = NULL;
+  worker->context_path = NULL;
+}
+
+/* private_compare_ints */
+
+static int private_compare_ints (const void *a, const void *b)
+{
+  int first  = *(const int *) a;
+  int second = *(const int *) b;
+
+  return (first < second) ? -1 : (first > second);
+}
+
+/* private_show_error */
+
+static fas_error_type private_show_error (const char *message, fas_error_type error)
+{
+  if (SHOW_ERROR_MESSAGES)
+    fprintf (stderr, " ===> decode_pool: %s\n", message);
+  return error;
+}
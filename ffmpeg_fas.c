@@ -26,28 +26,103 @@ extern "C"
 {
 #include "libavformat/avformat.h"
 #include "libavcodec/avcodec.h"
-int img_convert(AVPicture *dst, int dst_pix_fmt, const AVPicture *src, int src_pix_fmt, int src_width, int src_height);
+#include "libswscale/swscale.h"
 }
 #else
 #include "libavformat/avformat.h"
 #include "libavcodec/avcodec.h"
+#include "libswscale/swscale.h"
 #endif /*  _WIN32 && STATIC_DLL */
 
 #include "seek_indices.h"
+#include "seek_cache.h"
+#include "frame_cache.h"
+#include "image_pool.h"
+#include "pixel_kernels.h"
+#include "custom_io.h"
 #include "private_errors.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <pthread.h>
 
 #define FIRST_FRAME_INDEX     0
 #define NUM_POSSIBLE_ERRORS   9
+#define CACHE_DIR_SIZE        4096
+#define KEY_PACKET_RING       64
+#define NUM_SCALERS           4
+#define MAX_LOWRES            3
+#define SEEK_FRAMES_GUESS     8      // seek cost in decoded frames, until both are measured
+#define COST_WEIGHT           8      // new cost samples count 1/COST_WEIGHT
 
-enum PixelFormat	fmt;
+static fas_color_space_type gbl_output_color_space = FAS_RGB24;      // default of videos opened after fas_set_format
+static pthread_mutex_t      gbl_config_lock = PTHREAD_MUTEX_INITIALIZER;   // guards the defaults, logging flags and cache settings
+static pthread_once_t       gbl_register_once = PTHREAD_ONCE_INIT;
+
+/* avcodec_open and avcodec_close are not reentrant; av_find_stream_info opens codecs too.
+   shared with seek_builder.c */
+pthread_mutex_t gbl_open_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static char      gbl_cache_dir[CACHE_DIR_SIZE];   // empty when the seek table cache is off
+static long long gbl_cache_max_bytes;
+
+static image_pool_type gbl_image_pool;                // fas_get_frame buffers (off until fas_set_frame_pool)
+static pthread_mutex_t gbl_pool_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /**** Private Types ***********************************************************/
 
+typedef struct
+{
+  struct SwsContext *sws;                // NULL for an unused scaler
+  enum PixelFormat   src_format;
+  int                src_width;
+  int                src_height;
+  enum PixelFormat   dst_format;
+  int                dst_width;
+  int                dst_height;
+  int                flags;
+} scaler_type;
+
+typedef struct
+{
+  enum PixelFormat   format;
+  int                crop_x;             // the part of the decoded frame that is converted
+  int                crop_y;
+  int                crop_width;
+  int                crop_height;
+  int                width;              // and the size it is scaled to
+  int                height;
+  int                scaler_flags;
+  int                serial;             // changes with every format or geometry change
+} output_type;
+
+typedef struct
+{
+  AVFrame          *frame;               // copy of the decoded picture
+  uint8_t          *buffer;
+  AVFrame          *rgb_frame;           // frame converted to rgb_output by the producer
+  uint8_t          *rgb_buffer;
+  int               rgb_size;
+  int               rgb_serial;          // rgb_output.serial, -1 if the conversion failed
+  int               frame_index;
+  fas_boolean_type  is_frame_available;  // FAS_FALSE marks the end of the video
+  fas_error_type    error;
+} read_ahead_slot_type;
+
+typedef struct
+{
+  int frame_index;
+  int position;                          // in the caller's fas_get_frames request
+} frame_request_type;
+
+typedef struct
+{
+  int64_t sequence;                      // packet_sequence of a key packet
+  int64_t seek_dts;                      // its keyframe_packet_dts
+} key_packet_type;
+
 typedef struct fas_context_struct {
   fas_boolean_type is_video_active;
   fas_boolean_type is_frame_available;
@@ -55,6 +130,17 @@ typedef struct fas_context_struct {
   int current_frame_index;
 
   seek_table_type seek_table;
+  fas_boolean_type seek_table_stored;   // table came from (or went to) the cache, or from the caller
+
+  char            *file_path;           // NULL for custom input
+  custom_io_type  *custom_io;           // the custom input, or NULL for files
+  fas_index_mode_type index_mode;       // how private_complete_seek_table builds the rest of the table
+
+  fas_open_options_type options;
+  fas_boolean_type frame_threads;       // decoder output lags packet input by the thread pipeline
+  char             cache_variant[32];   // seek cache key for tables built with frame threads
+  char            *cache_dir;           // fas_set_seek_table_cache's at open; NULL when off
+  long long        cache_max_bytes;
 
   /* ffmpeg */
   AVFormatContext  *format_context;
@@ -63,18 +149,84 @@ typedef struct fas_context_struct {
 
   AVFrame          *frame_buffer;      // internal buffer
 
+  output_type       output;            // what fas_get_frame and fas_get_frame_view return
+  fas_color_space_type     output_color_space;  // as the caller asked for it
+  fas_output_geometry_type output_geometry;
+
+  /* swscale contexts, created on first use for each conversion and kept. the read-ahead
+     producer converts on its own thread, so it has its own set */
+  scaler_type       scalers[NUM_SCALERS];
+  scaler_type       producer_scalers[NUM_SCALERS];
+  int               next_scaler;       // round-robin replacement, caller's thread only
+  int               next_producer_scaler;
+
   AVFrame          *rgb_frame_buffer;  // extra AVFrames (for color conversion)
   uint8_t          *rgb_buffer;        // actual data buffer for rgb_frame_buffer (needs to be freed seperately)
+  int               rgb_size;          // bytes allocated for rgb_buffer
   fas_boolean_type  rgb_already_converted; // color_convert(frame_buffer) == rgb_frame_buffer (so we don't need to repeat conversions)
 
   AVFrame          *gray8_frame_buffer;
   uint8_t          *gray8_buffer;
   fas_boolean_type  gray8_already_converted;
 
+  unsigned long long frame_generation;  // bumped whenever the shown frame changes (for views)
+
   int64_t          current_dts;         // decoding timestamp of the most recently parsed packet
   int64_t          previous_dts;        // for previous packet (always use previous packet for seek_table (workaround))
   int64_t          keyframe_packet_dts; // dts of most recent keyframe packet
   int64_t          first_dts;           // for very first packet (needed in seek, for first keyframe)
+  fas_boolean_type decoder_drained;     // the decoder is not where current_frame_index says (seek first)
+  fas_boolean_type skipping_nonref;     // roll-forward: the decoder drops B-pictures, which still count as frames
+
+  fas_seek_stats_type seek_stats;       // decisions of the seek cost model, and the costs it measured
+
+  double           sample_step;         // frames per fas_step_sample, 0 until fas_set_sampling
+  int              sample_origin;       // frame index of sample 0
+  long long        sample_count;        // samples taken since
+
+  /* frame threading: packets are tagged through reordered_opaque, so a keyframe leaving the
+     pipeline can be matched with the key packet (and keyframe_packet_dts) it came from */
+  int64_t          packet_sequence;
+  key_packet_type  key_packets[KEY_PACKET_RING];
+
+  /* read-ahead (options.read_ahead > 0): while it runs, a producer thread owns the decoder state
+     above and fills a ring of slots; the caller only sees shown_slot and the shown_* fields */
+  fas_boolean_type      read_ahead_ready;     // locks, conditions and slots exist
+  fas_boolean_type      read_ahead_running;
+  fas_boolean_type      read_ahead_cancel;
+  pthread_t             read_ahead_thread;
+  pthread_mutex_t       read_ahead_lock;      // guards the ring and read_ahead_cancel
+  pthread_cond_t        read_ahead_not_empty;
+  pthread_cond_t        read_ahead_not_full;
+  pthread_mutex_t       table_lock;           // guards seek_table while the producer runs
+  read_ahead_slot_type *slots;                // options.read_ahead + 1, one of them shown
+  int                   num_slots;
+  int                   slot_head;            // next slot to pop
+  int                   slot_count;           // slots filled and not yet popped
+  int                   queued_frame_index;   // frame index of the last slot filled
+  read_ahead_slot_type *shown_slot;
+  int                   shown_frame_index;
+  fas_boolean_type      shown_frame_available;
+
+  /* frame cache: while cache_shown is set the caller sees that cached frame, wherever the
+     decoder (or read-ahead) really is */
+  frame_cache_type        frame_cache;
+  frame_cache_entry_type *cache_shown;
+  AVFrame                *cache_frame;        // picture over cache_shown->buffer
+  fas_boolean_type        cache_paused;       // frames being decoded are scanned, or their indices unsettled
+  fas_boolean_type        cache_raised;       // fas_step_backward grew the cache into a GOP buffer
+  int64_t                 cache_user_bytes;   // the caller's limit, put back once decoding goes forward
+
+  /* reverse playback: a helper context on the same file decodes the GOP before the one being
+     played backwards into its own frame cache, which is then moved into frame_cache */
+  struct fas_context_struct *prefetch_helper;
+  fas_boolean_type      prefetch_failed;      // the helper could not be opened, don't retry
+  fas_boolean_type      prefetch_running;
+  pthread_t             prefetch_thread;
+  int                   prefetch_first;       // frames prefetch_first..prefetch_last
+  int                   prefetch_last;
+  fas_error_type        prefetch_error;
+  int                   prefetch_table_entries;  // seek table entries the helper was given
 
 } fas_context_type;
 
@@ -100,90 +252,359 @@ char* fas_error_message(fas_error_type error)
   return gbl_error_strings[error];
 }
 
-static void             private_show_warning (const char *message);
-static fas_error_type   private_show_error (const char *message, fas_error_type error);
+static fas_boolean_type private_logging (fas_context_ref_type context);
+static void             private_show_warning (fas_context_ref_type context, const char *message);
+static fas_error_type   private_show_error (fas_context_ref_type context, const char *message, fas_error_type error);
+static fas_error_type   private_fail_open (fas_context_ref_type context, fas_boolean_type logging, const char *message,
+					   fas_error_type error);
+static fas_error_type   private_open_video (fas_context_ref_type *context_ptr, char *file_path, const fas_custom_io_type *io,
+					    fas_open_options_type options);
+static void             private_register (void);
 static fas_error_type   private_convert_to_rgb (fas_context_ref_type ctx);
+static fas_error_type   private_scale (scaler_type *scalers, int *next_scaler, AVFrame *src, enum PixelFormat src_format,
+				       AVFrame *dst, output_type *output);
+static fas_boolean_type private_fast_convert (AVPicture *src, enum PixelFormat src_format, AVFrame *dst, output_type *output);
+static fas_boolean_type private_is_whole_frame (fas_context_ref_type context);
+static fas_boolean_type private_is_planar_yuv (enum PixelFormat format);
+static fas_boolean_type private_resolve_geometry (fas_context_ref_type context, fas_output_geometry_type geometry,
+						  output_type *output);
+static void             private_change_output (fas_context_ref_type context, output_type *output);
+static void             private_free_scalers (scaler_type *scalers);
 static fas_error_type   private_seek_to_nearest_key (fas_context_ref_type context, int target_index, int offset);
+static void             private_store_seek_table (fas_context_ref_type context);
+static void             private_configure_threads (fas_context_ref_type context);
+static void             private_configure_lowres (fas_context_ref_type context);
+static void             private_tag_packet (fas_context_ref_type context, fas_boolean_type is_key);
+static fas_boolean_type private_key_packet_dts (fas_context_ref_type context, int64_t *seek_dts);
+static fas_boolean_type private_drain_frame (fas_context_ref_type context);
+static fas_error_type   private_step_decoder (fas_context_ref_type context);
+static fas_error_type   private_scan_to_key (fas_context_ref_type context, fas_boolean_type counting);
+static fas_boolean_type private_decode_key (fas_context_ref_type context, AVPacket *packet);
+static fas_boolean_type private_next_key_entry (fas_context_ref_type context, int frame_index, seek_entry_type *entry);
+static fas_boolean_type private_can_skip_nonref (fas_context_ref_type context);
+static fas_boolean_type private_prefer_forward (fas_context_ref_type context, int target_index);
+static void             private_update_cost (long long *cost, int64_t sample);
+static unsigned char    *private_alloc_image (int size);
+static int              private_compare_requests (const void *a, const void *b);
+static fas_error_type   private_read_ahead_step (fas_context_ref_type context);
+static fas_error_type   private_stop_read_ahead (fas_context_ref_type context);
+static void             private_free_read_ahead (fas_context_ref_type context);
+static AVFrame         *private_shown_frame (fas_context_ref_type context);
+static void             private_frame_changed (fas_context_ref_type context);
+static void             private_cache_frame (fas_context_ref_type context, AVFrame *frame, int frame_index);
+static void             private_show_cached (fas_context_ref_type context, frame_cache_entry_type *entry);
+static void             private_hide_cached (fas_context_ref_type context);
+static void             private_restore_cache_limit (fas_context_ref_type context);
+static fas_error_type   private_step_from_cache (fas_context_ref_type context);
+static fas_error_type   private_seek_decoder (fas_context_ref_type context, int target_index);
+static void             private_start_prefetch (fas_context_ref_type context, int first, int last);
+static void             private_finish_prefetch (fas_context_ref_type context);
 fas_error_type          private_complete_seek_table (fas_context_ref_type context);
 
 
 void fas_set_logging (fas_boolean_type logging)
 {
-  if (logging == FAS_TRUE)
+  int show = (logging == FAS_TRUE) ? 1 : 0;
+
+  /* only written when it changes, so threads repeating the same fas_initialize don't race
+     the readers */
+  pthread_mutex_lock (&gbl_config_lock);
+  if (SHOW_ERROR_MESSAGES != show || SHOW_WARNING_MESSAGES != show)
     {
-      SHOW_ERROR_MESSAGES = 1;
-      SHOW_WARNING_MESSAGES = 1;
+      SHOW_ERROR_MESSAGES = show;
+      SHOW_WARNING_MESSAGES = show;
 #ifndef _WIN32
-      av_log_level = AV_LOG_INFO;
+      av_log_level = show ? AV_LOG_INFO : AV_LOG_QUIET;
 #endif
     }
-  else 
-    {
-      SHOW_ERROR_MESSAGES = 0;
-      SHOW_WARNING_MESSAGES = 0;
-#ifndef _WIN32
-      av_log_level = AV_LOG_QUIET;
-#endif
-    }  
+  pthread_mutex_unlock (&gbl_config_lock);
 }
 
-/* Set the output image colorspace */
-void fas_set_format(fas_color_space_type format)
+/* private_pixel_format */
+static enum PixelFormat private_pixel_format (fas_color_space_type format)
 {
 	switch (format)
 	{
 	case FAS_GRAY8:
-		fmt = PIX_FMT_GRAY8;
-		break;
+		return PIX_FMT_GRAY8;
 	case FAS_ARGB32:
-		fmt = PIX_FMT_RGB32_1;
-		break;
+		return PIX_FMT_RGB32_1;
 	case FAS_ABGR32:
-		fmt = PIX_FMT_BGR32_1;
-		break;
+		return PIX_FMT_BGR32_1;
 	case FAS_YUV420P:
-		fmt = PIX_FMT_YUV420P;
-		break;
+		return PIX_FMT_YUV420P;
 	case FAS_YUYV422:
-		fmt = PIX_FMT_YUYV422;
-		break;
+		return PIX_FMT_YUYV422;
 	case FAS_UYVY422:
-		fmt = PIX_FMT_UYVY422;
-		break;
+		return PIX_FMT_UYVY422;
 	case FAS_YUV422P:
-		fmt = PIX_FMT_YUV422P;
-		break;
+		return PIX_FMT_YUV422P;
 	case FAS_YUV444P:
-		fmt = PIX_FMT_YUV444P;
-		break;
+		return PIX_FMT_YUV444P;
 	case FAS_RGB24:
-		fmt = PIX_FMT_RGB24;
-		break;
+		return PIX_FMT_RGB24;
 	case FAS_BGR24:
-		fmt = PIX_FMT_BGR24;
-		break;
+		return PIX_FMT_BGR24;
 	default:
-		fmt = PIX_FMT_RGB24;
-		break;
+		return PIX_FMT_RGB24;
 	}
 }
 
+/* Set the output image colorspace (of videos opened from now on) */
+void fas_set_format(fas_color_space_type format)
+{
+  pthread_mutex_lock (&gbl_config_lock);
+  gbl_output_color_space = format;
+  pthread_mutex_unlock (&gbl_config_lock);
+}
+
+/* fas_set_output_format */
+fas_error_type fas_set_output_format (fas_context_ref_type context, fas_color_space_type format)
+{
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return private_show_error (context, "null context or inactive video", FAS_INVALID_ARGUMENT);
+
+  output_type output = context->output;
+  output.format = private_pixel_format (format);
+  context->output_color_space = format;
+  if (output.format == context->output.format)
+    return FAS_SUCCESS;
+
+  private_change_output (context, &output);
+  return FAS_SUCCESS;
+}
+
+/* fas_set_output_geometry */
+fas_error_type fas_set_output_geometry (fas_context_ref_type context, fas_output_geometry_type geometry)
+{
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return private_show_error (context, "null context or inactive video", FAS_INVALID_ARGUMENT);
+
+  output_type output = context->output;
+  if (!private_resolve_geometry (context, geometry, &output))
+    return private_show_error (context, "output geometry outside the frame, crop offset on a packed format, or unknown filter",
+			       FAS_INVALID_ARGUMENT);
+
+  context->output_geometry = geometry;
+  private_change_output (context, &output);
+  return FAS_SUCCESS;
+}
+
+/* fas_get_output_geometry */
+fas_output_geometry_type fas_get_output_geometry (fas_context_ref_type context)
+{
+  fas_output_geometry_type geometry;
+
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    {
+      memset (&geometry, 0, sizeof (geometry));
+      return geometry;
+    }
+
+  return context->output_geometry;
+}
+
+/* private_is_planar_yuv: the formats av_picture_crop can crop */
+static fas_boolean_type private_is_planar_yuv (enum PixelFormat format)
+{
+  switch (format)
+    {
+    case PIX_FMT_YUV420P:
+    case PIX_FMT_YUVJ420P:
+    case PIX_FMT_YUV422P:
+    case PIX_FMT_YUVJ422P:
+    case PIX_FMT_YUV444P:
+    case PIX_FMT_YUVJ444P:
+    case PIX_FMT_YUV410P:
+    case PIX_FMT_YUV411P:
+      return FAS_TRUE;
+    default:
+      return FAS_FALSE;
+    }
+}
+
+/* private_resolve_geometry */
+static fas_boolean_type private_resolve_geometry (fas_context_ref_type context, fas_output_geometry_type geometry,
+						  output_type *output)
+{
+  int frame_width  = context->codec_context->width;
+  int frame_height = context->codec_context->height;
+
+  if (geometry.crop_x < 0 || geometry.crop_y < 0 || geometry.crop_width < 0 || geometry.crop_height < 0 ||
+      geometry.width < 0 || geometry.height < 0)
+    return FAS_FALSE;
+
+  /* chroma planes are shifted by whole samples, so crops start on even pixels */
+  output->crop_x      = geometry.crop_x & ~1;
+  output->crop_y      = geometry.crop_y & ~1;
+  output->crop_width  = geometry.crop_width  ? geometry.crop_width  : frame_width  - output->crop_x;
+  output->crop_height = geometry.crop_height ? geometry.crop_height : frame_height - output->crop_y;
+
+  if (output->crop_width <= 0 || output->crop_height <= 0 ||
+      output->crop_x + output->crop_width > frame_width || output->crop_y + output->crop_height > frame_height)
+    return FAS_FALSE;
+
+  /* private_scale can only move the start of planar YUV pictures */
+  if ((output->crop_x || output->crop_y) && !private_is_planar_yuv (context->codec_context->pix_fmt))
+    return FAS_FALSE;
+
+  /* one side given: the other keeps the crop's aspect ratio */
+  output->width  = geometry.width;
+  output->height = geometry.height;
+  if (0 == output->width && 0 == output->height)
+    {
+      output->width  = output->crop_width;
+      output->height = output->crop_height;
+    }
+  else if (0 == output->width)
+    output->width  = (int) ((int64_t) output->crop_width * output->height / output->crop_height);
+  else if (0 == output->height)
+    output->height = (int) ((int64_t) output->crop_height * output->width / output->crop_width);
+
+  if (output->width < 1)
+    output->width = 1;
+  if (output->height < 1)
+    output->height = 1;
+
+  switch (geometry.filter)
+    {
+    case FAS_FILTER_BICUBIC:        output->scaler_flags = SWS_BICUBIC;        break;
+    case FAS_FILTER_BILINEAR:       output->scaler_flags = SWS_BILINEAR;       break;
+    case FAS_FILTER_FAST_BILINEAR:  output->scaler_flags = SWS_FAST_BILINEAR;  break;
+    case FAS_FILTER_POINT:          output->scaler_flags = SWS_POINT;          break;
+    case FAS_FILTER_AREA:           output->scaler_flags = SWS_AREA;           break;
+    default:
+      return FAS_FALSE;
+    }
+
+  return FAS_TRUE;
+}
+
+/* private_change_output */
+static void private_change_output (fas_context_ref_type context, output_type *output)
+{
+  /* the read-ahead producer picks the change up for the next frame it converts */
+  output->serial = context->output.serial + 1;
+
+  if (context->read_ahead_running)
+    pthread_mutex_lock (&context->read_ahead_lock);
+  context->output = *output;
+  if (context->read_ahead_running)
+    pthread_mutex_unlock (&context->read_ahead_lock);
+
+  context->rgb_already_converted = FAS_FALSE;
+  context->frame_generation     += 1;
+}
+
+/* fas_get_output_format */
+fas_color_space_type fas_get_output_format (fas_context_ref_type context)
+{
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return fas_default_open_options ().format;
+
+  return context->output_color_space;
+}
+
+
+/* Set (or with NULL, clear) the seek table cache directory */
+void fas_set_seek_table_cache (const char *cache_dir, long long max_bytes)
+{
+  pthread_mutex_lock (&gbl_config_lock);
+  if (NULL == cache_dir)
+    gbl_cache_dir[0] = 0;
+  else
+    {
+      strncpy(gbl_cache_dir, cache_dir, CACHE_DIR_SIZE - 1);
+      gbl_cache_dir[CACHE_DIR_SIZE - 1] = 0;
+    }
+
+  gbl_cache_max_bytes = max_bytes;
+  pthread_mutex_unlock (&gbl_config_lock);
+}
 
 void fas_initialize (fas_boolean_type logging, fas_color_space_type format)
 {
   fas_set_logging(logging);
   fas_set_format(format);
-  av_register_all();
+  pthread_once (&gbl_register_once, private_register);
   
   return;
 }
 
+/* private_register */
+static void private_register (void)
+{
+  av_register_all();
+
+  /* resolved here rather than by the first conversion, which may run on any thread */
+  pixel_get_level ();
+}
+
+/* fas_default_open_options */
+
+fas_open_options_type fas_default_open_options (void)
+{
+  fas_open_options_type options;
+
+  options.thread_count = 1;
+  options.thread_type  = FAS_THREAD_SLICE | FAS_THREAD_FRAME;
+  options.read_ahead   = 0;
+  options.lowres       = 0;
+
+  pthread_mutex_lock (&gbl_config_lock);
+  options.format       = gbl_output_color_space;
+  options.logging      = SHOW_ERROR_MESSAGES ? FAS_TRUE : FAS_FALSE;
+  pthread_mutex_unlock (&gbl_config_lock);
+
+  return options;
+}
+
 /* fas_open_video */
 
 fas_error_type fas_open_video (fas_context_ref_type *context_ptr, char *file_path)
+{
+  return fas_open_video_with_options (context_ptr, file_path, fas_default_open_options ());
+}
+
+/* fas_open_video_with_options */
+
+fas_error_type fas_open_video_with_options (fas_context_ref_type *context_ptr, char *file_path, fas_open_options_type options)
+{
+  if (NULL == file_path)
+    return private_fail_open (NULL, options.logging, "NULL file path provided", FAS_INVALID_ARGUMENT);
+
+  return private_open_video (context_ptr, file_path, NULL, options);
+}
+
+/* fas_open_video_custom_io */
+
+fas_error_type fas_open_video_custom_io (fas_context_ref_type *context_ptr, const fas_custom_io_type *io, fas_open_options_type options)
+{
+  if (NULL == io || (NULL == io->data && NULL == io->read))
+    return private_fail_open (NULL, options.logging, "custom input needs data or a read callback", FAS_INVALID_ARGUMENT);
+
+  if (io->data && io->data_size <= 0)
+    return private_fail_open (NULL, options.logging, "empty custom input buffer", FAS_INVALID_ARGUMENT);
+
+  return private_open_video (context_ptr, NULL, io, options);
+}
+
+/* private_open_video */
+
+static fas_error_type private_open_video (fas_context_ref_type *context_ptr, char *file_path, const fas_custom_io_type *io,
+					  fas_open_options_type options)
 {
   if (NULL == context_ptr)
-    return private_show_error ("NULL context pointer provided", FAS_INVALID_ARGUMENT);
+    return private_fail_open (NULL, options.logging, "NULL context pointer provided", FAS_INVALID_ARGUMENT);
+
+  if (options.thread_count < 0)
+    return private_fail_open (NULL, options.logging, "negative decoder thread count", FAS_INVALID_ARGUMENT);
+
+  if (options.read_ahead < 0)
+    return private_fail_open (NULL, options.logging, "negative read-ahead depth", FAS_INVALID_ARGUMENT);
+
+  if (options.lowres < 0 || options.lowres > MAX_LOWRES)
+    return private_fail_open (NULL, options.logging, "lowres must be between 0 and 3", FAS_INVALID_ARGUMENT);
 
   //  seek_error_type      seek_error;
   fas_context_ref_type fas_context;
@@ -194,7 +615,7 @@ fas_error_type fas_open_video (fas_context_ref_type *context_ptr, char *file_pat
   memset(fas_context, 0, sizeof(fas_context_type));
   
   if (NULL == fas_context)
-    return private_show_error ("unable to allocate buffer", FAS_OUT_OF_MEMORY);
+    return private_fail_open (NULL, options.logging, "unable to allocate buffer", FAS_OUT_OF_MEMORY);
 
   fas_context->is_video_active        = FAS_TRUE;
   fas_context->is_frame_available     = FAS_TRUE;
@@ -203,23 +624,49 @@ fas_error_type fas_open_video (fas_context_ref_type *context_ptr, char *file_pat
   fas_context->previous_dts           = AV_NOPTS_VALUE;
   fas_context->keyframe_packet_dts    = AV_NOPTS_VALUE;
   fas_context->first_dts              = AV_NOPTS_VALUE;
+  fas_context->options                = options;
+  fas_context->output.format          = private_pixel_format (options.format);
+  fas_context->output_color_space     = options.format;
+
+  int key;
+  for (key = 0; key < KEY_PACKET_RING; key++)
+    fas_context->key_packets[key].sequence = -1;
 
   fas_context->seek_table = seek_init_table (-1); /* default starting size */ 
+  fas_context->frame_cache = frame_cache_init (0);
 
-  if (av_open_input_file ( &(fas_context->format_context), file_path, NULL, 0, NULL ) != 0)
+  if (io)
+    {
+      fas_error_type io_error = custom_io_open (io, &(fas_context->format_context), &fas_context->custom_io);
+      if (FAS_SUCCESS != io_error)
+	return private_fail_open (fas_context, options.logging, "failure to open custom input", io_error);
+    }
+  else
     {
-      fas_close_video(fas_context);
-      return private_show_error ("failure to open file", FAS_UNSUPPORTED_FORMAT);
+      fas_context->file_path = (char *) malloc (strlen (file_path) + 1);
+      if (NULL == fas_context->file_path)
+	{
+	  return private_fail_open (fas_context, options.logging, "unable to allocate buffer", FAS_OUT_OF_MEMORY);
+	}
+      strcpy (fas_context->file_path, file_path);
+
+      if (av_open_input_file ( &(fas_context->format_context), file_path, NULL, 0, NULL ) != 0)
+	{
+	  return private_fail_open (fas_context, options.logging, "failure to open file", FAS_UNSUPPORTED_FORMAT);
+	}
     }
 
-  if (av_find_stream_info (fas_context->format_context) < 0)
+  pthread_mutex_lock (&gbl_open_lock);
+  int found = av_find_stream_info (fas_context->format_context);
+  pthread_mutex_unlock (&gbl_open_lock);
+
+  if (found < 0)
     {
-      fas_close_video(fas_context);
-      return private_show_error ("could not extract stream information", FAS_UNSUPPORTED_FORMAT);
+      return private_fail_open (fas_context, options.logging, "could not extract stream information", FAS_UNSUPPORTED_FORMAT);
     }
 
-  if (SHOW_WARNING_MESSAGES)
-    dump_format(fas_context->format_context, 0, file_path, 0);
+  if (options.logging)
+    dump_format(fas_context->format_context, 0, io ? (io->name ? io->name : "custom input") : file_path, 0);
 
   int stream_idx;
   for (stream_idx = 0; stream_idx < fas_context->format_context->nb_streams; stream_idx++) 
@@ -234,8 +681,7 @@ fas_error_type fas_open_video (fas_context_ref_type *context_ptr, char *file_pat
   
   if (fas_context->codec_context == 0)
     {
-      fas_close_video(fas_context);
-      return private_show_error ("failure to find a video stream", FAS_UNSUPPORTED_FORMAT);
+      return private_fail_open (fas_context, options.logging, "failure to find a video stream", FAS_UNSUPPORTED_FORMAT);
     }
 
   AVCodec *codec = avcodec_find_decoder (fas_context->codec_context->codec_id);
@@ -243,36 +689,55 @@ fas_error_type fas_open_video (fas_context_ref_type *context_ptr, char *file_pat
   if (!codec)
     {
       fas_context->codec_context = 0;
-      fas_close_video(fas_context);
-      return private_show_error("failed to find correct video codec", FAS_UNSUPPORTED_CODEC);
+      return private_fail_open (fas_context, options.logging, "failed to find correct video codec", FAS_UNSUPPORTED_CODEC);
     }
   
-  if (avcodec_open (fas_context->codec_context, codec) < 0)
+  private_configure_threads (fas_context);
+  private_configure_lowres (fas_context);
+
+  pthread_mutex_lock (&gbl_open_lock);
+  int opened = avcodec_open (fas_context->codec_context, codec);
+  pthread_mutex_unlock (&gbl_open_lock);
+
+  if (opened < 0)
     {
       fas_context->codec_context = 0;
-      fas_close_video(fas_context);
-      return private_show_error ("failed to open codec", FAS_UNSUPPORTED_CODEC);
+      return private_fail_open (fas_context, options.logging, "failed to open codec", FAS_UNSUPPORTED_CODEC);
+    }
+
+#ifdef FF_THREAD_FRAME
+  if ((fas_context->codec_context->active_thread_type & FF_THREAD_FRAME) && fas_context->codec_context->thread_count > 1)
+    {
+      fas_context->frame_threads = FAS_TRUE;
+      sprintf (fas_context->cache_variant, "frame-threads-%d", fas_context->codec_context->thread_count);
     }
+#endif
+
+  /* whole frames until fas_set_output_geometry */
+  private_resolve_geometry (fas_context, fas_context->output_geometry, &fas_context->output);
   
   fas_context->frame_buffer     = avcodec_alloc_frame ();
   if (fas_context->frame_buffer == NULL)
     {
-      fas_close_video(fas_context);
-      return private_show_error ("failed to allocate frame buffer", FAS_OUT_OF_MEMORY);
+      return private_fail_open (fas_context, options.logging, "failed to allocate frame buffer", FAS_OUT_OF_MEMORY);
     }
   
   fas_context->rgb_frame_buffer = avcodec_alloc_frame ();
   if (fas_context->rgb_frame_buffer == NULL)
     {
-      fas_close_video(fas_context);
-      return private_show_error ("failed to allocate rgb frame buffer", FAS_OUT_OF_MEMORY);
+      return private_fail_open (fas_context, options.logging, "failed to allocate rgb frame buffer", FAS_OUT_OF_MEMORY);
     }
   
   fas_context->gray8_frame_buffer = avcodec_alloc_frame ();
   if (fas_context->gray8_frame_buffer == NULL)
     {
-      fas_close_video(fas_context);
-      return private_show_error ("failed to allocate gray8 frame buffer", FAS_OUT_OF_MEMORY);
+      return private_fail_open (fas_context, options.logging, "failed to allocate gray8 frame buffer", FAS_OUT_OF_MEMORY);
+    }
+
+  fas_context->cache_frame = avcodec_alloc_frame ();
+  if (fas_context->cache_frame == NULL)
+    {
+      return private_fail_open (fas_context, options.logging, "failed to allocate cache frame", FAS_OUT_OF_MEMORY);
     }
   
   fas_context->rgb_buffer = 0;
@@ -280,14 +745,40 @@ fas_error_type fas_open_video (fas_context_ref_type *context_ptr, char *file_pat
   fas_context->rgb_already_converted = FAS_FALSE;
   fas_context->gray8_already_converted = FAS_FALSE;
 
+  /* the context keeps its own copy of the cache settings, which other threads may change */
+  if (file_path)
+    {
+      pthread_mutex_lock (&gbl_config_lock);
+      if (gbl_cache_dir[0])
+	{
+	  fas_context->cache_dir = (char *) malloc (strlen (gbl_cache_dir) + 1);
+	  if (fas_context->cache_dir)
+	    strcpy (fas_context->cache_dir, gbl_cache_dir);
+	  fas_context->cache_max_bytes = gbl_cache_max_bytes;
+	}
+      pthread_mutex_unlock (&gbl_config_lock);
+    }
+
+  if (fas_context->cache_dir)
+    {
+      seek_table_type cached_table;
+      if (seek_cache_load (fas_context->cache_dir, file_path, fas_context->frame_threads ? fas_context->cache_variant : NULL,
+			   &cached_table) == seek_no_error)
+	{
+	  seek_release_table (&fas_context->seek_table);
+	  fas_context->seek_table = cached_table;
+	  fas_context->seek_table_stored = FAS_TRUE;
+	}
+    }
+
   *context_ptr = fas_context; 
 
 
-  if (FAS_SUCCESS != fas_step_forward(*context_ptr))
-    return private_show_error ("failure decoding first frame", FAS_NO_MORE_FRAMES);
+  if (FAS_SUCCESS != private_step_decoder(*context_ptr))
+    return private_show_error (fas_context, "failure decoding first frame", FAS_NO_MORE_FRAMES);
 
   if (!fas_frame_available(*context_ptr))
-    return private_show_error ("couldn't find a first frame (no valid frames in video stream)", FAS_NO_MORE_FRAMES);
+    return private_show_error (fas_context, "couldn't find a first frame (no valid frames in video stream)", FAS_NO_MORE_FRAMES);
 
 
 
@@ -298,19 +789,35 @@ fas_error_type fas_open_video (fas_context_ref_type *context_ptr, char *file_pat
 fas_error_type fas_close_video (fas_context_ref_type context)
 {
   if (NULL == context) 
-    return private_show_error ("NULL context provided for fas_close_video()", FAS_INVALID_ARGUMENT);
+    return private_show_error (context, "NULL context provided for fas_close_video()", FAS_INVALID_ARGUMENT);
   
   if (!(context->is_video_active)) 
     {
-      private_show_warning ("Redundant attempt to close an inactive video");
+      private_show_warning (context, "Redundant attempt to close an inactive video");
       return FAS_SUCCESS;
     }
+
+  private_finish_prefetch (context);
+  if (context->prefetch_helper)
+    fas_close_video (context->prefetch_helper);
+
+  private_hide_cached (context);
+  frame_cache_release (&context->frame_cache);
+
+  private_stop_read_ahead (context);
+  private_free_read_ahead (context);
   
   if (context->codec_context)
     if (avcodec_find_decoder (context->codec_context->codec_id))
-      avcodec_close(context->codec_context);
-
-  if (context->format_context)
+      {
+	pthread_mutex_lock (&gbl_open_lock);
+	avcodec_close(context->codec_context);
+	pthread_mutex_unlock (&gbl_open_lock);
+      }
+
+  if (context->custom_io)
+    custom_io_close (context->format_context, context->custom_io);
+  else if (context->format_context)
     av_close_input_file (context->format_context);
 
   if (context->rgb_frame_buffer)
@@ -321,14 +828,26 @@ fas_error_type fas_close_video (fas_context_ref_type context)
 
   if (context->rgb_buffer)
     av_free(context->rgb_buffer);
+
+  private_free_scalers (context->scalers);
+  private_free_scalers (context->producer_scalers);
   
   if (context->gray8_buffer)
     av_free(context->gray8_buffer);
   
   if (context->frame_buffer)
     av_free (context->frame_buffer);
+
+  if (context->cache_frame)
+    av_free (context->cache_frame);
     
   seek_release_table (&(context->seek_table)); 
+
+  if (context->file_path)
+    free (context->file_path);
+
+  if (context->cache_dir)
+    free (context->cache_dir);
   
   context->is_video_active = FAS_FALSE;
   
@@ -342,12 +861,199 @@ fas_error_type fas_close_video (fas_context_ref_type context)
 fas_error_type fas_step_forward (fas_context_ref_type context)
 {
   if ((NULL == context) || (FAS_TRUE != context->is_video_active)) {
-    return private_show_error ("invalid or unopened context", FAS_INVALID_ARGUMENT);
+    return private_show_error (context, "invalid or unopened context", FAS_INVALID_ARGUMENT);
+  }
+
+  if (context->cache_shown)
+    return private_step_from_cache (context);
+
+  private_restore_cache_limit (context);
+
+  if (context->decoder_drained && context->is_frame_available)
+    return private_seek_decoder (context, context->current_frame_index + 1);
+
+  if (context->options.read_ahead > 0)
+    return private_read_ahead_step (context);
+
+  return private_step_decoder (context);
+}
+
+/* fas_step_to_next_keyframe */
+fas_error_type fas_step_to_next_keyframe (fas_context_ref_type context)
+{
+  fas_error_type fas_error;
+
+  if ((NULL == context) || (FAS_TRUE != context->is_video_active))
+    return private_show_error (context, "invalid or unopened context", FAS_INVALID_ARGUMENT);
+
+  if (!fas_frame_available (context))
+    {
+      private_show_warning (context, "tried to advance after end of frames");
+      return FAS_SUCCESS;
+    }
+
+  /* the scan carries on from the demuxer, which has to be just past the shown frame */
+  int shown_index = fas_get_frame_index (context);
+  private_hide_cached (context);
+  private_restore_cache_limit (context);
+  private_stop_read_ahead (context);
+
+  /* with reordering (or a frame threading pipeline) packets do not come out as the frames
+     they are, so display indices have to come from a completed table */
+  fas_boolean_type counting = (0 == context->codec_context->has_b_frames && !context->frame_threads) ? FAS_TRUE : FAS_FALSE;
+  if (!counting && !context->seek_table.completed)
+    {
+      fas_error = private_complete_seek_table (context);
+      if (fas_error != FAS_SUCCESS)
+	return private_show_error (context, "unable to complete the seek table for keyframe stepping", fas_error);
+    }
+
+  if (context->current_frame_index != shown_index)
+    {
+      fas_error = private_seek_decoder (context, shown_index);
+      if (fas_error != FAS_SUCCESS)
+	return private_show_error (context, "unable to return to the shown frame", fas_error);
+    }
+
+  return private_scan_to_key (context, context->seek_table.completed ? FAS_FALSE : counting);
+}
+
+/* private_scan_to_key */
+static fas_error_type private_scan_to_key (fas_context_ref_type context, fas_boolean_type counting)
+{
+  /* only key packets reach the decoder, each after a flush. the dts bookkeeping is the same as
+     private_step_decoder's, so a table entry can be matched on first_packet_dts */
+  int frame_index = context->current_frame_index;
+  fas_boolean_type has_entry = FAS_FALSE;
+  seek_entry_type next_entry;
+  AVPacket packet;
+
+  if (!counting)
+    has_entry = private_next_key_entry (context, frame_index, &next_entry);
+
+  while (counting || has_entry)
+    {
+      if (av_read_frame (context->format_context, &packet) < 0)
+	break;
+
+      if (packet.stream_index != context->stream_idx)
+	{
+	  av_free_packet (&packet);
+	  continue;
+	}
+
+      context->previous_dts = context->current_dts;
+      context->current_dts  = packet.dts;
+
+      if (context->first_dts == AV_NOPTS_VALUE)
+	context->first_dts = packet.dts;
+
+      /* without reordering every packet is one frame */
+      if (counting && packet.size > 0)
+	frame_index++;
+
+      if (packet.flags & PKT_FLAG_KEY)
+	{
+	  context->keyframe_packet_dts = (context->previous_dts == AV_NOPTS_VALUE) ? packet.dts : context->previous_dts;
+
+	  while (has_entry && next_entry.first_packet_dts < context->keyframe_packet_dts)
+	    has_entry = private_next_key_entry (context, next_entry.display_index, &next_entry);
+
+	  fas_boolean_type is_listed = (has_entry && next_entry.first_packet_dts == context->keyframe_packet_dts) ? FAS_TRUE : FAS_FALSE;
+
+	  if ((counting ? packet.size > 0 : is_listed) && private_decode_key (context, &packet))
+	    {
+	      if (counting)
+		{
+		  seek_entry_type entry;
+		  entry.display_index    = frame_index;
+		  entry.first_packet_dts = context->keyframe_packet_dts;
+		  entry.last_packet_dts  = packet.dts;
+		  seek_append_table_entry (&context->seek_table, entry);
+
+		  if (frame_index - FIRST_FRAME_INDEX + 1 > context->seek_table.num_frames)
+		    context->seek_table.num_frames = frame_index - FIRST_FRAME_INDEX + 1;
+		}
+	      else
+		{
+		  /* the decoder's dts bookkeeping is off by its delay; it is seeked before stepping on */
+		  frame_index = next_entry.display_index;
+		  context->decoder_drained = FAS_TRUE;
+		}
+
+	      context->current_frame_index = frame_index;
+	      av_free_packet (&packet);
+	      private_frame_changed (context);
+	      return FAS_SUCCESS;
+	    }
+	}
+
+      av_free_packet (&packet);
+    }
+
+  /* no keyframe left: the video ends, as after stepping past its last frame */
+  context->current_frame_index = counting ? frame_index + 1 : context->seek_table.num_frames + FIRST_FRAME_INDEX;
+  context->is_frame_available  = FAS_FALSE;
+  if (counting && frame_index - FIRST_FRAME_INDEX + 1 > context->seek_table.num_frames)
+    context->seek_table.num_frames = frame_index - FIRST_FRAME_INDEX + 1;
+
+  return FAS_SUCCESS;
+}
+
+/* private_decode_key */
+static fas_boolean_type private_decode_key (fas_context_ref_type context, AVPacket *packet)
+{
+  int frameFinished = 0;
+
+  avcodec_flush_buffers (context->codec_context);
+  avcodec_decode_video (context->codec_context, context->frame_buffer, &frameFinished, packet->data, packet->size);
+  context->decoder_drained = FAS_FALSE;
+
+  /* a decoder that holds frames back gives the keyframe up when drained, and then needs a
+     seek before it can decode the frames after it */
+  if (!frameFinished)
+    {
+      avcodec_decode_video (context->codec_context, context->frame_buffer, &frameFinished, NULL, 0);
+      context->decoder_drained = FAS_TRUE;
+    }
+
+  return (frameFinished && context->frame_buffer->key_frame) ? FAS_TRUE : FAS_FALSE;
+}
+
+/* private_next_key_entry */
+static fas_boolean_type private_next_key_entry (fas_context_ref_type context, int frame_index, seek_entry_type *entry)
+{
+  /* the first entry after frame_index */
+  seek_table_type *table = &context->seek_table;
+  int lo = 0;
+  int hi = table->num_entries;
+
+  while (lo < hi)
+    {
+      int mid = lo + (hi - lo) / 2;
+      if (table->array[mid].display_index <= frame_index)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+
+  if (lo >= table->num_entries)
+    return FAS_FALSE;
+
+  *entry = table->array[lo];
+  return FAS_TRUE;
+}
+
+/* private_step_decoder */
+static fas_error_type private_step_decoder (fas_context_ref_type context)
+{
+  if ((NULL == context) || (FAS_TRUE != context->is_video_active)) {
+    return private_show_error (context, "invalid or unopened context", FAS_INVALID_ARGUMENT);
   }
   
   if (!context->is_frame_available)
     {
-      private_show_warning ("tried to advance after end of frames");
+      private_show_warning (context, "tried to advance after end of frames");
       return FAS_SUCCESS;
     }
 
@@ -358,9 +1064,17 @@ fas_error_type fas_step_forward (fas_context_ref_type context)
     {
       if (av_read_frame(context->format_context, &packet) < 0)
 	{
+	  /* frame threading holds the last frames in its pipeline until it is drained */
+	  if (context->frame_threads && private_drain_frame (context))
+	    {
+	      private_frame_changed (context);
+	      return FAS_SUCCESS;
+	    }
+
 	  /* finished */      
 	  context->is_frame_available = FAS_FALSE;
 	  context->seek_table.completed = seek_true;
+	  private_store_seek_table (context);
 	  return FAS_SUCCESS;
 	}
       
@@ -387,9 +1101,20 @@ fas_error_type fas_step_forward (fas_context_ref_type context)
 	      else
 		context->keyframe_packet_dts = context->previous_dts;
 	    }
+
+	  if (context->frame_threads)
+	    private_tag_packet (context, (packet.flags & PKT_FLAG_KEY) ? FAS_TRUE : FAS_FALSE);
 	  
 	  avcodec_decode_video(context->codec_context, context->frame_buffer, &frameFinished,
 			       packet.data, packet.size);	
+
+	  /* a skipped picture is not shown, but has its place in display order */
+	  if (!frameFinished && context->skipping_nonref && packet.size > 0)
+	    {
+	      if (context->current_frame_index - FIRST_FRAME_INDEX + 1 > context->seek_table.num_frames)
+		context->seek_table.num_frames = context->current_frame_index - FIRST_FRAME_INDEX + 1;
+	      break;
+	    }
 	  
 	  if (frameFinished)
 	    {
@@ -399,14 +1124,20 @@ fas_error_type fas_step_forward (fas_context_ref_type context)
 		  //		fprintf(stderr, "Frame : (PXX F%d: %lld %lld)\n", context->current_frame_index, packet.pts, packet.dts);
 		  
 		  seek_entry_type entry;
+		  fas_boolean_type is_known_key = FAS_TRUE;
 		  entry.display_index = context->current_frame_index;
 		  entry.first_packet_dts = context->keyframe_packet_dts;
 		  entry.last_packet_dts = packet.dts;
+
+		  /* the most recent key packet may be one that is still in the pipeline */
+		  if (context->frame_threads)
+		    is_known_key = private_key_packet_dts (context, &entry.first_packet_dts);
 		  
-		  if (fas_get_frame_index(context) == FIRST_FRAME_INDEX)
+		  if (context->current_frame_index == FIRST_FRAME_INDEX)
 		    entry.first_packet_dts = context->first_dts;
 		  
-		  seek_append_table_entry(&context->seek_table, entry);	     
+		  if (is_known_key)
+		    seek_append_table_entry(&context->seek_table, entry);	     
 		}
 	      
 	      if (context->current_frame_index - FIRST_FRAME_INDEX + 1 > context->seek_table.num_frames)
@@ -419,217 +1150,1467 @@ fas_error_type fas_step_forward (fas_context_ref_type context)
       av_free_packet(&packet);
     }
   
-  context->rgb_already_converted = FAS_FALSE;
-  context->gray8_already_converted = FAS_FALSE;
+  private_frame_changed (context);
   av_free_packet(&packet);
   return FAS_SUCCESS;
 }
 
-/* fas_get_frame_index */
-
-int fas_get_frame_index (fas_context_ref_type context)
+/* private_frame_changed */
+static void private_frame_changed (fas_context_ref_type context)
 {
-  if (NULL == context)
-    return private_show_error ("NULL context provided for fas_get_frame_index()", FAS_INVALID_ARGUMENT);
+  /* while read-ahead runs, the conversion buffers and the frame cache belong to the caller's
+     thread, and private_read_ahead_step takes care of both */
+  if (context->read_ahead_running)
+    return;
 
-  if (FAS_TRUE != context->is_video_active) 
-    return private_show_error ("No video is open for fas_get_frame_index()", FAS_INVALID_ARGUMENT);
-  
-  return context->current_frame_index;
+  context->rgb_already_converted = FAS_FALSE;
+  context->gray8_already_converted = FAS_FALSE;
+  context->frame_generation += 1;
+
+  if (context->is_frame_available)
+    private_cache_frame (context, context->frame_buffer, context->current_frame_index);
 }
 
+/* private_cache_frame */
+static void private_cache_frame (fas_context_ref_type context, AVFrame *frame, int frame_index)
+{
+  AVCodecContext *codec_context = context->codec_context;
+  frame_cache_entry_type *entry;
+  AVPicture picture;
+  int is_new;
 
-/* fas_get_frame */
+  if (context->frame_cache.max_bytes <= 0 || context->cache_paused)
+    return;
 
-fas_error_type fas_get_frame (fas_context_ref_type context, fas_raw_image_type *image_ptr)
+  int size = avpicture_get_size (codec_context->pix_fmt, codec_context->width, codec_context->height);
+  if (size <= 0)
+    return;
+
+  entry = frame_cache_insert (&context->frame_cache, frame_index, (size_t) size, &is_new);
+  if (NULL == entry || !is_new)
+    return;
+
+  avpicture_fill (&picture, entry->buffer, codec_context->pix_fmt, codec_context->width, codec_context->height);
+  av_picture_copy (&picture, (AVPicture *) frame, codec_context->pix_fmt, codec_context->width, codec_context->height);
+  entry->key_frame = frame->key_frame;
+}
+
+/* private_show_cached */
+static void private_show_cached (fas_context_ref_type context, frame_cache_entry_type *entry)
 {
-  int buffer_size;
+  AVCodecContext *codec_context = context->codec_context;
+
+  if (context->cache_shown)
+    context->cache_shown->pinned = 0;
+
+  entry->pinned = 1;
+  context->cache_shown = entry;
+
+  avpicture_fill ((AVPicture *) context->cache_frame, entry->buffer, codec_context->pix_fmt,
+		  codec_context->width, codec_context->height);
+  context->cache_frame->key_frame = entry->key_frame;
+
+  context->rgb_already_converted = FAS_FALSE;
+  context->gray8_already_converted = FAS_FALSE;
+  context->frame_generation += 1;
+}
+
+/* private_hide_cached */
+static void private_hide_cached (fas_context_ref_type context)
+{
+  /* the caller sees the decoder's (or read-ahead's) frame again */
+  if (NULL == context->cache_shown)
+    return;
+
+  context->cache_shown->pinned = 0;
+  context->cache_shown = NULL;
+
+  context->rgb_already_converted = FAS_FALSE;
+  context->gray8_already_converted = FAS_FALSE;
+  context->frame_generation += 1;
+}
+
+/* private_restore_cache_limit */
+static void private_restore_cache_limit (fas_context_ref_type context)
+{
+  /* the GOP buffer is only for going backwards: once the decoder moves on, the caller's limit
+     decides again what is cached (and whether non-reference pictures can be skipped) */
+  if (!context->cache_raised)
+    return;
+
+  context->cache_raised = FAS_FALSE;
+  if (context->cache_user_bytes <= 0)
+    frame_cache_release (&context->frame_cache);
+
+  frame_cache_set_limit (&context->frame_cache, context->cache_user_bytes);
+}
+
+/* private_step_from_cache */
+static fas_error_type private_step_from_cache (fas_context_ref_type context)
+{
+  /* keep serving from the cache while it has the next frame; otherwise bring the decoder to
+     the shown frame and step it from there */
+  int shown_index = context->cache_shown->frame_index;
+  frame_cache_entry_type *entry = frame_cache_lookup (&context->frame_cache, shown_index + 1);
+
+  if (entry)
+    {
+      private_show_cached (context, entry);
+      return FAS_SUCCESS;
+    }
+
+  private_hide_cached (context);
+
+  if (fas_get_frame_index (context) != shown_index)
+    {
+      fas_error_type fas_error = private_seek_decoder (context, shown_index);
+      if (fas_error != FAS_SUCCESS)
+	return private_show_error (context, "unable to resume decoding after cached frames", fas_error);
+    }
+
+  return fas_step_forward (context);
+}
+
+/* fas_step_backward */
+fas_error_type fas_step_backward (fas_context_ref_type context)
+{
+  seek_entry_type gop, previous_gop;
+  frame_cache_entry_type *entry;
   fas_error_type fas_error;
 
-  if (NULL == context || FAS_FALSE == context->is_video_active)
-    return private_show_error ("null context or inactive video", FAS_INVALID_ARGUMENT);
+  if ((NULL == context) || (FAS_TRUE != context->is_video_active))
+    return private_show_error (context, "invalid or unopened context", FAS_INVALID_ARGUMENT);
 
-  if (NULL == image_ptr)
-    return private_show_error ("null image_ptr on get_frame", FAS_INVALID_ARGUMENT);
+  int target_index = fas_get_frame_index (context) - 1;
+  if (target_index < FIRST_FRAME_INDEX)
+    return private_show_error (context, "no frame before the first frame", FAS_NO_MORE_FRAMES);
+
+  /* reading ahead is no use backwards, and the seek table is needed below */
+  private_stop_read_ahead (context);
+
+  if (seek_get_nearest_entry (&context->seek_table, &gop, target_index, 0) != seek_no_error)
+    return private_show_error (context, "no keyframe before the previous frame", FAS_SEEK_ERROR);
+
+  int previous_start = gop.display_index;
+  if (gop.display_index > FIRST_FRAME_INDEX &&
+      seek_get_nearest_entry (&context->seek_table, &previous_gop, gop.display_index - 1, 0) == seek_no_error)
+    previous_start = previous_gop.display_index;
+
+  /* the frame cache is the GOP buffer: room for this GOP up to the target, and the one before */
+  int frame_size = avpicture_get_size (context->codec_context->pix_fmt, context->codec_context->width,
+				       context->codec_context->height);
+  int64_t needed = (int64_t) (target_index - previous_start + 2) * frame_size;
+  if (context->frame_cache.max_bytes < needed)
+    {
+      if (!context->cache_raised)
+	{
+	  context->cache_user_bytes = context->frame_cache.max_bytes;
+	  context->cache_raised = FAS_TRUE;
+	}
+      frame_cache_set_limit (&context->frame_cache, needed);
+    }
+
+  if (context->prefetch_running && target_index >= context->prefetch_first && target_index <= context->prefetch_last)
+    private_finish_prefetch (context);
+
+  entry = frame_cache_lookup (&context->frame_cache, target_index);
+  if (entry)
+    private_show_cached (context, entry);
+  else
+    {
+      /* decodes (and caches) the GOP from its keyframe up to the target */
+      private_hide_cached (context);
+      fas_error = private_seek_decoder (context, target_index);
+      if (fas_error != FAS_SUCCESS)
+	return private_show_error (context, "unable to decode the previous frame", fas_error);
+    }
+
+  if (previous_start < gop.display_index && NULL == frame_cache_find (&context->frame_cache, gop.display_index - 1) &&
+      !(context->prefetch_running && context->prefetch_first == previous_start))
+    private_start_prefetch (context, previous_start, gop.display_index - 1);
+
+  return FAS_SUCCESS;
+}
+
+/* private_prefetch_thread */
+static void *private_prefetch_thread (void *arg)
+{
+  /* only touches the helper context, and reads the range set before it started */
+  fas_context_ref_type context = (fas_context_ref_type) arg;
+  fas_context_ref_type helper = context->prefetch_helper;
+
+  fas_error_type fas_error = fas_seek_to_frame (helper, context->prefetch_first);
+
+  /* the seek does not cache a frame the helper was already on */
+  if (FAS_SUCCESS == fas_error && NULL == helper->cache_shown && helper->is_frame_available)
+    private_cache_frame (helper, helper->frame_buffer, helper->current_frame_index);
+
+  while (FAS_SUCCESS == fas_error && fas_frame_available (helper) && fas_get_frame_index (helper) < context->prefetch_last)
+    fas_error = fas_step_forward (helper);
+
+  context->prefetch_error = fas_error;
+  return NULL;
+}
+
+/* private_start_prefetch */
+static void private_start_prefetch (fas_context_ref_type context, int first, int last)
+{
+  AVCodecContext *codec_context = context->codec_context;
+
+  /* a custom input can only be opened twice when it is in memory */
+  if (context->prefetch_failed || (NULL == context->file_path && NULL == custom_io_source (context->custom_io)->data))
+    return;
+
+  private_finish_prefetch (context);
+
+  if (NULL == context->prefetch_helper)
+    {
+      fas_open_options_type options = context->options;
+      options.read_ahead = 0;
+
+      fas_error_type fas_error = context->file_path
+	? fas_open_video_with_options (&context->prefetch_helper, context->file_path, options)
+	: fas_open_video_custom_io (&context->prefetch_helper, custom_io_source (context->custom_io), options);
+
+      if (FAS_SUCCESS != fas_error)
+	{
+	  private_show_warning (context, "unable to open a prefetch decoder, stepping backward without it");
+	  context->prefetch_helper = NULL;
+	  context->prefetch_failed = FAS_TRUE;
+	  return;
+	}
+    }
+
+  /* the helper seeks with the table this context has built so far */
+  if (context->prefetch_table_entries != context->seek_table.num_entries)
+    {
+      fas_put_seek_table (context->prefetch_helper, context->seek_table);
+      context->prefetch_table_entries = context->seek_table.num_entries;
+    }
+
+  int frame_size = avpicture_get_size (codec_context->pix_fmt, codec_context->width, codec_context->height);
+  frame_cache_set_limit (&context->prefetch_helper->frame_cache, (int64_t) (last - first + 2) * frame_size);
+
+  context->prefetch_first   = first;
+  context->prefetch_last    = last;
+  context->prefetch_error   = FAS_SUCCESS;
+  context->prefetch_running = FAS_TRUE;
+
+  if (pthread_create (&context->prefetch_thread, NULL, private_prefetch_thread, context) != 0)
+    {
+      private_show_warning (context, "unable to start prefetch thread");
+      context->prefetch_running = FAS_FALSE;
+    }
+}
+
+/* private_finish_prefetch */
+static void private_finish_prefetch (fas_context_ref_type context)
+{
+  /* waits for the helper and moves what it decoded (all of it, or up to a failure) over */
+  if (!context->prefetch_running)
+    return;
+
+  pthread_join (context->prefetch_thread, NULL);
+  context->prefetch_running = FAS_FALSE;
+
+  if (FAS_SUCCESS != context->prefetch_error)
+    private_show_warning (context, "prefetch of the previous GOP failed");
+
+  frame_cache_adopt (&context->frame_cache, &context->prefetch_helper->frame_cache);
+}
+
+/* private_shown_frame */
+static AVFrame *private_shown_frame (fas_context_ref_type context)
+{
+  if (context->cache_shown)
+    return context->cache_frame;
+
+  if (context->read_ahead_running)
+    return context->shown_slot->frame;
+
+  return context->frame_buffer;
+}
+
+/* private_alloc_read_ahead */
+static fas_error_type private_alloc_read_ahead (fas_context_ref_type context)
+{
+  int i;
+
+  if (context->read_ahead_ready)
+    return FAS_SUCCESS;
+
+  pthread_mutex_init (&context->read_ahead_lock, NULL);
+  pthread_mutex_init (&context->table_lock, NULL);
+  pthread_cond_init (&context->read_ahead_not_empty, NULL);
+  pthread_cond_init (&context->read_ahead_not_full, NULL);
+  context->read_ahead_ready = FAS_TRUE;   /* from here on private_free_read_ahead cleans up */
+
+  context->num_slots = context->options.read_ahead + 1;
+  context->slots = (read_ahead_slot_type *) malloc (context->num_slots * sizeof (read_ahead_slot_type));
+  if (NULL == context->slots)
+    {
+      private_free_read_ahead (context);
+      return private_show_error (context, "unable to allocate read-ahead slots", FAS_OUT_OF_MEMORY);
+    }
+  memset (context->slots, 0, context->num_slots * sizeof (read_ahead_slot_type));
+
+  for (i = 0; i < context->num_slots; i++)
+    {
+      context->slots[i].frame      = avcodec_alloc_frame ();
+      context->slots[i].rgb_frame  = avcodec_alloc_frame ();
+      context->slots[i].rgb_serial = -1;
+      if (NULL == context->slots[i].frame || NULL == context->slots[i].rgb_frame)
+	{
+	  private_free_read_ahead (context);
+	  return private_show_error (context, "unable to allocate read-ahead frames", FAS_OUT_OF_MEMORY);
+	}
+    }
+
+  return FAS_SUCCESS;
+}
+
+/* private_free_read_ahead */
+static void private_free_read_ahead (fas_context_ref_type context)
+{
+  int i;
+
+  if (!context->read_ahead_ready)
+    return;
+
+  for (i = 0; NULL != context->slots && i < context->num_slots; i++)
+    {
+      if (context->slots[i].frame)
+	av_free (context->slots[i].frame);
+      if (context->slots[i].buffer)
+	av_free (context->slots[i].buffer);
+      if (context->slots[i].rgb_frame)
+	av_free (context->slots[i].rgb_frame);
+      if (context->slots[i].rgb_buffer)
+	av_free (context->slots[i].rgb_buffer);
+    }
+  if (context->slots)
+    free (context->slots);
+  context->slots = NULL;
+
+  pthread_mutex_destroy (&context->read_ahead_lock);
+  pthread_mutex_destroy (&context->table_lock);
+  pthread_cond_destroy (&context->read_ahead_not_empty);
+  pthread_cond_destroy (&context->read_ahead_not_full);
+
+  context->read_ahead_ready = FAS_FALSE;
+}
+
+/* private_fill_slot */
+static fas_error_type private_fill_slot (fas_context_ref_type context, read_ahead_slot_type *slot, output_type *output)
+{
+  /* copies the decoder's frame and converts it to the output format, on the producer thread */
+  AVCodecContext *codec_context = context->codec_context;
+  int width  = codec_context->width;
+  int height = codec_context->height;
+
+  slot->frame_index        = context->current_frame_index;
+  slot->is_frame_available = context->is_frame_available;
+  slot->error              = FAS_SUCCESS;
+
+  if (!slot->is_frame_available)
+    return FAS_SUCCESS;
+
+  if (NULL == slot->buffer)
+    {
+      slot->buffer = (uint8_t *) av_malloc (avpicture_get_size (codec_context->pix_fmt, width, height));
+      if (NULL == slot->buffer)
+	return FAS_OUT_OF_MEMORY;
+      avpicture_fill ((AVPicture *) slot->frame, slot->buffer, codec_context->pix_fmt, width, height);
+    }
+
+  av_picture_copy ((AVPicture *) slot->frame, (AVPicture *) context->frame_buffer, codec_context->pix_fmt, width, height);
+  slot->frame->key_frame = context->frame_buffer->key_frame;
+  slot->frame->pict_type = context->frame_buffer->pict_type;
+
+  int rgb_size = avpicture_get_size (output->format, output->width, output->height);
+  slot->rgb_serial = -1;
+  if (NULL == slot->rgb_buffer || slot->rgb_size < rgb_size)
+    {
+      if (slot->rgb_buffer)
+	av_free (slot->rgb_buffer);
+      slot->rgb_size   = 0;
+      slot->rgb_buffer = (uint8_t *) av_malloc (rgb_size);
+      if (NULL == slot->rgb_buffer)
+	return FAS_OUT_OF_MEMORY;
+      slot->rgb_size = rgb_size;
+    }
+  avpicture_fill ((AVPicture *) slot->rgb_frame, slot->rgb_buffer, output->format, output->width, output->height);
+
+  /* on failure the caller's thread will retry (and report) the conversion */
+  if (FAS_SUCCESS == private_scale (context->producer_scalers, &context->next_producer_scaler, slot->frame, codec_context->pix_fmt,
+				    slot->rgb_frame, output))
+    slot->rgb_serial = output->serial;
+
+  return FAS_SUCCESS;
+}
+
+/* private_read_ahead_thread */
+static void *private_read_ahead_thread (void *arg)
+{
+  fas_context_ref_type context = (fas_context_ref_type) arg;
+  read_ahead_slot_type *slot;
+  fas_boolean_type finished = FAS_FALSE;
+
+  pthread_mutex_lock (&context->read_ahead_lock);
+  while (!finished)
+    {
+      while (context->slot_count == context->num_slots - 1 && !context->read_ahead_cancel)
+	pthread_cond_wait (&context->read_ahead_not_full, &context->read_ahead_lock);
+
+      if (context->read_ahead_cancel)
+	break;
+
+      /* only this thread changes slot_head + slot_count, and the shown slot is never in range */
+      slot = &context->slots[(context->slot_head + context->slot_count) % context->num_slots];
+      output_type output = context->output;
+      pthread_mutex_unlock (&context->read_ahead_lock);
+
+      pthread_mutex_lock (&context->table_lock);
+      fas_error_type fas_error = private_step_decoder (context);
+      pthread_mutex_unlock (&context->table_lock);
+
+      if (FAS_SUCCESS == fas_error)
+	fas_error = private_fill_slot (context, slot, &output);
+      else
+	slot->frame_index = context->current_frame_index;
+      slot->error = fas_error;
+
+      /* stop after the end of the video, or after a failure the caller has to see */
+      finished = (!slot->is_frame_available || FAS_SUCCESS != fas_error) ? FAS_TRUE : FAS_FALSE;
+
+      pthread_mutex_lock (&context->read_ahead_lock);
+      context->slot_count++;
+      context->queued_frame_index = slot->frame_index;
+      pthread_cond_signal (&context->read_ahead_not_empty);
+    }
+  pthread_mutex_unlock (&context->read_ahead_lock);
+
+  return NULL;
+}
+
+/* private_read_ahead_step */
+static fas_error_type private_read_ahead_step (fas_context_ref_type context)
+{
+  read_ahead_slot_type *slot;
+
+  if (!context->read_ahead_running)
+    {
+      if (!context->is_frame_available)
+	{
+	  private_show_warning (context, "tried to advance after end of frames");
+	  return FAS_SUCCESS;
+	}
+
+      if (FAS_SUCCESS != private_alloc_read_ahead (context))
+	return private_step_decoder (context);
+
+      context->slot_head          = 0;
+      context->slot_count         = 0;
+      context->read_ahead_cancel  = FAS_FALSE;
+      context->queued_frame_index = context->current_frame_index;
+
+      context->read_ahead_running = FAS_TRUE;
+      if (pthread_create (&context->read_ahead_thread, NULL, private_read_ahead_thread, context) != 0)
+	{
+	  context->read_ahead_running = FAS_FALSE;
+	  private_show_warning (context, "unable to start read-ahead thread, decoding on the caller's thread");
+	  return private_step_decoder (context);
+	}
+    }
+  else if (!context->shown_frame_available)
+    {
+      private_show_warning (context, "tried to advance after end of frames");
+      return FAS_SUCCESS;
+    }
+
+  pthread_mutex_lock (&context->read_ahead_lock);
+  while (context->slot_count == 0)
+    pthread_cond_wait (&context->read_ahead_not_empty, &context->read_ahead_lock);
+
+  slot = &context->slots[context->slot_head];
+  context->slot_head = (context->slot_head + 1) % context->num_slots;
+  context->slot_count--;
+  pthread_cond_signal (&context->read_ahead_not_full);
+  pthread_mutex_unlock (&context->read_ahead_lock);
+
+  context->shown_slot            = slot;
+  context->shown_frame_index     = slot->frame_index;
+  context->shown_frame_available = slot->is_frame_available;
+  context->rgb_already_converted   = FAS_FALSE;
+  context->gray8_already_converted = FAS_FALSE;
+  context->frame_generation += 1;
+
+  if (slot->is_frame_available && FAS_SUCCESS == slot->error)
+    private_cache_frame (context, slot->frame, slot->frame_index);
+
+  /* the producer stopped right after this slot, so the decoder state matches it */
+  if (FAS_SUCCESS != slot->error)
+    {
+      private_stop_read_ahead (context);
+      return private_show_error (context, "read-ahead decoding failed", slot->error);
+    }
+
+  return FAS_SUCCESS;
+}
+
+/* private_stop_read_ahead */
+static fas_error_type private_stop_read_ahead (fas_context_ref_type context)
+{
+  /* the decoder is left wherever the producer got to; callers seek it where they need it */
+  if (!context->read_ahead_running)
+    return FAS_SUCCESS;
+
+  pthread_mutex_lock (&context->read_ahead_lock);
+  context->read_ahead_cancel = FAS_TRUE;
+  pthread_cond_signal (&context->read_ahead_not_full);
+  pthread_mutex_unlock (&context->read_ahead_lock);
+
+  pthread_join (context->read_ahead_thread, NULL);
+
+  context->read_ahead_running      = FAS_FALSE;
+  context->rgb_already_converted   = FAS_FALSE;
+  context->gray8_already_converted = FAS_FALSE;
+  context->frame_generation += 1;
+
+  return FAS_SUCCESS;
+}
+
+/* fas_get_frame_index */
+
+int fas_get_frame_index (fas_context_ref_type context)
+{
+  if (NULL == context)
+    return private_show_error (context, "NULL context provided for fas_get_frame_index()", FAS_INVALID_ARGUMENT);
+
+  if (FAS_TRUE != context->is_video_active) 
+    return private_show_error (context, "No video is open for fas_get_frame_index()", FAS_INVALID_ARGUMENT);
+
+  if (context->cache_shown)
+    return context->cache_shown->frame_index;
+
+  if (context->read_ahead_running)
+    return context->shown_frame_index;
   
-  if (!fas_frame_available(context))
-    return private_show_error ("no frame available for extraction", FAS_NO_MORE_FRAMES);
+  return context->current_frame_index;
+}
+
+
+/* private_image_layout */
+static void private_image_layout (fas_context_ref_type context, fas_raw_image_type *image)
+{
+  /* the size and colour space of fas_get_frame's images, packed rows */
+  memset (image, 0, sizeof (fas_raw_image_type));
 
-  memset (image_ptr, 0, sizeof (fas_raw_image_type));
+  int width = context->output.width;
 
-  switch (fmt)
+  switch (context->output.format)
   {
+  case PIX_FMT_GRAY8:
+	  image->bytes_per_line = width;
+	  image->color_space    = FAS_GRAY8;
+	  break;
   case PIX_FMT_RGB24:
-	  image_ptr->bytes_per_line = context->codec_context->width * 3;
-	  image_ptr->color_space    = FAS_RGB24;
+	  image->bytes_per_line = width * 3;
+	  image->color_space    = FAS_RGB24;
 	  break;
   case PIX_FMT_BGR24:
-	  image_ptr->bytes_per_line = context->codec_context->width * 3;
-	  image_ptr->color_space    = FAS_BGR24;
+	  image->bytes_per_line = width * 3;
+	  image->color_space    = FAS_BGR24;
 	  break;
   case PIX_FMT_ARGB:
-	  image_ptr->bytes_per_line = context->codec_context->width * 4;
-	  image_ptr->color_space    = FAS_ARGB32;
+	  image->bytes_per_line = width * 4;
+	  image->color_space    = FAS_ARGB32;
 	  break;
   case PIX_FMT_ABGR:
-	  image_ptr->bytes_per_line = context->codec_context->width * 4;
-	  image_ptr->color_space    = FAS_ABGR32;
+	  image->bytes_per_line = width * 4;
+	  image->color_space    = FAS_ABGR32;
 	  break;
   case PIX_FMT_YUV420P:
-	  image_ptr->bytes_per_line = (context->codec_context->width * 3) >> 1;
-	  image_ptr->color_space    = FAS_YUV420P;
+	  image->bytes_per_line = (width * 3) >> 1;
+	  image->color_space    = FAS_YUV420P;
 	  break;
   case PIX_FMT_YUYV422:
-	  image_ptr->bytes_per_line = context->codec_context->width * 2;
-	  image_ptr->color_space    = FAS_YUYV422;
+	  image->bytes_per_line = width * 2;
+	  image->color_space    = FAS_YUYV422;
 	  break;
   case PIX_FMT_UYVY422:
-	  image_ptr->bytes_per_line = context->codec_context->width * 2;
-	  image_ptr->color_space    = FAS_UYVY422;
+	  image->bytes_per_line = width * 2;
+	  image->color_space    = FAS_UYVY422;
 	  break;
   case PIX_FMT_YUV422P:
-	  image_ptr->bytes_per_line = context->codec_context->width * 2;
-	  image_ptr->color_space    = FAS_YUV422P;
+	  image->bytes_per_line = width * 2;
+	  image->color_space    = FAS_YUV422P;
 	  break;
   case PIX_FMT_YUV444P:
-	  image_ptr->bytes_per_line = context->codec_context->width * 3;
-	  image_ptr->color_space    = FAS_YUV444P;
+	  image->bytes_per_line = width * 3;
+	  image->color_space    = FAS_YUV444P;
 	  break;
   }
 
-  buffer_size = image_ptr->bytes_per_line * context->codec_context->height;
+  image->width  = context->output.width;
+  image->height = context->output.height;
+}
+
+/* private_copy_frame */
+static fas_error_type private_copy_frame (fas_context_ref_type context, fas_raw_image_type *image, int row_bytes)
+{
+  fas_error_type fas_error;
+
+  /* read-ahead slots arrive converted, unless the output format or geometry changed since */
+  AVFrame *rgb_frame = context->rgb_frame_buffer;
+  if (!context->cache_shown && context->read_ahead_running && context->shown_slot->rgb_serial == context->output.serial)
+    {
+      rgb_frame = context->shown_slot->rgb_frame;
+      fas_error = FAS_SUCCESS;
+    }
+  else
+    fas_error = private_convert_to_rgb(context);
+
+  if (FAS_SUCCESS != fas_error)
+    return private_show_error (context, "unable to convert image to RGB", FAS_FAILURE);
+
+  pixel_copy_plane (image->data, image->bytes_per_line, rgb_frame->data[0], rgb_frame->linesize[0], row_bytes, image->height);
+
+  return FAS_SUCCESS;
+}
+
+/* fas_get_frame */
+
+fas_error_type fas_get_frame (fas_context_ref_type context, fas_raw_image_type *image_ptr)
+{
+  int buffer_size;
+
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return private_show_error (context, "null context or inactive video", FAS_INVALID_ARGUMENT);
+
+  if (NULL == image_ptr)
+    return private_show_error (context, "null image_ptr on get_frame", FAS_INVALID_ARGUMENT);
+  
+  if (!fas_frame_available(context))
+    return private_show_error (context, "no frame available for extraction", FAS_NO_MORE_FRAMES);
+
+  private_image_layout (context, image_ptr);
 
-  image_ptr->data = (unsigned char *)malloc (buffer_size);
+  buffer_size = image_ptr->bytes_per_line * image_ptr->height;
+
+  image_ptr->data = private_alloc_image (buffer_size);
   if (NULL == image_ptr->data)
-    return private_show_error ("unable to allocate space for RGB image", FAS_OUT_OF_MEMORY);
+    return private_show_error (context, "unable to allocate space for RGB image", FAS_OUT_OF_MEMORY);
+
+  fas_error_type fas_error = private_copy_frame (context, image_ptr, image_ptr->bytes_per_line);
+  if (FAS_SUCCESS != fas_error)
+    {
+      fas_free_frame (*image_ptr);
+      image_ptr->data = NULL;
+    }
+
+  return fas_error;
+}
+
+/* private_alloc_image */
+
+static unsigned char *private_alloc_image (int size)
+{
+  /* pooled buffers go back to the pool in fas_free_frame */
+  unsigned char *data;
+
+  pthread_mutex_lock (&gbl_pool_lock);
+  if (gbl_image_pool.max_idle > 0)
+    data = (unsigned char *) image_pool_get (&gbl_image_pool, size);
+  else
+    data = (unsigned char *) malloc (size);
+  pthread_mutex_unlock (&gbl_pool_lock);
+
+  return data;
+}
+
+/* fas_get_frames */
+
+fas_error_type fas_get_frames (fas_context_ref_type context, const int *indices, int n, fas_raw_image_type *images)
+{
+  /* visiting the frames in display order lets private_seek_decoder decode forward within a
+     GOP (its keyframe is never past the current frame), so each GOP is decoded at most once */
+  frame_request_type *requests;
+  fas_error_type fas_error = FAS_SUCCESS;
+  int i;
+
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return private_show_error (context, "null context or inactive video", FAS_INVALID_ARGUMENT);
+
+  if (n < 0 || (n > 0 && (NULL == indices || NULL == images)))
+    return private_show_error (context, "invalid frame request", FAS_INVALID_ARGUMENT);
+
+  if (0 == n)
+    return FAS_SUCCESS;
+
+  requests = (frame_request_type *) malloc (n * sizeof (frame_request_type));
+  if (NULL == requests)
+    return private_show_error (context, "unable to allocate frame requests", FAS_OUT_OF_MEMORY);
+
+  for (i = 0; i < n; i++)
+    {
+      requests[i].frame_index = indices[i];
+      requests[i].position    = i;
+      images[i].data          = NULL;
+    }
+  qsort (requests, n, sizeof (frame_request_type), private_compare_requests);
+
+  for (i = 0; i < n && FAS_SUCCESS == fas_error; i++)
+    {
+      fas_raw_image_type *image = &images[requests[i].position];
+
+      /* a frame asked for more than once is converted once and copied */
+      if (i > 0 && requests[i].frame_index == requests[i - 1].frame_index)
+	{
+	  fas_raw_image_type *first = &images[requests[i - 1].position];
+	  int size = first->bytes_per_line * first->height;
+
+	  *image = *first;
+	  image->data = private_alloc_image (size);
+	  if (NULL == image->data)
+	    fas_error = private_show_error (context, "unable to allocate space for RGB image", FAS_OUT_OF_MEMORY);
+	  else
+	    memcpy (image->data, first->data, size);
+	  continue;
+	}
+
+      fas_error = fas_seek_to_frame (context, requests[i].frame_index);
+      if (FAS_SUCCESS == fas_error)
+	fas_error = fas_get_frame (context, image);
+    }
+
+  if (FAS_SUCCESS != fas_error)
+    for (i = 0; i < n; i++)
+      {
+	fas_free_frame (images[i]);
+	images[i].data = NULL;
+      }
+
+  free (requests);
+  return fas_error;
+}
+
+/* private_compare_requests */
+
+static int private_compare_requests (const void *a, const void *b)
+{
+  const frame_request_type *first  = (const frame_request_type *) a;
+  const frame_request_type *second = (const frame_request_type *) b;
+
+  if (first->frame_index != second->frame_index)
+    return (first->frame_index < second->frame_index) ? -1 : 1;
+
+  return first->position - second->position;
+}
+
+/* fas_get_frame_into */
+
+fas_error_type fas_get_frame_into (fas_context_ref_type context, fas_raw_image_type *image_ptr)
+{
+  fas_raw_image_type layout;
+
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return private_show_error (context, "null context or inactive video", FAS_INVALID_ARGUMENT);
+
+  if (NULL == image_ptr || NULL == image_ptr->data)
+    return private_show_error (context, "null image_ptr or image data on get_frame_into", FAS_INVALID_ARGUMENT);
+  
+  if (!fas_frame_available(context))
+    return private_show_error (context, "no frame available for extraction", FAS_NO_MORE_FRAMES);
+
+  private_image_layout (context, &layout);
+
+  if (image_ptr->width != layout.width || image_ptr->height != layout.height)
+    return private_show_error (context, "caller's image is not the size of the video", FAS_INVALID_ARGUMENT);
+
+  if (0 == image_ptr->bytes_per_line)
+    image_ptr->bytes_per_line = layout.bytes_per_line;
+
+  if (image_ptr->bytes_per_line < layout.bytes_per_line)
+    return private_show_error (context, "caller's image rows are too short", FAS_INVALID_ARGUMENT);
+
+  image_ptr->color_space = layout.color_space;
+
+  return private_copy_frame (context, image_ptr, layout.bytes_per_line);
+}
+
+/* fas_free_frame */
+
+void fas_free_frame (fas_raw_image_type image)
+{
+  if (NULL == image.data) 
+    return;
+  
+  /* images from before the pool was turned on were malloc'ed */
+  pthread_mutex_lock (&gbl_pool_lock);
+  int pooled = image_pool_put (&gbl_image_pool, image.data);
+  pthread_mutex_unlock (&gbl_pool_lock);
+
+  if (!pooled)
+    free (image.data);
+  
+  return;
+}
+
+/* fas_set_frame_pool */
+
+void fas_set_frame_pool (int max_buffers)
+{
+  pthread_mutex_lock (&gbl_pool_lock);
+  image_pool_set_limit (&gbl_image_pool, max_buffers);
+  pthread_mutex_unlock (&gbl_pool_lock);
+}
+
+/* fas_get_frame_pool_stats */
+
+void fas_get_frame_pool_stats (fas_frame_pool_stats_type *stats)
+{
+  if (NULL == stats)
+    return;
+
+  pthread_mutex_lock (&gbl_pool_lock);
+  stats->allocations = gbl_image_pool.allocations;
+  stats->reuses      = gbl_image_pool.reuses;
+  stats->idle        = gbl_image_pool.num_idle;
+  stats->lent        = gbl_image_pool.num_lent;
+  pthread_mutex_unlock (&gbl_pool_lock);
+}
+
+/* private_color_space */
+static fas_boolean_type private_color_space (enum PixelFormat format, fas_color_space_type *color_space)
+{
+  switch (format)
+    {
+    case PIX_FMT_GRAY8:    *color_space = FAS_GRAY8;    break;
+    case PIX_FMT_RGB24:    *color_space = FAS_RGB24;    break;
+    case PIX_FMT_BGR24:    *color_space = FAS_BGR24;    break;
+    case PIX_FMT_ARGB:     *color_space = FAS_ARGB32;   break;
+    case PIX_FMT_ABGR:     *color_space = FAS_ABGR32;   break;
+    case PIX_FMT_YUYV422:  *color_space = FAS_YUYV422;  break;
+    case PIX_FMT_UYVY422:  *color_space = FAS_UYVY422;  break;
+    case PIX_FMT_YUV420P:
+    case PIX_FMT_YUVJ420P: *color_space = FAS_YUV420P;  break;
+    case PIX_FMT_YUV422P:
+    case PIX_FMT_YUVJ422P: *color_space = FAS_YUV422P;  break;
+    case PIX_FMT_YUV444P:
+    case PIX_FMT_YUVJ444P: *color_space = FAS_YUV444P;  break;
+    default:
+      return FAS_FALSE;
+    }
+
+  return FAS_TRUE;
+}
+
+/* private_fill_view */
+static fas_error_type private_fill_view (fas_context_ref_type context, AVFrame *frame, enum PixelFormat format,
+					 int width, int height, fas_frame_view_type *view)
+{
+  int plane;
+
+  memset (view, 0, sizeof (fas_frame_view_type));
+
+  if (!private_color_space (format, &view->color_space))
+    return private_show_error (context, "frame format has no fas color space", FAS_UNSUPPORTED_FORMAT);
+
+  for (plane = 0; plane < 4; plane++)
+    {
+      view->data[plane]     = frame->data[plane];
+      view->linesize[plane] = frame->linesize[plane];
+    }
+
+  view->width      = width;
+  view->height     = height;
+  view->generation = context->frame_generation;
+
+  return FAS_SUCCESS;
+}
+
+/* fas_get_frame_view */
+fas_error_type fas_get_frame_view (fas_context_ref_type context, fas_frame_view_type *view)
+{
+  fas_error_type fas_error;
+
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return private_show_error (context, "null context or inactive video", FAS_INVALID_ARGUMENT);
+
+  if (NULL == view)
+    return private_show_error (context, "null view on get_frame_view", FAS_INVALID_ARGUMENT);
+
+  if (!fas_frame_available (context))
+    return private_show_error (context, "no frame available for a view", FAS_NO_MORE_FRAMES);
+
+  output_type *output = &context->output;
+
+  /* the decoder's own planes when they are already in the output format, uncropped */
+  if (context->codec_context->pix_fmt == output->format && private_is_whole_frame (context))
+    return private_fill_view (context, private_shown_frame (context), output->format, output->width, output->height, view);
+
+  if (!context->cache_shown && context->read_ahead_running && context->shown_slot->rgb_serial == output->serial)
+    return private_fill_view (context, context->shown_slot->rgb_frame, output->format, output->width, output->height, view);
+
+  fas_error = private_convert_to_rgb (context);
+  if (FAS_SUCCESS != fas_error)
+    return private_show_error (context, "unable to convert image for view", fas_error);
+
+  return private_fill_view (context, context->rgb_frame_buffer, output->format, output->width, output->height, view);
+}
 
-  image_ptr->width          = context->codec_context->width;
-  image_ptr->height         = context->codec_context->height;
+/* fas_get_decoded_view */
+fas_error_type fas_get_decoded_view (fas_context_ref_type context, fas_frame_view_type *view)
+{
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return private_show_error (context, "null context or inactive video", FAS_INVALID_ARGUMENT);
+
+  if (NULL == view)
+    return private_show_error (context, "null view on get_decoded_view", FAS_INVALID_ARGUMENT);
+
+  if (!fas_frame_available (context))
+    return private_show_error (context, "no frame available for a view", FAS_NO_MORE_FRAMES);
+
+  return private_fill_view (context, private_shown_frame (context), context->codec_context->pix_fmt,
+			    context->codec_context->width, context->codec_context->height, view);
+}
+
+/* fas_get_seek_table */ 
+seek_table_type fas_get_seek_table (fas_context_ref_type context)
+{
+  seek_table_type null_table;
+
+  null_table.array = NULL;
+  null_table.completed = seek_false;
+  null_table.num_frames = -1;
+  null_table.num_entries = 0;
+  null_table.allocated_size = 0;
+  null_table.search = seek_search_binary;
+  null_table.mapped_base = NULL;
+  null_table.mapped_size = 0;
+
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return null_table;
+
+  /* the returned table shares its array with the context, which the producer grows (and may
+     move) as it decodes, so read-ahead stops here and restarts on the next step */
+  if (context->read_ahead_running)
+    {
+      int current_frame = fas_get_frame_index (context);
+      fas_boolean_type was_available = fas_frame_available (context);
+
+      private_stop_read_ahead (context);
+      if (was_available && FAS_SUCCESS != fas_seek_to_frame (context, current_frame))
+	private_show_warning (context, "unable to return to the current frame after stopping read-ahead");
+    }
 
+  return context->seek_table;
+}
+
+/* fas_put_seek_table */  
+fas_error_type fas_put_seek_table (fas_context_ref_type context, seek_table_type table)
+{
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return private_show_error (context, "null context or inactive video", FAS_INVALID_ARGUMENT);
+  
+  if (context->read_ahead_running)
+    pthread_mutex_lock (&context->table_lock);
+
+  seek_release_table (&context->seek_table);
+  context->seek_table = seek_copy_table(table);
+  context->seek_table_stored = FAS_TRUE;  /* tables from the caller are not published to the cache */
+
+  if (context->read_ahead_running)
+    pthread_mutex_unlock (&context->table_lock);
   
-  fas_error = private_convert_to_rgb(context);
+  return FAS_SUCCESS;
+}
+
+/* private_store_seek_table */
+static void private_store_seek_table (fas_context_ref_type context)
+{
+  if (NULL == context->cache_dir || context->seek_table_stored || context->seek_table.completed != seek_true)
+    return;
+
+  context->seek_table_stored = FAS_TRUE;
+  if (seek_cache_store (context->cache_dir, context->file_path, context->frame_threads ? context->cache_variant : NULL,
+			context->seek_table, context->cache_max_bytes) != seek_no_error)
+    private_show_warning (context, "unable to store seek table in cache");
+}
+ 
+/* fas_set_frame_cache */
+fas_error_type fas_set_frame_cache (fas_context_ref_type context, long long max_bytes)
+{
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return private_show_error (context, "null context or inactive video", FAS_INVALID_ARGUMENT);
+
+  if (max_bytes <= 0 && context->cache_shown)
+    {
+      /* the decoder has to take over the frame the caller is looking at */
+      int shown_index = context->cache_shown->frame_index;
+      private_hide_cached (context);
+      if (FAS_SUCCESS != private_seek_decoder (context, shown_index))
+	private_show_warning (context, "unable to return to the cached frame being shown");
+    }
+
+  if (max_bytes <= 0)
+    frame_cache_release (&context->frame_cache);
+
+  context->cache_raised = FAS_FALSE;
+  frame_cache_set_limit (&context->frame_cache, (int64_t) max_bytes);
+  return FAS_SUCCESS;
+}
+
+/* fas_get_frame_cache_stats */
+fas_error_type fas_get_frame_cache_stats (fas_context_ref_type context, fas_frame_cache_stats_type *stats)
+{
+  if (NULL == context || FAS_FALSE == context->is_video_active || NULL == stats)
+    return private_show_error (context, "null context, inactive video or null stats", FAS_INVALID_ARGUMENT);
+
+  stats->hits       = context->frame_cache.hits;
+  stats->misses     = context->frame_cache.misses;
+  stats->num_frames = context->frame_cache.num_entries;
+  stats->bytes      = context->frame_cache.bytes;
+
+  return FAS_SUCCESS;
+}
+
+/* fas_set_index_mode */
+fas_error_type fas_set_index_mode (fas_context_ref_type context, fas_index_mode_type mode)
+{
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return private_show_error (context, "null context or inactive video", FAS_INVALID_ARGUMENT);
+
+  context->index_mode = mode;
+  return FAS_SUCCESS;
+}
+
+/* private_complete_seek_table */
+fas_error_type private_complete_seek_table (fas_context_ref_type context)
+{
+  if ((NULL == context) || (FAS_FALSE == context->is_video_active))
+    return private_show_error (context, "invalid or unopened context", FAS_INVALID_ARGUMENT);
+
+  if (context->seek_table.completed)
+    return FAS_SUCCESS;
+
+  /* the packet scan runs on its own demuxer, so this context keeps its position. its tables
+     assume no decoder delay, which frame threading adds */
+  if (context->index_mode == FAS_INDEX_PACKETS && context->frame_threads)
+    private_show_warning (context, "packet indexing does not apply with frame threading, decoding instead");
+  else if (context->index_mode == FAS_INDEX_PACKETS && NULL == context->file_path)
+    private_show_warning (context, "packet indexing needs a file, decoding instead");
+  else if (context->index_mode == FAS_INDEX_PACKETS)
+    {
+      seek_table_type table;
+      if (fas_build_seek_table (context->file_path, FAS_INDEX_PACKETS, &table) == FAS_SUCCESS)
+	{
+	  seek_release_table (&context->seek_table);
+	  context->seek_table = table;
+	  private_store_seek_table (context);
+	  return FAS_SUCCESS;
+	}
+      private_show_warning (context, "packet indexing not possible for this video, decoding instead");
+    }
+
+  /* a scan to the end would only flush the frame cache */
+  context->cache_paused = FAS_TRUE;
+
+  fas_error_type fas_error = fas_seek_to_nearest_key (context, context->seek_table.num_frames + FIRST_FRAME_INDEX - 1);
+  if (FAS_SUCCESS != fas_error)
+    {
+      context->cache_paused = FAS_FALSE;
+      return private_show_error(context, "failed when trying to complete seek table (1) (first frame not labeled keyframe?)", fas_error);
+    }
 
-  int j;
-  unsigned char *from;
-  unsigned char *to;
-  for (j=0;j<context->codec_context->height; j++)
+  while (fas_frame_available(context))
     {
-      from = context->rgb_frame_buffer->data[0] + j*context->rgb_frame_buffer->linesize[0];
-      to = image_ptr->data + j*image_ptr->bytes_per_line;
-      
-      memcpy(to, from, image_ptr->bytes_per_line);
+      //      printf("%d\n", context->seek_table.num_frames);
+      private_step_decoder(context);
     }
 
-  if (FAS_SUCCESS != fas_error)
-    return private_show_error ("unable to convert image to RGB", FAS_FAILURE);
+  context->cache_paused = FAS_FALSE;
+
+  if (!context->seek_table.completed)
+    return private_show_error(context, "failed when trying to complete seek table (2)", FAS_SEEK_ERROR);
 
   return FAS_SUCCESS;
 }
 
-/* fas_free_frame */
+/* private_configure_threads */
+static void private_configure_threads (fas_context_ref_type context)
+{
+  fas_open_options_type *options = &context->options;
 
-void fas_free_frame (fas_raw_image_type image)
+  if (options->thread_count <= 1 || !options->thread_type)
+    return;
+
+#ifdef FF_THREAD_FRAME
+  context->codec_context->thread_count = options->thread_count;
+  context->codec_context->thread_type  = 0;
+  if (options->thread_type & FAS_THREAD_FRAME)
+    context->codec_context->thread_type |= FF_THREAD_FRAME;
+  if (options->thread_type & FAS_THREAD_SLICE)
+    context->codec_context->thread_type |= FF_THREAD_SLICE;
+#else
+  /* older libavcodec only splits slices across threads */
+  if (options->thread_type & FAS_THREAD_SLICE)
+    avcodec_thread_init (context->codec_context, options->thread_count);
+  else
+    private_show_warning (context, "frame threading not supported by this libavcodec, decoding on one thread");
+#endif
+}
+
+/* private_configure_lowres */
+static void private_configure_lowres (fas_context_ref_type context)
 {
-  if (NULL == image.data) 
+  /* libavcodec does not say which decoders can skip the high frequencies (and a decoder that
+     cannot would still produce full frames into shrunken dimensions), so only these get it */
+  static const enum CodecID lowres_codecs[] =
+    {
+      CODEC_ID_MPEG1VIDEO, CODEC_ID_MPEG2VIDEO, CODEC_ID_MPEG4, CODEC_ID_H263, CODEC_ID_H263P, CODEC_ID_H263I,
+      CODEC_ID_FLV1, CODEC_ID_MSMPEG4V1, CODEC_ID_MSMPEG4V2, CODEC_ID_MSMPEG4V3, CODEC_ID_WMV1, CODEC_ID_WMV2,
+      CODEC_ID_MJPEG
+    };
+  int i;
+
+  if (context->options.lowres <= 0)
     return;
-  
-  free (image.data);
-  
-  return;
+
+  for (i = 0; i < (int) (sizeof (lowres_codecs) / sizeof (lowres_codecs[0])); i++)
+    if (context->codec_context->codec_id == lowres_codecs[i])
+      {
+	/* avcodec_open shrinks width and height to match */
+	context->codec_context->lowres = context->options.lowres;
+	return;
+      }
+
+  private_show_warning (context, "reduced resolution decoding not supported by this codec, decoding full frames");
 }
 
-/* fas_get_seek_table */ 
-seek_table_type fas_get_seek_table (fas_context_ref_type context)
+/* private_tag_packet */
+static void private_tag_packet (fas_context_ref_type context, fas_boolean_type is_key)
 {
-  seek_table_type null_table;
+#ifdef FF_THREAD_FRAME
+  if (is_key)
+    {
+      key_packet_type *key = &context->key_packets[context->packet_sequence % KEY_PACKET_RING];
+      key->sequence = context->packet_sequence;
+      key->seek_dts = context->keyframe_packet_dts;
+    }
 
-  null_table.array = NULL;
-  null_table.completed = seek_false;
-  null_table.num_frames = -1;
-  null_table.num_entries = 0;
-  null_table.allocated_size = 0;
+  context->codec_context->reordered_opaque = context->packet_sequence++;
+#endif
+}
 
-  if (NULL == context || FAS_FALSE == context->is_video_active)
-    return null_table;
-    
-  return context->seek_table;
+/* private_key_packet_dts */
+static fas_boolean_type private_key_packet_dts (fas_context_ref_type context, int64_t *seek_dts)
+{
+  /* FAS_FALSE when the frame's key packet has already left the ring (or the frame was not
+     started by a key packet); such keyframes are left out of the table */
+#ifdef FF_THREAD_FRAME
+  int64_t sequence = context->frame_buffer->reordered_opaque;
+  key_packet_type *key;
+
+  if (sequence < 0 || sequence >= context->packet_sequence)
+    return FAS_FALSE;
+
+  key = &context->key_packets[sequence % KEY_PACKET_RING];
+  if (key->sequence != sequence)
+    return FAS_FALSE;
+
+  *seek_dts = key->seek_dts;
+  return FAS_TRUE;
+#else
+  return FAS_FALSE;
+#endif
 }
 
-/* fas_put_seek_table */  
-fas_error_type fas_put_seek_table (fas_context_ref_type context, seek_table_type table)
+/* private_drain_frame */
+static fas_boolean_type private_drain_frame (fas_context_ref_type context)
 {
-  if (NULL == context || FAS_FALSE == context->is_video_active)
-    return private_show_error ("null context or inactive video", FAS_INVALID_ARGUMENT);
-  
-  seek_release_table (&context->seek_table);
-  context->seek_table = seek_copy_table(table);
-  
-  return FAS_SUCCESS;
+  /* frames drained after the last packet get no seek entries: they all share its dts, so
+     they are reached by stepping forward from an earlier keyframe */
+  int frameFinished = 0;
+
+  avcodec_decode_video(context->codec_context, context->frame_buffer, &frameFinished, NULL, 0);
+  if (!frameFinished)
+    return FAS_FALSE;
+
+  if (context->current_frame_index - FIRST_FRAME_INDEX + 1 > context->seek_table.num_frames)
+    context->seek_table.num_frames = context->current_frame_index - FIRST_FRAME_INDEX + 1;
+
+  return FAS_TRUE;
 }
- 
-/* private_complete_seek_table */
-fas_error_type private_complete_seek_table (fas_context_ref_type context)
+
+/* fas_seek_to_frame */
+fas_error_type fas_seek_to_frame (fas_context_ref_type context, int target_index)
 {
   if ((NULL == context) || (FAS_FALSE == context->is_video_active))
-    return private_show_error ("invalid or unopened context", FAS_INVALID_ARGUMENT);
+    return private_show_error (context, "invalid or unopened context", FAS_INVALID_ARGUMENT);
 
-  if (context->seek_table.completed)
+  if (context->cache_shown && context->cache_shown->frame_index == target_index)
     return FAS_SUCCESS;
 
-  fas_error_type fas_error = fas_seek_to_nearest_key (context, context->seek_table.num_frames + FIRST_FRAME_INDEX - 1);
-  if (FAS_SUCCESS != fas_error)
-    return private_show_error("failed when trying to complete seek table (1) (first frame not labeled keyframe?)", fas_error);
-
-  while (fas_frame_available(context))
+  /* cached frames are shown without touching the demuxer or decoder */
+  if (context->frame_cache.max_bytes > 0 && fas_get_frame_index (context) != target_index)
     {
-      //      printf("%d\n", context->seek_table.num_frames);
-      fas_step_forward(context);
+      frame_cache_entry_type *entry = frame_cache_lookup (&context->frame_cache, target_index);
+      if (entry)
+	{
+	  private_show_cached (context, entry);
+	  return FAS_SUCCESS;
+	}
     }
 
-  if (!context->seek_table.completed)
-    return private_show_error("failed when trying to complete seek table (2)", FAS_SEEK_ERROR);
+  private_hide_cached (context);
+  private_restore_cache_limit (context);
 
-  return FAS_SUCCESS;
+  return private_seek_decoder (context, target_index);
 }
 
-/* fas_seek_to_frame */
-fas_error_type fas_seek_to_frame (fas_context_ref_type context, int target_index)
+/* private_seek_decoder */
+static fas_error_type private_seek_decoder (fas_context_ref_type context, int target_index)
 {
 
   fas_error_type fas_error;
 
-  if ((NULL == context) || (FAS_FALSE == context->is_video_active))
-    return private_show_error ("invalid or unopened context", FAS_INVALID_ARGUMENT);
+  /* frames already read ahead are popped; anything else stops the producer and seeks */
+  if (context->read_ahead_running)
+    {
+      pthread_mutex_lock (&context->read_ahead_lock);
+      fas_boolean_type is_queued = (target_index >= context->shown_frame_index &&
+				    target_index <= context->queued_frame_index) ? FAS_TRUE : FAS_FALSE;
+      pthread_mutex_unlock (&context->read_ahead_lock);
+
+      while (is_queued && context->read_ahead_running && context->shown_frame_index < target_index)
+	{
+	  fas_error = private_read_ahead_step (context);
+	  if (fas_error != FAS_SUCCESS)
+	    return private_show_error (context, "error advancing through read-ahead frames", fas_error);
+	}
+
+      if (fas_get_frame_index(context) == target_index)
+	return FAS_SUCCESS;
+
+      private_stop_read_ahead (context);
+    }
 
   //  printf("seeking to %d (from %d)!\n", target_index, context->current_frame_index);
   if (target_index == context->current_frame_index)
     return FAS_SUCCESS;
 
-  fas_error = fas_seek_to_nearest_key (context, target_index); 
+  int64_t start;
+  if (private_prefer_forward (context, target_index))
+    context->seek_stats.forward_seeks++;
+  else
+    {
+      context->seek_stats.keyframe_seeks++;
+
+      start = av_gettime ();
+      fas_error = fas_seek_to_nearest_key (context, target_index); 
 
-  if (fas_error != FAS_SUCCESS)
-    return private_show_error ("error advancing to key frame before seek", fas_error);
+      if (fas_error != FAS_SUCCESS)
+	return private_show_error (context, "error advancing to key frame before seek", fas_error);
+      private_update_cost (&context->seek_stats.seek_usec, av_gettime () - start);
+    }
 
   if (fas_get_frame_index(context) > target_index)
-    return private_show_error ("error advancing to key frame before seek (index isn't right)", fas_error);
+    return private_show_error (context, "error advancing to key frame before seek (index isn't right)", FAS_SEEK_ERROR);
+
+  /* frames before the target are never shown, so pictures nothing refers to need not be decoded */
+  fas_boolean_type can_skip = private_can_skip_nonref (context);
  
   while (fas_get_frame_index(context) < target_index)
     {
       if (fas_frame_available(context))
-	fas_step_forward(context);
+	{
+	  context->skipping_nonref = (can_skip && fas_get_frame_index(context) + 1 < target_index) ? FAS_TRUE : FAS_FALSE;
+	  context->codec_context->skip_frame = context->skipping_nonref ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+
+	  start = av_gettime ();
+	  private_step_decoder(context);
+	  private_update_cost (&context->seek_stats.frame_usec, av_gettime () - start);
+	  context->seek_stats.frames_decoded++;
+	}
       else
-	return private_show_error ("error advancing to request frame (probably out of range)", FAS_SEEK_ERROR);
+	{
+	  context->skipping_nonref = FAS_FALSE;
+	  context->codec_context->skip_frame = AVDISCARD_DEFAULT;
+	  return private_show_error (context, "error advancing to request frame (probably out of range)", FAS_SEEK_ERROR);
+	}
+    }
+
+  context->skipping_nonref = FAS_FALSE;
+  context->codec_context->skip_frame = AVDISCARD_DEFAULT;
+
+
+  return FAS_SUCCESS;
+}
+
+/* fas_set_sampling */
+fas_error_type fas_set_sampling (fas_context_ref_type context, int stride, double fps)
+{
+  if ((NULL == context) || (FAS_TRUE != context->is_video_active))
+    return private_show_error (context, "invalid or unopened context", FAS_INVALID_ARGUMENT);
+
+  if (fps > 0)
+    {
+      /* frame duration is in 100ns units */
+      unsigned long long duration = fas_get_frame_duration (context);
+      if (0 == duration)
+	return private_show_error (context, "unknown frame rate, cannot sample by fps", FAS_UNSUPPORTED_FORMAT);
+      context->sample_step = 10000000. / ((double) duration * fps);
+    }
+  else if (stride > 0)
+    context->sample_step = stride;
+  else
+    return private_show_error (context, "sampling needs a stride or fps above 0", FAS_INVALID_ARGUMENT);
+
+  /* faster than the video plays is every frame */
+  if (context->sample_step < 1.)
+    context->sample_step = 1.;
+
+  context->sample_origin = fas_get_frame_index (context);
+  context->sample_count  = 0;
+
+  return FAS_SUCCESS;
+}
+
+/* fas_step_sample */
+fas_error_type fas_step_sample (fas_context_ref_type context)
+{
+  if ((NULL == context) || (FAS_TRUE != context->is_video_active))
+    return private_show_error (context, "invalid or unopened context", FAS_INVALID_ARGUMENT);
+
+  if (context->sample_step <= 0)
+    return private_show_error (context, "fas_set_sampling has not been called", FAS_INVALID_ARGUMENT);
+
+  if (!fas_frame_available (context))
+    {
+      private_show_warning (context, "tried to advance after end of frames");
+      return FAS_SUCCESS;
+    }
+
+  int target_index = context->sample_origin + (int) ((context->sample_count + 1) * context->sample_step + 0.5);
+
+  /* frames in between are decoded on this thread (read-ahead would convert every one), rolling
+     forward or seeking as private_seek_decoder finds cheaper */
+  private_stop_read_ahead (context);
+
+  if (context->seek_table.completed && target_index >= context->seek_table.num_frames + FIRST_FRAME_INDEX)
+    {
+      /* past the end: the video ends, as after stepping past its last frame */
+      private_hide_cached (context);
+      context->current_frame_index = context->seek_table.num_frames + FIRST_FRAME_INDEX;
+      context->is_frame_available  = FAS_FALSE;
+      context->decoder_drained     = FAS_TRUE;
+      return FAS_SUCCESS;
     }
 
+  fas_error_type fas_error = fas_seek_to_frame (context, target_index);
+
+  /* running into the end of a video whose length was not known yet */
+  if (fas_error != FAS_SUCCESS && !fas_frame_available (context))
+    return FAS_SUCCESS;
+
+  if (fas_error != FAS_SUCCESS)
+    return private_show_error (context, "unable to reach the next sample", fas_error);
+
+  context->sample_count++;
+  return FAS_SUCCESS;
+}
+
+/* private_prefer_forward */
+static fas_boolean_type private_prefer_forward (fas_context_ref_type context, int target_index)
+{
+  /* decoding on from the current frame costs a frame per frame up to the target; seeking costs
+     a seek plus the frames from the target's keyframe. a keyframe at or behind the current
+     frame leaves nothing to save */
+  seek_entry_type entry;
+
+  if (target_index < context->current_frame_index || !context->is_frame_available || context->decoder_drained)
+    return FAS_FALSE;
+
+  if (seek_get_nearest_entry (&context->seek_table, &entry, target_index, 0) != seek_no_error)
+    return FAS_FALSE;
+
+  if (entry.display_index <= context->current_frame_index)
+    return FAS_TRUE;
+
+  long long forward_frames = target_index - context->current_frame_index;
+  long long seek_frames    = target_index - entry.display_index;
+  long long frame_usec     = context->seek_stats.frame_usec;
+  long long seek_usec      = context->seek_stats.seek_usec;
 
+  if (frame_usec <= 0 || seek_usec <= 0)
+    return (forward_frames <= seek_frames + SEEK_FRAMES_GUESS) ? FAS_TRUE : FAS_FALSE;
+
+  return (forward_frames * frame_usec <= seek_usec + seek_frames * frame_usec) ? FAS_TRUE : FAS_FALSE;
+}
+
+/* private_update_cost */
+static void private_update_cost (long long *cost, int64_t sample)
+{
+  /* a running average that follows changes in the content */
+  if (sample <= 0)
+    sample = 1;
+
+  if (*cost <= 0)
+    *cost = sample;
+  else
+    *cost += (sample - *cost) / COST_WEIGHT;
+}
+
+/* fas_get_seek_stats */
+fas_error_type fas_get_seek_stats (fas_context_ref_type context, fas_seek_stats_type *stats)
+{
+  if (NULL == context || FAS_FALSE == context->is_video_active || NULL == stats)
+    return private_show_error (context, "null context, inactive video or null stats", FAS_INVALID_ARGUMENT);
+
+  *stats = context->seek_stats;
   return FAS_SUCCESS;
 }
 
+/* private_can_skip_nonref */
+static fas_boolean_type private_can_skip_nonref (fas_context_ref_type context)
+{
+  /* a B-picture the MPEG-1/2 decoder skips gives no output on the packet where it would have
+     been shown, so each such packet is still one frame. MPEG-4 has not-coded frames that give
+     no output either, and H.264 holds output back past the skipped picture, so both decode
+     everything. so does a frame cache that wants every frame, and a frame threading pipeline */
+  if (context->frame_threads)
+    return FAS_FALSE;
+
+  if (context->frame_cache.max_bytes > 0 && !context->cache_paused)
+    return FAS_FALSE;
+
+  return (context->codec_context->codec_id == CODEC_ID_MPEG1VIDEO ||
+	  context->codec_context->codec_id == CODEC_ID_MPEG2VIDEO) ? FAS_TRUE : FAS_FALSE;
+}
+
 /* fas_seek_to_nearest_key */
 
 fas_error_type fas_seek_to_nearest_key (fas_context_ref_type context, int target_index)
 {
-  return private_seek_to_nearest_key(context, target_index,0);
+  if ((NULL == context) || (FAS_TRUE != context->is_video_active))
+    return private_show_error (context, "invalid or unopened context", FAS_INVALID_ARGUMENT);
+
+  private_hide_cached (context);
+  private_stop_read_ahead (context);
+
+  /* frame indices are only right once the keyframe is found */
+  fas_boolean_type was_paused = context->cache_paused;
+  context->cache_paused = FAS_TRUE;
+
+  fas_error_type fas_error = private_seek_to_nearest_key(context, target_index,0);
+
+  context->cache_paused = was_paused;
+  if (FAS_SUCCESS == fas_error && context->is_frame_available)
+    private_cache_frame (context, context->frame_buffer, context->current_frame_index);
+
+  return fas_error;
 }
 
 /* private_seek_to_nearest_key */
@@ -637,7 +2618,7 @@ fas_error_type fas_seek_to_nearest_key (fas_context_ref_type context, int target
 fas_error_type private_seek_to_nearest_key (fas_context_ref_type context, int target_index, int offset)
 {
   if ((NULL == context) || (FAS_TRUE != context->is_video_active))
-    return private_show_error ("invalid or unopened context", FAS_INVALID_ARGUMENT);
+    return private_show_error (context, "invalid or unopened context", FAS_INVALID_ARGUMENT);
 
   //  printf("HERE: from: %d to: %d offset: %d\n", context->current_frame_index, target_index, offset);
   fas_error_type fas_error;
@@ -645,9 +2626,9 @@ fas_error_type private_seek_to_nearest_key (fas_context_ref_type context, int ta
   seek_error_type seek_error = seek_get_nearest_entry (&(context->seek_table), &seek_entry, target_index, offset);
   
   if (seek_error != seek_no_error)
-    return private_show_error ("error while searching seek table", FAS_SEEK_ERROR);
+    return private_show_error (context, "error while searching seek table", FAS_SEEK_ERROR);
 
-  if (seek_entry.display_index == context->current_frame_index)
+  if (seek_entry.display_index == context->current_frame_index && !context->decoder_drained)
     return FAS_SUCCESS;
 
   //  printf("HERE: from: %d to: %d (%d) offset: %d\n", context->current_frame_index, target_index, seek_entry.display_index, offset);
@@ -663,33 +2644,34 @@ fas_error_type private_seek_to_nearest_key (fas_context_ref_type context, int ta
   
   //  printf("av_seek_frame: %lld\n", seek_entry.first_packet_dts);
   if (av_seek_frame(context->format_context, context->stream_idx, seek_entry.first_packet_dts, flags) < 0)
-    return private_show_error("seek to keyframe failed", FAS_SEEK_ERROR);
+    return private_show_error(context, "seek to keyframe failed", FAS_SEEK_ERROR);
   
 
   avcodec_flush_buffers (context->codec_context);
+  context->decoder_drained = FAS_FALSE;
   
-  fas_error = fas_step_forward (context);  
+  fas_error = private_step_decoder (context);  
 
   if (fas_error != FAS_SUCCESS || !context->is_frame_available)  
     {
       // something bad has happened, try previous keyframe
-      private_show_warning("processing of seeked keyframe failed, trying previous keyframe");
+      private_show_warning(context, "processing of seeked keyframe failed, trying previous keyframe");
       return private_seek_to_nearest_key(context, target_index, offset + 1);
     }
   
   while (context->current_dts < seek_entry.last_packet_dts)
     {
       //printf("frame-times: current: %lld target: %lld is_key: %d\n", context->current_dts, seek_entry.last_packet_dts, context->frame_buffer->key_frame);
-      fas_error = fas_step_forward(context);
+      fas_error = private_step_decoder(context);
       if (fas_error != FAS_SUCCESS) 
-	return private_show_error ("unable to process up to target frame (fas_seek_to_frame)", fas_error);     
+	return private_show_error (context, "unable to process up to target frame (fas_seek_to_frame)", fas_error);     
     }
     
   //  printf("keyframe vitals: %d looking_for: %lld at: %lld\n", seek_entry.display_index, seek_entry.last_packet_dts, context->current_dts);
   if (context->current_dts != seek_entry.last_packet_dts)
     {      
       /* seek to last key-frame, but look for this one */
-      private_show_warning("missed keyframe, trying previous keyframe");
+      private_show_warning(context, "missed keyframe, trying previous keyframe");
       return private_seek_to_nearest_key(context, target_index, offset + 1);
     }
 
@@ -703,7 +2685,7 @@ fas_error_type private_seek_to_nearest_key (fas_context_ref_type context, int ta
   
   if ((!context->frame_buffer->key_frame) && (seek_entry.display_index != 0))
     {
-      private_show_warning("found keyframe, but not labeled as keyframe, so trying previous keyframe.");
+      private_show_warning(context, "found keyframe, but not labeled as keyframe, so trying previous keyframe.");
       /* seek & look for previous keyframe */
       /* REMOVE FROM TABLE?                */
       return private_seek_to_nearest_key(context, seek_entry.display_index - 1, 0);
@@ -721,14 +2703,22 @@ int fas_get_frame_count_fast (fas_context_ref_type context)
   
   if (NULL == context || FAS_FALSE == context->is_video_active) 
     {
-      private_show_error ("NULL or invalid context", FAS_INVALID_ARGUMENT);
+      private_show_error (context, "NULL or invalid context", FAS_INVALID_ARGUMENT);
       return -1;
     }
   
+  int count = -1;
+
+  if (context->read_ahead_running)
+    pthread_mutex_lock (&context->table_lock);
+
   if (context->seek_table.completed == seek_true)
-    return context->seek_table.num_frames;
+    count = context->seek_table.num_frames;
+
+  if (context->read_ahead_running)
+    pthread_mutex_unlock (&context->table_lock);
   
-  return -1;
+  return count;
 }
 
 int fas_get_frame_count (fas_context_ref_type context)
@@ -741,10 +2731,14 @@ int fas_get_frame_count (fas_context_ref_type context)
 
   fas_error_type fas_error;
 
+  /* completing the table moves the decoder; the seek back below restores current_frame */
+  private_hide_cached (context);
+  private_stop_read_ahead (context);
+
   fas_error = private_complete_seek_table(context); 
   if (FAS_SUCCESS != fas_error)
     {
-      private_show_error("failed in get_frame_count trying to complete the seek table", fas_error);
+      private_show_error(context, "failed in get_frame_count trying to complete the seek table", fas_error);
       return -1;
     }
 
@@ -753,13 +2747,13 @@ int fas_get_frame_count (fas_context_ref_type context)
   fas_error = fas_seek_to_frame(context, current_frame);
   if (FAS_SUCCESS != fas_error)
     {
-      private_show_error("failed in get_frame_count when trying to seek back to original location", fas_error);
+      private_show_error(context, "failed in get_frame_count when trying to seek back to original location", fas_error);
       return -1;
     }
   
   fast = fas_get_frame_count_fast(context);
   if (fast < 0)
-    private_show_warning("get_frame_count failed");
+    private_show_warning(context, "get_frame_count failed");
   
   return fast;
 }
@@ -770,54 +2764,96 @@ fas_boolean_type fas_frame_available (fas_context_ref_type context)
 {
   if (NULL == context) 
     {
-      private_show_error ("NULL context provided for fas_get_frame_index()", FAS_INVALID_ARGUMENT);
+      private_show_error (context, "NULL context provided for fas_get_frame_index()", FAS_INVALID_ARGUMENT);
       return FAS_FALSE;
     }
 
   if (!context->is_video_active)
     return FAS_FALSE;
 
+  if (context->cache_shown)
+    return FAS_TRUE;
+
+  if (context->read_ahead_running)
+    return context->shown_frame_available;
+
   return context->is_frame_available;
 }
 
 
+/* private_logging */
+
+static fas_boolean_type private_logging (fas_context_ref_type context)
+{
+  fas_boolean_type logging;
+
+  if (NULL != context)
+    return context->options.logging;
+
+  pthread_mutex_lock (&gbl_config_lock);
+  logging = SHOW_ERROR_MESSAGES ? FAS_TRUE : FAS_FALSE;
+  pthread_mutex_unlock (&gbl_config_lock);
+  return logging;
+}
+
 /* private_show_error */
 
-static fas_error_type private_show_error (const char *message, fas_error_type error)
+static fas_error_type private_show_error (fas_context_ref_type context, const char *message, fas_error_type error)
 {
-  if (SHOW_ERROR_MESSAGES)
+  if (private_logging (context))
     fprintf (stderr, " ===> ffmpeg_fas: %s\n", message);
   return error;
 }
 
-static void private_show_warning (const char *message) 
+static void private_show_warning (fas_context_ref_type context, const char *message) 
 {
-  if (SHOW_WARNING_MESSAGES)
+  if (private_logging (context))
     fprintf (stderr, " ---- ffmpeg_fas: %s\n", message);
   return;
 }
 
+/* private_fail_open: reports with the options being opened with, then closes what was opened */
+
+static fas_error_type private_fail_open (fas_context_ref_type context, fas_boolean_type logging, const char *message,
+					 fas_error_type error)
+{
+  if (logging)
+    fprintf (stderr, " ===> ffmpeg_fas: %s\n", message);
+
+  if (NULL != context)
+    fas_close_video (context);
+  return error;
+}
+
 
 /* private_convert_to_rgb */
 
 fas_error_type private_convert_to_rgb (fas_context_ref_type ctx)
 {
+  output_type *output = &ctx->output;
+
   if (ctx->rgb_already_converted)
     return FAS_SUCCESS;
 
-  if (ctx->rgb_buffer == 0)
+  /* only the cropped and scaled image is ever written */
+  int numBytes = avpicture_get_size(output->format, output->width, output->height);
+  if (ctx->rgb_buffer == 0 || ctx->rgb_size < numBytes)
     {
-      int numBytes = avpicture_get_size(fmt, ctx->codec_context->width,
-					ctx->codec_context->height);
+      if (ctx->rgb_buffer)
+	av_free (ctx->rgb_buffer);
+
+      ctx->rgb_size = 0;
       ctx->rgb_buffer = (uint8_t *) av_malloc(numBytes*sizeof(uint8_t));
-      avpicture_fill((AVPicture *) ctx->rgb_frame_buffer, ctx->rgb_buffer, fmt,
-		     ctx->codec_context->width, ctx->codec_context->height);
+      if (NULL == ctx->rgb_buffer)
+	return private_show_error (ctx, "unable to allocate conversion buffer", FAS_OUT_OF_MEMORY);
+      ctx->rgb_size = numBytes;
     }
+  avpicture_fill((AVPicture *) ctx->rgb_frame_buffer, ctx->rgb_buffer, output->format, output->width, output->height);
 
-  if (img_convert((AVPicture *) ctx->rgb_frame_buffer, fmt, (AVPicture *) ctx->frame_buffer, 
-		  ctx->codec_context->pix_fmt,
-		  ctx->codec_context->width, ctx->codec_context->height) < 0)
-    private_show_error("error converting to rgb", FAS_DECODING_ERROR);
+  fas_error_type fas_error = private_scale (ctx->scalers, &ctx->next_scaler, private_shown_frame (ctx), ctx->codec_context->pix_fmt,
+					   ctx->rgb_frame_buffer, output);
+  if (FAS_SUCCESS != fas_error)
+    return private_show_error (ctx, "error converting to rgb", fas_error);
 
   ctx->rgb_already_converted = FAS_TRUE;
 
@@ -829,6 +2865,8 @@ fas_error_type private_convert_to_rgb (fas_context_ref_type ctx)
 
 fas_error_type private_convert_to_gray8 (fas_context_ref_type ctx)
 {
+  output_type gray8;
+
   if (ctx->gray8_already_converted)
     return FAS_SUCCESS;
 
@@ -837,20 +2875,186 @@ fas_error_type private_convert_to_gray8 (fas_context_ref_type ctx)
       int numBytes = avpicture_get_size(PIX_FMT_GRAY8, ctx->codec_context->width,
 					ctx->codec_context->height);
       ctx->gray8_buffer = (uint8_t *) av_malloc(numBytes*sizeof(uint8_t));
+      if (NULL == ctx->gray8_buffer)
+	return private_show_error (ctx, "unable to allocate gray8 buffer", FAS_OUT_OF_MEMORY);
       avpicture_fill((AVPicture *) ctx->gray8_frame_buffer, ctx->gray8_buffer, PIX_FMT_GRAY8,
 		     ctx->codec_context->width, ctx->codec_context->height);
     }
 
-  if (img_convert((AVPicture *) ctx->gray8_frame_buffer, PIX_FMT_GRAY8, (AVPicture *) ctx->frame_buffer, 
-		  ctx->codec_context->pix_fmt,
-		  ctx->codec_context->width, ctx->codec_context->height) < 0)
-    private_show_error("error converting to gray8", FAS_DECODING_ERROR);
+  /* whole frames, whatever the output geometry */
+  memset (&gray8, 0, sizeof (gray8));
+  gray8.format       = PIX_FMT_GRAY8;
+  gray8.crop_width   = gray8.width  = ctx->codec_context->width;
+  gray8.crop_height  = gray8.height = ctx->codec_context->height;
+  gray8.scaler_flags = SWS_BICUBIC;
+
+  fas_error_type fas_error = private_scale (ctx->scalers, &ctx->next_scaler, private_shown_frame (ctx), ctx->codec_context->pix_fmt,
+					   ctx->gray8_frame_buffer, &gray8);
+  if (FAS_SUCCESS != fas_error)
+    return private_show_error (ctx, "error converting to gray8", fas_error);
 
   ctx->gray8_already_converted = FAS_TRUE;
 
   return FAS_SUCCESS;
 }
 
+/* private_is_whole_frame */
+
+static fas_boolean_type private_is_whole_frame (fas_context_ref_type context)
+{
+  output_type *output = &context->output;
+
+  return (0 == output->crop_x && 0 == output->crop_y &&
+	  output->crop_width == context->codec_context->width && output->crop_height == context->codec_context->height &&
+	  output->width == output->crop_width && output->height == output->crop_height) ? FAS_TRUE : FAS_FALSE;
+}
+
+/* private_scale */
+
+static fas_error_type private_scale (scaler_type *scalers, int *next_scaler, AVFrame *src, enum PixelFormat src_format,
+				     AVFrame *dst, output_type *output)
+{
+  /* one swscale context per conversion, made the first time it is needed; when all are in
+     use the oldest is replaced. cropping and scaling happen in the same pass as the colour
+     conversion */
+  scaler_type *scaler = NULL;
+  AVPicture cropped;
+  int i;
+
+  /* av_picture_crop only knows planar YUV */
+  if (0 == output->crop_x && 0 == output->crop_y)
+    cropped = *(AVPicture *) src;
+  else if (av_picture_crop (&cropped, (AVPicture *) src, src_format, output->crop_y, output->crop_x) < 0)
+    return FAS_UNSUPPORTED_FORMAT;
+
+  if (private_fast_convert (&cropped, src_format, dst, output))
+    return FAS_SUCCESS;
+
+  for (i = 0; i < NUM_SCALERS; i++)
+    if (scalers[i].sws && scalers[i].src_format == src_format && scalers[i].dst_format == output->format &&
+	scalers[i].src_width == output->crop_width && scalers[i].src_height == output->crop_height &&
+	scalers[i].dst_width == output->width && scalers[i].dst_height == output->height &&
+	scalers[i].flags == output->scaler_flags)
+      {
+	scaler = &scalers[i];
+	break;
+      }
+
+  if (NULL == scaler)
+    {
+      scaler = &scalers[*next_scaler];
+      *next_scaler = (*next_scaler + 1) % NUM_SCALERS;
+
+      if (scaler->sws)
+	sws_freeContext (scaler->sws);
+
+      scaler->sws = sws_getContext (output->crop_width, output->crop_height, src_format,
+				    output->width, output->height, output->format, output->scaler_flags, NULL, NULL, NULL);
+      if (NULL == scaler->sws)
+	return FAS_UNSUPPORTED_FORMAT;
+
+      scaler->src_format = src_format;
+      scaler->src_width  = output->crop_width;
+      scaler->src_height = output->crop_height;
+      scaler->dst_format = output->format;
+      scaler->dst_width  = output->width;
+      scaler->dst_height = output->height;
+      scaler->flags      = output->scaler_flags;
+    }
+
+  if (sws_scale (scaler->sws, cropped.data, cropped.linesize, 0, output->crop_height, dst->data, dst->linesize) <= 0)
+    return FAS_DECODING_ERROR;
+
+  return FAS_SUCCESS;
+}
+
+/* private_fast_convert */
+
+static fas_boolean_type private_fast_convert (AVPicture *src, enum PixelFormat src_format, AVFrame *dst, output_type *output)
+{
+  /* the unscaled conversions asked for most often skip swscale; returns FAS_FALSE
+     when swscale has to do it */
+  pixel_order_type order;
+  int width  = output->width;
+  int height = output->height;
+
+  if (width != output->crop_width || height != output->crop_height)
+    return FAS_FALSE;
+
+  switch (src_format)
+    {
+    case PIX_FMT_YUV420P:
+    case PIX_FMT_YUVJ420P:
+    case PIX_FMT_YUV422P:
+    case PIX_FMT_YUVJ422P:
+    case PIX_FMT_YUV444P:
+    case PIX_FMT_YUVJ444P:
+    case PIX_FMT_YUV410P:
+    case PIX_FMT_YUV411P:
+      if (PIX_FMT_GRAY8 == output->format)
+	{
+	  pixel_copy_plane (dst->data[0], dst->linesize[0], src->data[0], src->linesize[0], width, height);
+	  return FAS_TRUE;
+	}
+      break;
+
+    case PIX_FMT_YUYV422:
+    case PIX_FMT_UYVY422:
+      if (PIX_FMT_YUV422P == output->format)
+	{
+	  pixel_packed422_to_planar (dst->data[0], dst->linesize[0], dst->data[1], dst->linesize[1], dst->data[2], dst->linesize[2],
+				     src->data[0], src->linesize[0], PIX_FMT_UYVY422 == src_format, width, height);
+	  return FAS_TRUE;
+	}
+      break;
+
+    default:
+      break;
+    }
+
+  /* full range (YUVJ) input keeps going through swscale */
+  if (PIX_FMT_YUV420P != src_format)
+    return FAS_FALSE;
+
+  switch (output->format)
+    {
+    case PIX_FMT_RGB24: order = PIXEL_RGB24; break;
+    case PIX_FMT_BGR24: order = PIXEL_BGR24; break;
+    case PIX_FMT_RGBA:  order = PIXEL_RGBA;  break;
+    case PIX_FMT_BGRA:  order = PIXEL_BGRA;  break;
+    case PIX_FMT_ARGB:  order = PIXEL_ARGB;  break;
+    case PIX_FMT_ABGR:  order = PIXEL_ABGR;  break;
+    default:
+      return FAS_FALSE;
+    }
+
+  pixel_yuv420p_to_packed (dst->data[0], dst->linesize[0], order, src->data[0], src->linesize[0],
+			   src->data[1], src->linesize[1], src->data[2], src->linesize[2], width, height);
+  return FAS_TRUE;
+}
+
+/* private_free_scalers */
+
+static void private_free_scalers (scaler_type *scalers)
+{
+  int i;
+
+  for (i = 0; i < NUM_SCALERS; i++)
+    {
+      if (scalers[i].sws)
+	sws_freeContext (scalers[i].sws);
+      scalers[i].sws = NULL;
+    }
+}
+
+int fas_get_lowres (fas_context_ref_type context)
+{
+  if (NULL == context || FAS_FALSE == context->is_video_active)
+    return private_show_error (context, "null context or inactive video", FAS_INVALID_ARGUMENT);
+
+  return context->codec_context->lowres;
+}
+
 int fas_get_current_width(fas_context_ref_type context)
 {
   return context->codec_context->width;
@@ -878,22 +3082,39 @@ unsigned long long fas_get_frame_duration(fas_context_ref_type context)
 
 fas_error_type fas_fill_gray8_ptr(fas_context_ref_type context, unsigned char *y)
 {
-  /* this conversion also seems to screw up sometimes -- pal8 -> gray8? legodragon.avi */
-  if (private_convert_to_gray8(context) != FAS_SUCCESS)
-    return FAS_FAILURE;
-
   int width = context->codec_context->width;
   int height = context->codec_context->height;
-  int i;
-  for (i=0;i < height; i++)
-    memcpy(y + width * i, context->gray8_frame_buffer->data[0] + context->gray8_frame_buffer->linesize[0] * i, width);
+  AVFrame *from = context->gray8_frame_buffer;
+
+  /* planar YUV decoders already hold gray8 in their Y plane */
+  switch (context->codec_context->pix_fmt)
+    {
+    case PIX_FMT_YUV420P:
+    case PIX_FMT_YUVJ420P:
+    case PIX_FMT_YUV422P:
+    case PIX_FMT_YUVJ422P:
+    case PIX_FMT_YUV444P:
+    case PIX_FMT_YUVJ444P:
+    case PIX_FMT_YUV410P:
+    case PIX_FMT_YUV411P:
+      from = private_shown_frame (context);
+      break;
+
+    default:
+      /* this conversion also seems to screw up sometimes -- pal8 -> gray8? legodragon.avi */
+      if (private_convert_to_gray8(context) != FAS_SUCCESS)
+	return FAS_FAILURE;
+      break;
+    }
+
+  pixel_copy_plane (y, width, from->data[0], from->linesize[0], width, height);
   
   return FAS_SUCCESS;
 }
 
 fas_error_type  fas_fill_420p_ptrs (fas_context_ref_type context, unsigned char *y, unsigned char *u, unsigned char *v)
 {
-  AVFrame *p = context->frame_buffer;
+  AVFrame *p = private_shown_frame (context);
   
   /* 411p to 420p conversion fails!? ... so i left this -ldb */
   if (context->codec_context->pix_fmt != PIX_FMT_YUV420P)
@@ -901,14 +3122,9 @@ fas_error_type  fas_fill_420p_ptrs (fas_context_ref_type context, unsigned char
 
   int width = context->codec_context->width;
   int height = context->codec_context->height;
-  int i;
-  for (i=0;i < height / 2; i++)
-    {
-      memcpy(y + width * (2*i)    , p->data[0] + p->linesize[0] * (2*i)    , width);
-      memcpy(y + width * (2*i + 1), p->data[0] + p->linesize[0] * (2*i + 1), width);
-      memcpy(u + width / 2 * i, p->data[1] + p->linesize[1] * i, width / 2);
-      memcpy(v + width / 2 * i, p->data[2] + p->linesize[2] * i, width / 2);
-    }
+  pixel_copy_plane (y, width, p->data[0], p->linesize[0], width, height / 2 * 2);
+  pixel_copy_plane (u, width / 2, p->data[1], p->linesize[1], width / 2, height / 2);
+  pixel_copy_plane (v, width / 2, p->data[2], p->linesize[2], width / 2, height / 2);
   
   return FAS_SUCCESS;
 }
@@ -55,6 +55,40 @@ typedef struct
   fas_color_space_type color_space;
 } fas_raw_image_type;
 
+typedef enum
+{
+  FAS_FILTER_BICUBIC       = 0,   /* default */
+  FAS_FILTER_BILINEAR      = 1,
+  FAS_FILTER_FAST_BILINEAR = 2,
+  FAS_FILTER_POINT         = 3,   /* nearest neighbour */
+  FAS_FILTER_AREA          = 4,   /* averages, for large reductions */
+} fas_filter_type;
+
+/* the part of each decoded frame that is converted, and the size it is scaled to. all zero (the
+   default) is the whole frame at its own size */
+typedef struct
+{
+  int crop_x;              /* rounded down to even */
+  int crop_y;
+  int crop_width;          /* 0: to the right edge */
+  int crop_height;         /* 0: to the bottom edge */
+  int width;               /* 0 for both keeps the crop's size; 0 for one keeps its aspect ratio */
+  int height;
+  fas_filter_type filter;
+} fas_output_geometry_type;
+
+/* a frame borrowed from the context, rows linesize[plane] bytes apart. packed formats only use
+   plane 0. generation changes whenever the frame behind the context does */
+typedef struct
+{
+  unsigned char *data[4];
+  int linesize[4];
+  int width;
+  int height;
+  fas_color_space_type color_space;
+  unsigned long long generation;
+} fas_frame_view_type;
+
 
 /**********************************************************************
  * Video IO Types
@@ -81,40 +115,299 @@ typedef enum
   FAS_TRUE  = 1
 } fas_boolean_type;
 
+typedef enum
+{
+  FAS_INDEX_DECODE  = 0,   /* seek tables are built by decoding every frame (default) */
+  FAS_INDEX_PACKETS = 1,   /* from packet flags and dts, decoding only candidate keyframes */
+} fas_index_mode_type;
+
+typedef enum
+{
+  FAS_THREAD_SLICE  = 1,   /* split each frame across threads (codecs that code slices) */
+  FAS_THREAD_FRAME  = 2,   /* decode consecutive frames concurrently */
+} fas_thread_type;
+
+/* per-context options for fas_open_video_with_options; start from fas_default_open_options() so
+   that fields added later keep their defaults */
+typedef struct
+{
+  int thread_count;        /* decoder threads; 0 or 1 decodes on the calling thread */
+  int thread_type;         /* FAS_THREAD_SLICE and/or FAS_THREAD_FRAME */
+  int read_ahead;          /* frames decoded and converted ahead on a background thread, so
+                              fas_step_forward only waits for the next one; 0 turns this off */
+  int lowres;              /* decode at 1/2^lowres of the size (0 to 3), where the codec can (the
+                              MPEG-1/2/4, H.263, MS-MPEG4/WMV1/2 and MJPEG families); the
+                              reduced size is what the context reports and returns everywhere */
+  fas_color_space_type format;  /* output format; the default is fas_initialize's / fas_set_format's */
+  fas_boolean_type logging;     /* whether this video prints its errors and warnings; the default is
+                                   fas_initialize's. ffmpeg's own messages follow fas_initialize */
+} fas_open_options_type;
 
+/* input for fas_open_video_custom_io: either data_size bytes at data, or the read callback (with
+   seek and size if the source has them). start from a zeroed struct */
+typedef struct
+{
+  const unsigned char *data;       /* the whole file in memory; must stay valid until the video is closed */
+  long long            data_size;
+
+  int       (*read) (void *opaque, unsigned char *buffer, int size);    /* bytes read, 0 at the end, < 0 on error */
+  long long (*seek) (void *opaque, long long offset, int whence);       /* SEEK_SET/CUR/END; new position, < 0 on error */
+  long long (*size) (void *opaque);                                     /* < 0 if unknown */
+  void       *opaque;
+
+  int         buffer_size;         /* bytes the demuxer reads at a time; 0 for the default (32 KB) */
+  const char *name;                /* file name hint for format probing and messages; may be NULL */
+} fas_custom_io_type;
+
+typedef struct
+{
+  long long hits;           /* fas_seek_to_frame / fas_step_forward served from the cache */
+  long long misses;
+  int       num_frames;
+  long long bytes;
+} fas_frame_cache_stats_type;
+
+typedef struct
+{
+  long long allocations;    /* fas_get_frame buffers the pool had to allocate */
+  long long reuses;         /* and ones it handed out again */
+  int       idle;
+  int       lent;           /* pooled images not yet given to fas_free_frame */
+} fas_frame_pool_stats_type;
+
+typedef struct
+{
+  long long forward_seeks;  /* fas_seek_to_frame targets reached by decoding on from the current frame */
+  long long keyframe_seeks; /* and by seeking back to the target's keyframe */
+  long long frames_decoded; /* frames decoded on the way to targets */
+  long long frame_usec;     /* measured cost of decoding one of those frames */
+  long long seek_usec;      /* and of seeking to a keyframe and decoding it */
+} fas_seek_stats_type;
+
+
+/* threads: fas_initialize registers ffmpeg once, however many threads call it, and may be
+   called again (the same arguments leave everything as it is). contexts share no decoding state,
+   so any number can be opened, used and closed at once from different threads; each context is
+   used by one thread at a time. the process-wide defaults (fas_initialize's format and logging,
+   fas_set_format, fas_set_seek_table_cache) may be changed from any thread at any time; each
+   video takes them when it is opened. per-video settings go in fas_open_options_type */
 __extern void             fas_initialize (fas_boolean_type logging, fas_color_space_type format);
+
+/* the output format of videos opened from now on (fas_initialize sets it too) */
 __extern void             fas_set_format (fas_color_space_type format);
 
 __extern fas_error_type   fas_open_video  (fas_context_ref_type *context_ptr, char *file_path);
 __extern fas_error_type   fas_close_video (fas_context_ref_type context);
 
+/* with frame threading, seek tables record when keyframes leave the threaded decoder, so tables
+   given to fas_put_seek_table must come from a context opened with the same options */
+__extern fas_open_options_type fas_default_open_options (void);
+__extern fas_error_type   fas_open_video_with_options (fas_context_ref_type *context_ptr, char *file_path, fas_open_options_type options);
+
+/* opens a video held in memory or behind callbacks, with no file on disk. seeking works as for
+   files when the input is in memory or has a seek callback; without one the video can only be
+   stepped forward. there is no file to key the seek table cache, so tables are neither loaded
+   nor stored, FAS_INDEX_PACKETS falls back to decoding, and only memory inputs get a prefetch
+   decoder for fas_step_backward */
+__extern fas_error_type   fas_open_video_custom_io (fas_context_ref_type *context_ptr, const fas_custom_io_type *io,
+						    fas_open_options_type options);
+
 __extern char*            fas_error_message (fas_error_type error);
 
+/* each video converts to its own output format, so one process can serve RGB and GRAY8
+   consumers at once. conversions go through swscale contexts kept by the video */
+__extern fas_error_type       fas_set_output_format (fas_context_ref_type context, fas_color_space_type format);
+__extern fas_color_space_type fas_get_output_format (fas_context_ref_type context);
+
+/* crops and scales in the same pass as the colour conversion, so only the reduced image is
+   written. applies to fas_get_frame, fas_get_frame_into and fas_get_frame_view; decoded views
+   and the fas_fill_* functions stay whole frames. crops of decoders that output packed
+   formats must start at 0,0 (FAS_INVALID_ARGUMENT otherwise) */
+__extern fas_error_type           fas_set_output_geometry (fas_context_ref_type context, fas_output_geometry_type geometry);
+__extern fas_output_geometry_type fas_get_output_geometry (fas_context_ref_type context);
+
 __extern fas_boolean_type fas_frame_available (fas_context_ref_type context);
 __extern int              fas_get_frame_index (fas_context_ref_type context);
 __extern fas_error_type   fas_step_forward    (fas_context_ref_type context);
 
+/* steps to the previous frame. its GOP is decoded once into the frame cache (which grows to
+   hold two GOPs if it is smaller), while the GOP before it is decoded on a background thread.
+   the limit set with fas_set_frame_cache comes back once the decoder moves forward again: a
+   fas_step_forward past the cached frames, a fas_seek_to_frame that decodes, or a keyframe
+   step. FAS_NO_MORE_FRAMES at the first frame */
+__extern fas_error_type   fas_step_backward   (fas_context_ref_type context);
+
+/* steps to the next keyframe, demuxing the packets in between without decoding them. the
+   display index comes from the packet count for streams without frame reordering (the seek
+   table is extended as it goes), otherwise from the seek table, which is completed first if
+   needed. at the last keyframe it ends the video like fas_step_forward does */
+__extern fas_error_type   fas_step_to_next_keyframe (fas_context_ref_type context);
+
+/* sampling from the current frame: fas_step_sample moves on stride frames, or with fps > 0 to
+   the frame nearest the next 1/fps seconds. frames in between are never converted; they are
+   decoded (skipping B-pictures where possible) or seeked past, whichever costs less */
+__extern fas_error_type   fas_set_sampling (fas_context_ref_type context, int stride, double fps);
+__extern fas_error_type   fas_step_sample  (fas_context_ref_type context);
+
 __extern fas_error_type   fas_get_frame  (fas_context_ref_type context, fas_raw_image_type *image_ptr);
 __extern void             fas_free_frame (fas_raw_image_type image);
 
+/* writes the current frame into the caller's image: data, width and height must be set, and
+   bytes_per_line may be larger than a row (0 means packed rows). never give it to fas_free_frame */
+__extern fas_error_type   fas_get_frame_into (fas_context_ref_type context, fas_raw_image_type *image_ptr);
+
+/* images[i] gets frame indices[i], for n requests in any order (repeats allowed). the frames
+   are decoded in display order, each GOP at most once, and each distinct frame converted once.
+   every image is for fas_free_frame; on error none are returned */
+__extern fas_error_type   fas_get_frames (fas_context_ref_type context, const int *indices, int n, fas_raw_image_type *images);
+
+/* with max_buffers > 0, fas_get_frame takes 32-byte aligned buffers from a pool shared by all
+   contexts, and fas_free_frame returns them (keeping up to max_buffers idle). 0 (the default)
+   frees idle buffers and goes back to malloc/free. pooled images must be released with
+   fas_free_frame, not free() */
+__extern void             fas_set_frame_pool (int max_buffers);
+__extern void             fas_get_frame_pool_stats (fas_frame_pool_stats_type *stats);
+
+/* zero-copy access to the current frame. fas_get_frame_view gives it in the output format
+   (converted only if the decoder's format differs), fas_get_decoded_view as the decoder left
+   it (FAS_UNSUPPORTED_FORMAT if it has no fas_color_space_type; full-range YUVJ formats are
+   reported as their YUV counterparts). views stay valid until the next step, seek, format
+   change or fas_close_video, and must not be written to */
+__extern fas_error_type   fas_get_frame_view   (fas_context_ref_type context, fas_frame_view_type *view);
+__extern fas_error_type   fas_get_decoded_view (fas_context_ref_type context, fas_frame_view_type *view);
+
 __extern fas_error_type   fas_seek_to_nearest_key     (fas_context_ref_type context, int target_index);
 __extern fas_error_type   fas_seek_to_frame           (fas_context_ref_type context, int target_index);
 
+/* fas_seek_to_frame decodes forward instead of seeking when the target's keyframe is not past
+   the current frame, or when the measured costs say the frames in between are cheaper */
+__extern fas_error_type   fas_get_seek_stats          (fas_context_ref_type context, fas_seek_stats_type *stats);
+
 __extern int              fas_get_frame_count         (fas_context_ref_type context);
 __extern int              fas_get_frame_count_fast    (fas_context_ref_type context);
 
 __extern fas_error_type   fas_put_seek_table  (fas_context_ref_type context, seek_table_type table);
+
+/* the table is the context's own, valid until the context next decodes; read-ahead is stopped
+   first (it restarts on the next step) so that its thread does not grow the table meanwhile */
 __extern seek_table_type  fas_get_seek_table  (fas_context_ref_type context);
 
+/* FAS_INDEX_PACKETS only works for streams without frame reordering and with sane timestamps;
+   for other streams fas_build_seek_table returns FAS_UNSUPPORTED_CODEC and the context falls
+   back to decoding */
+__extern fas_error_type   fas_set_index_mode   (fas_context_ref_type context, fas_index_mode_type mode);
+__extern fas_error_type   fas_build_seek_table (char *file_path, fas_index_mode_type mode, seek_table_type *table);
+
+/* decodes n_threads time ranges of the file concurrently and merges the partial tables. the
+   result is identical to FAS_INDEX_DECODE; if a range boundary cannot be verified it falls
+   back to a single-threaded decode */
+__extern fas_error_type   fas_build_seek_table_parallel (char *file_path, int n_threads, seek_table_type *table);
+
+/* opt-in on-disk cache of completed seek tables, shared by all contexts (see seek_cache.h).
+   cache_dir NULL disables it, max_bytes <= 0 means no size cap. applies to videos opened
+   afterwards */
+__extern void             fas_set_seek_table_cache (const char *cache_dir, long long max_bytes);
+
+/* per-context cache of decoded frames (up to max_bytes, least recently used go first; 0 turns
+   it off). frames are kept as decoded, so any output format is served from them. seeks to a
+   cached frame, and steps through cached frames, do not touch the demuxer or decoder */
+__extern fas_error_type   fas_set_frame_cache       (fas_context_ref_type context, long long max_bytes);
+__extern fas_error_type   fas_get_frame_cache_stats (fas_context_ref_type context, fas_frame_cache_stats_type *stats);
+
 /* will extract raw 420p if the video is in that format -- needs to be alloced ahead of time*/
 __extern fas_error_type  fas_fill_420p_ptrs (fas_context_ref_type context, unsigned char *y, unsigned char *u, unsigned char *v);
 
 /* will extract gray8 data from movie (will convert to ensure you get it) -- need to be alloc'ed ahead of time*/
 __extern fas_error_type  fas_fill_gray8_ptr(fas_context_ref_type context, unsigned char *y);
 
+/* the lowres option in effect: 0 when the codec cannot decode at reduced resolution */
+__extern int  fas_get_lowres (fas_context_ref_type context);
+
 __extern int  fas_get_current_width(fas_context_ref_type context);
 __extern int  fas_get_current_height(fas_context_ref_type context);
 
 __extern unsigned long long fas_get_frame_duration(fas_context_ref_type context);
 
+
+/**********************************************************************
+ * Worker Pool
+ **********************************************************************/
+
+typedef struct fas_pool_struct* fas_pool_ref_type;
+
+/* called on a worker thread for every frame of a job; the view is only valid during the call */
+typedef void (*fas_pool_frame_callback_type) (void *user_data, int frame_index, fas_frame_view_type *view);
+
+/* called once when the last frame of a job has been delivered, or the job has failed */
+typedef void (*fas_pool_done_callback_type) (void *user_data, fas_error_type error);
+
+/* frames first_frame to last_frame (-1: to the end), or, if indices is not NULL, the n_indices
+   frames it lists (in any order, duplicates allowed) */
+typedef struct
+{
+  char                        *file_path;
+  int                          first_frame;
+  int                          last_frame;
+  const int                   *indices;
+  int                          n_indices;
+  fas_pool_frame_callback_type callback;
+  fas_pool_done_callback_type  done;          /* may be NULL */
+  void                        *user_data;
+} fas_pool_job_type;
+
+typedef struct
+{
+  long long jobs;           /* jobs finished */
+  long long chunks;         /* pieces they were run as (long jobs are split) */
+  long long steals;         /* chunks a worker took from another worker's queue */
+  long long reuses;         /* chunks run on a context a worker already had open for the file */
+} fas_pool_stats_type;
+
+/* a fixed set of worker threads decoding submitted jobs. jobs longer than a few hundred frames
+   are cut into GOP-aligned chunks using the file's seek table (cached, or built from packets),
+   which idle workers steal from busy ones. each worker keeps its last context open and reuses it
+   for the next chunk of the same file. frames arrive in ascending order within a chunk, but
+   chunks of one job can run at the same time, so callbacks must be thread-safe. contexts are
+   opened with the given options, minus decoder threads and read-ahead (the workers are the
+   parallelism). call fas_initialize first */
+__extern fas_error_type   fas_pool_create  (fas_pool_ref_type *pool_ptr, int n_workers, fas_open_options_type options);
+__extern fas_error_type   fas_pool_submit  (fas_pool_ref_type pool, const fas_pool_job_type *job);
+
+/* waits until every submitted job is done; returns the first job error since the last wait */
+__extern fas_error_type   fas_pool_wait    (fas_pool_ref_type pool);
+
+/* waits for outstanding jobs, then stops the workers and closes their contexts */
+__extern void             fas_pool_destroy (fas_pool_ref_type pool);
+__extern fas_error_type   fas_get_pool_stats (fas_pool_ref_type pool, fas_pool_stats_type *stats);
+
+
+/**********************************************************************
+ * Parallel Decoding
+ **********************************************************************/
+
+typedef struct fas_parallel_struct* fas_parallel_ref_type;
+
+typedef struct
+{
+  long long bytes;          /* frames decoded but not yet handed out */
+  long long peak_bytes;     /* the most there have been */
+} fas_parallel_stats_type;
+
+/* one full pass over a file on n_threads decoders. the file's seek table (cached, else built
+   from packets, else built by decoding on n_threads) cuts it into GOP-aligned segments, each
+   decoded on its own context and thread. frames wait in a reorder buffer of up to max_bytes (<= 0:
+   unbounded; at most one frame over) until fas_parallel_next hands them out. threads stop when
+   the buffer is full, except that the segment being read gets its next frame once the caller has
+   taken all the others, so a slow caller holds memory down rather than letting it grow (keeping
+   every thread busy takes about n_threads GOPs of frames). contexts are opened with the given
+   options, minus decoder threads and read-ahead */
+__extern fas_error_type   fas_parallel_open  (fas_parallel_ref_type *parallel_ptr, char *file_path, int n_threads,
+					      long long max_bytes, fas_open_options_type options);
+
+/* the next frame in display order (the nth call returns frame n-1), for fas_free_frame.
+   FAS_NO_MORE_FRAMES after the last one */
+__extern fas_error_type   fas_parallel_next  (fas_parallel_ref_type parallel, fas_raw_image_type *image_ptr);
+__extern void             fas_parallel_close (fas_parallel_ref_type parallel);
+__extern fas_error_type   fas_get_parallel_stats (fas_parallel_ref_type parallel, fas_parallel_stats_type *stats);
+
 #endif 
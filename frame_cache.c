@@ -0,0 +1,330 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "frame_cache.h"
+
+/**** Defines *****************************************************************/
+
+#define    NUM_BUCKETS             1024      /* power of two */
+
+static void private_unlink (frame_cache_type *cache, frame_cache_entry_type *entry);
+static void private_push_newest (frame_cache_type *cache, frame_cache_entry_type *entry);
+static void private_evict (frame_cache_type *cache, int64_t needed);
+static int  private_make_buckets (frame_cache_type *cache);
+static void private_link (frame_cache_type *cache, frame_cache_entry_type *entry);
+static void private_detach (frame_cache_type *cache, frame_cache_entry_type *entry);
+
+/*
+ * frame_cache_init
+ */
+
+frame_cache_type frame_cache_init (int64_t max_bytes)
+{
+  frame_cache_type cache;
+
+  memset (&cache, 0, sizeof (cache));
+  cache.max_bytes = (max_bytes > 0) ? max_bytes : 0;
+
+  return cache;
+}
+
+/*
+ * frame_cache_release
+ */
+
+void frame_cache_release (frame_cache_type *cache)
+{
+  frame_cache_entry_type *entry = cache->newest;
+
+  while (entry)
+    {
+      frame_cache_entry_type *older = entry->older;
+      free (entry->buffer);
+      free (entry);
+      entry = older;
+    }
+
+  if (cache->buckets)
+    free (cache->buckets);
+
+  cache->newest      = NULL;
+  cache->oldest      = NULL;
+  cache->buckets     = NULL;
+  cache->num_buckets = 0;
+  cache->num_entries = 0;
+  cache->bytes       = 0;
+}
+
+/*
+ * frame_cache_set_limit
+ */
+
+void frame_cache_set_limit (frame_cache_type *cache, int64_t max_bytes)
+{
+  cache->max_bytes = (max_bytes > 0) ? max_bytes : 0;
+  private_evict (cache, 0);
+}
+
+/*
+ * frame_cache_lookup
+ */
+
+frame_cache_entry_type *frame_cache_lookup (frame_cache_type *cache, int frame_index)
+{
+  frame_cache_entry_type *entry = frame_cache_find (cache, frame_index);
+
+  if (NULL == entry)
+    {
+      cache->misses++;
+      return NULL;
+    }
+
+  cache->hits++;
+  private_unlink (cache, entry);
+  private_push_newest (cache, entry);
+
+  return entry;
+}
+
+/*
+ * frame_cache_find
+ */
+
+frame_cache_entry_type *frame_cache_find (frame_cache_type *cache, int frame_index)
+{
+  frame_cache_entry_type *entry = NULL;
+
+  if (cache->buckets)
+    for (entry = cache->buckets[frame_index & (cache->num_buckets - 1)]; entry; entry = entry->bucket_next)
+      if (entry->frame_index == frame_index)
+	break;
+
+  return entry;
+}
+
+/*
+ * frame_cache_insert
+ */
+
+frame_cache_entry_type *frame_cache_insert (frame_cache_type *cache, int frame_index, size_t size, int *is_new)
+{
+  frame_cache_entry_type *entry;
+
+  *is_new = 0;
+
+  if (cache->max_bytes <= 0 || (int64_t) size > cache->max_bytes)
+    return NULL;
+
+  if (!private_make_buckets (cache))
+    return NULL;
+
+  for (entry = cache->buckets[frame_index & (cache->num_buckets - 1)]; entry; entry = entry->bucket_next)
+    if (entry->frame_index == frame_index && entry->size == size)
+      {
+	private_unlink (cache, entry);
+	private_push_newest (cache, entry);
+	return entry;
+      }
+    else if (entry->frame_index == frame_index)
+      {
+	/* stale size (the stream changed geometry): replace it */
+	frame_cache_remove (cache, entry);
+	break;
+      }
+
+  private_evict (cache, (int64_t) size);
+  if (cache->bytes + (int64_t) size > cache->max_bytes)
+    return NULL;   /* everything left is pinned */
+
+  entry = (frame_cache_entry_type *) malloc (sizeof (frame_cache_entry_type));
+  if (NULL == entry)
+    return NULL;
+  memset (entry, 0, sizeof (frame_cache_entry_type));
+
+  entry->buffer = (uint8_t *) malloc (size);
+  if (NULL == entry->buffer)
+    {
+      free (entry);
+      return NULL;
+    }
+
+  entry->frame_index = frame_index;
+  entry->size        = size;
+  private_link (cache, entry);
+
+  *is_new = 1;
+  return entry;
+}
+
+/*
+ * frame_cache_remove
+ */
+
+void frame_cache_remove (frame_cache_type *cache, frame_cache_entry_type *entry)
+{
+  private_detach (cache, entry);
+
+  free (entry->buffer);
+  free (entry);
+}
+
+/*
+ * frame_cache_adopt
+ */
+
+void frame_cache_adopt (frame_cache_type *cache, frame_cache_type *from)
+{
+  /* buffers are moved, not copied; from's recency order is kept on top of cache's */
+  frame_cache_entry_type *entry = from->oldest;
+
+  while (entry)
+    {
+      frame_cache_entry_type *newer = entry->newer;
+      frame_cache_entry_type *existing = frame_cache_find (cache, entry->frame_index);
+
+      private_detach (from, entry);
+      entry->pinned = 0;
+
+      if (NULL == existing && cache->max_bytes > 0 && private_make_buckets (cache))
+	private_evict (cache, (int64_t) entry->size);
+
+      if (NULL == existing && cache->buckets && cache->bytes + (int64_t) entry->size <= cache->max_bytes)
+	private_link (cache, entry);
+      else
+	{
+	  free (entry->buffer);
+	  free (entry);
+	}
+
+      entry = newer;
+    }
+}
+
+/*
+ * private_make_buckets
+ */
+
+static int private_make_buckets (frame_cache_type *cache)
+{
+  if (cache->buckets)
+    return 1;
+
+  cache->buckets = (frame_cache_entry_type **) calloc (NUM_BUCKETS, sizeof (frame_cache_entry_type *));
+  if (NULL == cache->buckets)
+    return 0;
+
+  cache->num_buckets = NUM_BUCKETS;
+  return 1;
+}
+
+/*
+ * private_link
+ */
+
+static void private_link (frame_cache_type *cache, frame_cache_entry_type *entry)
+{
+  int bucket = entry->frame_index & (cache->num_buckets - 1);
+
+  entry->bucket_next = cache->buckets[bucket];
+  cache->buckets[bucket] = entry;
+
+  private_push_newest (cache, entry);
+  cache->bytes += (int64_t) entry->size;
+  cache->num_entries++;
+}
+
+/*
+ * private_detach
+ */
+
+static void private_detach (frame_cache_type *cache, frame_cache_entry_type *entry)
+{
+  frame_cache_entry_type **link = &cache->buckets[entry->frame_index & (cache->num_buckets - 1)];
+
+  while (*link != entry)
+    link = &(*link)->bucket_next;
+  *link = entry->bucket_next;
+  entry->bucket_next = NULL;
+
+  private_unlink (cache, entry);
+  cache->bytes -= (int64_t) entry->size;
+  cache->num_entries--;
+}
+
+/*
+ * private_evict
+ */
+
+static void private_evict (frame_cache_type *cache, int64_t needed)
+{
+  /* drop least recently used, unpinned entries until needed more bytes fit */
+  frame_cache_entry_type *entry = cache->oldest;
+
+  while (entry && cache->bytes + needed > cache->max_bytes)
+    {
+      frame_cache_entry_type *newer = entry->newer;
+      if (!entry->pinned)
+	frame_cache_remove (cache, entry);
+      entry = newer;
+    }
+}
+
+/*
+ * private_unlink
+ */
+
+static void private_unlink (frame_cache_type *cache, frame_cache_entry_type *entry)
+{
+  if (entry->newer)
+    entry->newer->older = entry->older;
+  else
+    cache->newest = entry->older;
+
+  if (entry->older)
+    entry->older->newer = entry->newer;
+  else
+    cache->oldest = entry->newer;
+
+  entry->newer = NULL;
+  entry->older = NULL;
+}
+
+/*
+ * private_push_newest
+ */
+
+static void private_push_newest (frame_cache_type *cache, frame_cache_entry_type *entry)
+{
+  entry->older = cache->newest;
+  entry->newer = NULL;
+
+  if (cache->newest)
+    cache->newest->newer = entry;
+  else
+    cache->oldest = entry;
+
+  cache->newest = entry;
+}
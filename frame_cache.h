@@ -0,0 +1,95 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef FAS_FRAME_CACHE_H
+#define FAS_FRAME_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* If C++ then we need to __extern "C". Compiler defines __cplusplus */
+#ifdef __cplusplus
+#define __extern extern "C"
+#else
+#define __extern extern
+#endif
+
+
+/**********************************************************************
+ * Decoded Frame Cache
+ *
+ * Byte-bounded LRU of frame buffers keyed by display index. The cache
+ * only hands out buffers of the requested size; what goes in them
+ * (the decoder's picture, in its own pixel format) is up to the
+ * caller. Pinned entries are never evicted.
+ **********************************************************************/
+
+typedef struct frame_cache_entry_struct
+{
+  int       frame_index;
+  int       key_frame;
+  int       pinned;
+  uint8_t  *buffer;
+  size_t    size;
+
+  struct frame_cache_entry_struct *newer;        /* LRU list */
+  struct frame_cache_entry_struct *older;
+  struct frame_cache_entry_struct *bucket_next;  /* hash chain */
+} frame_cache_entry_type;
+
+typedef struct
+{
+  int64_t   max_bytes;        /* 0 disables the cache */
+  int64_t   bytes;
+  int       num_entries;
+  int64_t   hits;
+  int64_t   misses;
+
+  frame_cache_entry_type  *newest;
+  frame_cache_entry_type  *oldest;
+  frame_cache_entry_type **buckets;
+  int                      num_buckets;
+} frame_cache_type;
+
+__extern frame_cache_type        frame_cache_init  (int64_t max_bytes);
+__extern void                    frame_cache_release (frame_cache_type *cache);
+__extern void                    frame_cache_set_limit (frame_cache_type *cache, int64_t max_bytes);
+
+/* frame_cache_find neither counts nor reorders */
+__extern frame_cache_entry_type *frame_cache_find   (frame_cache_type *cache, int frame_index);
+
+/* counts a hit or a miss; a hit becomes the most recently used entry */
+__extern frame_cache_entry_type *frame_cache_lookup (frame_cache_type *cache, int frame_index);
+
+/* returns the entry for frame_index, creating it (with a buffer of size bytes, to be filled by
+   the caller) and evicting old entries as needed. *is_new tells whether it must be filled. NULL
+   when the frame cannot be cached (too big for the cache, or out of memory) */
+__extern frame_cache_entry_type *frame_cache_insert (frame_cache_type *cache, int frame_index, size_t size, int *is_new);
+
+/* drops an entry whose buffer could not be filled */
+__extern void                    frame_cache_remove (frame_cache_type *cache, frame_cache_entry_type *entry);
+
+/* moves all of from's entries into cache (evicting as needed), leaving from empty */
+__extern void                    frame_cache_adopt  (frame_cache_type *cache, frame_cache_type *from);
+
+#endif
+
+/**** End of File *****************************************************/
@@ -0,0 +1,199 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "image_pool.h"
+
+/**** Defines *****************************************************************/
+
+#define    NUM_BUCKETS             256       /* power of two */
+
+static unsigned int private_hash (image_pool_type *pool, uint8_t *data);
+static void         private_free_buffer (image_pool_buffer_type *buffer);
+static void         private_trim (image_pool_type *pool);
+
+/*
+ * image_pool_init
+ */
+
+image_pool_type image_pool_init (int max_idle)
+{
+  image_pool_type pool;
+
+  memset (&pool, 0, sizeof (pool));
+  pool.max_idle = (max_idle > 0) ? max_idle : 0;
+
+  return pool;
+}
+
+/*
+ * image_pool_release
+ */
+
+void image_pool_release (image_pool_type *pool)
+{
+  /* lent buffers are remembered, so the caller can still hand them back */
+  image_pool_set_limit (pool, 0);
+}
+
+/*
+ * image_pool_set_limit
+ */
+
+void image_pool_set_limit (image_pool_type *pool, int max_idle)
+{
+  pool->max_idle = (max_idle > 0) ? max_idle : 0;
+  private_trim (pool);
+}
+
+/*
+ * image_pool_get
+ */
+
+uint8_t *image_pool_get (image_pool_type *pool, size_t size)
+{
+  image_pool_buffer_type **link;
+  image_pool_buffer_type *buffer = NULL;
+  unsigned int bucket;
+
+  if (NULL == pool->lent)
+    {
+      pool->lent = (image_pool_buffer_type **) calloc (NUM_BUCKETS, sizeof (image_pool_buffer_type *));
+      if (NULL == pool->lent)
+	return NULL;
+      pool->num_buckets = NUM_BUCKETS;
+    }
+
+  /* the first idle buffer that fits; frames of one video all have the same size */
+  for (link = &pool->idle; *link; link = &(*link)->next)
+    if ((*link)->capacity >= size)
+      {
+	buffer = *link;
+	*link = buffer->next;
+	pool->num_idle--;
+	pool->reuses++;
+	break;
+      }
+
+  if (NULL == buffer)
+    {
+      buffer = (image_pool_buffer_type *) malloc (sizeof (image_pool_buffer_type));
+      if (NULL == buffer)
+	return NULL;
+
+      buffer->block = malloc (size + IMAGE_POOL_ALIGN);
+      if (NULL == buffer->block)
+	{
+	  free (buffer);
+	  return NULL;
+	}
+
+      buffer->data = (uint8_t *) (((uintptr_t) buffer->block + IMAGE_POOL_ALIGN - 1) & ~((uintptr_t) IMAGE_POOL_ALIGN - 1));
+      buffer->capacity = size;
+      pool->allocations++;
+    }
+
+  bucket = private_hash (pool, buffer->data);
+  buffer->next = pool->lent[bucket];
+  pool->lent[bucket] = buffer;
+  pool->num_lent++;
+
+  return buffer->data;
+}
+
+/*
+ * image_pool_put
+ */
+
+int image_pool_put (image_pool_type *pool, uint8_t *data)
+{
+  image_pool_buffer_type **link;
+  image_pool_buffer_type *buffer;
+
+  if (NULL == data || NULL == pool->lent)
+    return 0;
+
+  for (link = &pool->lent[private_hash (pool, data)]; *link; link = &(*link)->next)
+    if ((*link)->data == data)
+      break;
+
+  if (NULL == *link)
+    return 0;
+
+  buffer = *link;
+  *link = buffer->next;
+  pool->num_lent--;
+
+  buffer->next = pool->idle;
+  pool->idle = buffer;
+  pool->num_idle++;
+
+  private_trim (pool);
+  return 1;
+}
+
+/**** Private functions *******************************************************/
+
+static unsigned int private_hash (image_pool_type *pool, uint8_t *data)
+{
+  /* the low bits are all zero (alignment) */
+  uintptr_t key = (uintptr_t) data / IMAGE_POOL_ALIGN;
+
+  return (unsigned int) ((key ^ (key >> 9)) & (pool->num_buckets - 1));
+}
+
+static void private_free_buffer (image_pool_buffer_type *buffer)
+{
+  free (buffer->block);
+  free (buffer);
+}
+
+static void private_trim (image_pool_type *pool)
+{
+  /* the oldest idle buffers are at the end of the list */
+  image_pool_buffer_type **link = &pool->idle;
+  int kept = 0;
+
+  while (*link && kept < pool->max_idle)
+    {
+      link = &(*link)->next;
+      kept++;
+    }
+
+  while (*link)
+    {
+      image_pool_buffer_type *buffer = *link;
+      *link = buffer->next;
+      private_free_buffer (buffer);
+      pool->num_idle--;
+    }
+
+  if (0 == pool->num_lent && 0 == pool->num_idle && pool->lent)
+    {
+      free (pool->lent);
+      pool->lent = NULL;
+      pool->num_buckets = 0;
+    }
+}
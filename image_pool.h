@@ -0,0 +1,82 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef FAS_IMAGE_POOL_H
+#define FAS_IMAGE_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* If C++ then we need to __extern "C". Compiler defines __cplusplus */
+#ifdef __cplusplus
+#define __extern extern "C"
+#else
+#define __extern extern
+#endif
+
+
+/**********************************************************************
+ * Image Buffer Pool
+ *
+ * Reusable, aligned image buffers. Buffers handed out are remembered
+ * until they come back, so image_pool_put can tell them from memory
+ * the pool never lent. Up to max_idle returned buffers are kept for
+ * the next image_pool_get; the rest are freed. Not thread safe.
+ **********************************************************************/
+
+#define IMAGE_POOL_ALIGN    32
+
+typedef struct image_pool_buffer_struct
+{
+  uint8_t  *data;                               /* IMAGE_POOL_ALIGN aligned */
+  void     *block;                              /* as allocated */
+  size_t    capacity;
+
+  struct image_pool_buffer_struct *next;        /* idle list, or hash chain while lent */
+} image_pool_buffer_type;
+
+typedef struct
+{
+  int       max_idle;         /* 0 disables the pool */
+  int       num_idle;
+  int       num_lent;
+  int64_t   allocations;      /* buffers image_pool_get had to allocate */
+  int64_t   reuses;
+
+  image_pool_buffer_type  *idle;                /* most recently returned first */
+  image_pool_buffer_type **lent;                /* hashed by data pointer */
+  int                      num_buckets;
+} image_pool_type;
+
+__extern image_pool_type  image_pool_init      (int max_idle);
+__extern void             image_pool_release   (image_pool_type *pool);
+__extern void             image_pool_set_limit (image_pool_type *pool, int max_idle);
+
+/* a buffer of at least size bytes, reused when an idle one is big enough. NULL when out of
+   memory */
+__extern uint8_t         *image_pool_get (image_pool_type *pool, size_t size);
+
+/* takes back a buffer from image_pool_get (kept idle or freed); 0 if the pool did not lend it */
+__extern int              image_pool_put (image_pool_type *pool, uint8_t *data);
+
+#endif
+
+/**** End of File *****************************************************/
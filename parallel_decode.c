@@ -0,0 +1,455 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ *
+ * This file is part of the Frame Accurate Seeking extension library to
+ * ffmpeg (ffmpeg-fas).
+ *
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "private_errors.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#define SEGMENTS_PER_THREAD   4      // more segments than threads, so uneven GOPs even out
+
+/**** Private Types ***********************************************************/
+
+/* frames first to last, decoded by one thread into frames[] and handed out from there in order */
+typedef struct
+{
+  int                  first;
+  int                  last;
+  fas_raw_image_type  *frames;
+  int                  n_ready;          // decoded so far
+  int                  n_taken;          // given to the caller
+  fas_boolean_type     finished;
+  fas_error_type       error;
+} segment_type;
+
+struct fas_parallel_struct
+{
+  char                 *file_path;
+  fas_open_options_type options;
+  seek_table_type       table;
+  segment_type         *segments;
+  int                   n_segments;
+
+  pthread_t            *threads;
+  fas_boolean_type     *started;
+  int                   n_threads;
+
+  pthread_mutex_t       lock;            // guards everything below and the segments
+  pthread_cond_t        frame_ready;     // a frame or the end of a segment
+  pthread_cond_t        space_free;      // frames taken, or the caller moved on a segment
+  int                   next_segment;    // next one for a thread to take
+  int                   head;            // the one the caller reads from
+  long long             bytes;           // buffered frames
+  long long             peak_bytes;
+  long long             max_bytes;       // <= 0: no limit
+  fas_boolean_type      closing;
+};
+
+static fas_error_type   private_show_error (const char *message, fas_error_type error);
+static fas_error_type   private_find_table (fas_parallel_ref_type parallel);
+static fas_error_type   private_cut_segments (fas_parallel_ref_type parallel);
+static void            *private_decode_segments (void *parallel_ptr);
+static fas_error_type   private_decode_segment (fas_parallel_ref_type parallel, fas_context_ref_type context, int s);
+static fas_boolean_type private_buffer_frame (fas_parallel_ref_type parallel, int s, fas_raw_image_type image);
+
+
+/* fas_parallel_open */
+
+fas_error_type fas_parallel_open (fas_parallel_ref_type *parallel_ptr, char *file_path, int n_threads,
+				  long long max_bytes, fas_open_options_type options)
+{
+  fas_parallel_ref_type parallel;
+  fas_error_type fas_error;
+  int i;
+
+  if (NULL == parallel_ptr || NULL == file_path)
+    return private_show_error ("NULL argument to fas_parallel_open", FAS_INVALID_ARGUMENT);
+
+  *parallel_ptr = NULL;
+
+  if (n_threads < 1)
+    return private_show_error ("parallel decoding needs at least one thread", FAS_INVALID_ARGUMENT);
+
+  parallel = (fas_parallel_ref_type) calloc (1, sizeof (struct fas_parallel_struct));
+  if (NULL == parallel)
+    return private_show_error ("unable to allocate parallel decoder", FAS_OUT_OF_MEMORY);
+
+  /* the segments are the parallelism; tables built below match contexts decoding on one thread */
+  parallel->options              = options;
+  parallel->options.thread_count = 1;
+  parallel->options.read_ahead   = 0;
+  parallel->n_threads            = n_threads;
+  parallel->max_bytes            = max_bytes;
+
+  pthread_mutex_init (&parallel->lock, NULL);
+  pthread_cond_init (&parallel->frame_ready, NULL);
+  pthread_cond_init (&parallel->space_free, NULL);
+
+  parallel->file_path = (char *) malloc (strlen (file_path) + 1);
+  parallel->threads   = (pthread_t *) calloc (n_threads, sizeof (pthread_t));
+  parallel->started   = (fas_boolean_type *) calloc (n_threads, sizeof (fas_boolean_type));
+  if (NULL == parallel->file_path || NULL == parallel->threads || NULL == parallel->started)
+    {
+      fas_parallel_close (parallel);
+      return private_show_error ("unable to allocate parallel decoder", FAS_OUT_OF_MEMORY);
+    }
+  strcpy (parallel->file_path, file_path);
+
+  fas_error = private_find_table (parallel);
+  if (FAS_SUCCESS == fas_error)
+    fas_error = private_cut_segments (parallel);
+
+  if (FAS_SUCCESS != fas_error)
+    {
+      fas_parallel_close (parallel);
+      return fas_error;
+    }
+
+  /* no more threads than segments */
+  for (i=0;i<n_threads && i<parallel->n_segments;i++)
+    {
+      parallel->started[i] = (pthread_create (&parallel->threads[i], NULL, private_decode_segments, parallel) == 0)
+	? FAS_TRUE : FAS_FALSE;
+
+      if (!parallel->started[i])
+	{
+	  fas_parallel_close (parallel);
+	  return private_show_error ("unable to start decoding thread", FAS_FAILURE);
+	}
+    }
+
+  *parallel_ptr = parallel;
+  return FAS_SUCCESS;
+}
+
+/* fas_parallel_next */
+
+fas_error_type fas_parallel_next (fas_parallel_ref_type parallel, fas_raw_image_type *image_ptr)
+{
+  fas_error_type fas_error = FAS_SUCCESS;
+
+  if (NULL == parallel || NULL == image_ptr)
+    return private_show_error ("NULL parallel decoder or image", FAS_INVALID_ARGUMENT);
+
+  pthread_mutex_lock (&parallel->lock);
+  for (;;)
+    {
+      if (parallel->head == parallel->n_segments)
+	{
+	  fas_error = FAS_NO_MORE_FRAMES;
+	  break;
+	}
+
+      segment_type *segment = &parallel->segments[parallel->head];
+
+      if (segment->n_taken < segment->n_ready)
+	{
+	  *image_ptr = segment->frames[segment->n_taken++];
+	  parallel->bytes -= (long long) image_ptr->bytes_per_line * image_ptr->height;
+	  pthread_cond_broadcast (&parallel->space_free);
+	  break;
+	}
+
+      if (FAS_SUCCESS != segment->error)
+	{
+	  fas_error = segment->error;
+	  break;
+	}
+
+      if (segment->finished)
+	{
+	  free (segment->frames);
+	  segment->frames = NULL;
+	  parallel->head++;
+	  pthread_cond_broadcast (&parallel->space_free);
+	  continue;
+	}
+
+      pthread_cond_wait (&parallel->frame_ready, &parallel->lock);
+    }
+  pthread_mutex_unlock (&parallel->lock);
+
+  if (FAS_SUCCESS != fas_error && FAS_NO_MORE_FRAMES != fas_error)
+    return private_show_error ("a segment failed to decode", fas_error);
+
+  return fas_error;
+}
+
+/* fas_get_parallel_stats */
+
+fas_error_type fas_get_parallel_stats (fas_parallel_ref_type parallel, fas_parallel_stats_type *stats)
+{
+  if (NULL == parallel || NULL == stats)
+    return private_show_error ("NULL parallel decoder or stats", FAS_INVALID_ARGUMENT);
+
+  pthread_mutex_lock (&parallel->lock);
+  stats->bytes      = parallel->bytes;
+  stats->peak_bytes = parallel->peak_bytes;
+  pthread_mutex_unlock (&parallel->lock);
+
+  return FAS_SUCCESS;
+}
+
+/* fas_parallel_close */
+
+void fas_parallel_close (fas_parallel_ref_type parallel)
+{
+  int i, j;
+
+  if (NULL == parallel)
+    return;
+
+  pthread_mutex_lock (&parallel->lock);
+  parallel->closing = FAS_TRUE;
+  pthread_cond_broadcast (&parallel->space_free);
+  pthread_mutex_unlock (&parallel->lock);
+
+  for (i=0;i<parallel->n_threads;i++)
+    if (parallel->started && parallel->started[i])
+      pthread_join (parallel->threads[i], NULL);
+
+  for (i=0;i<parallel->n_segments;i++)
+    if (parallel->segments[i].frames)
+      {
+	for (j=parallel->segments[i].n_taken;j<parallel->segments[i].n_ready;j++)
+	  fas_free_frame (parallel->segments[i].frames[j]);
+	free (parallel->segments[i].frames);
+      }
+
+  seek_release_table (&parallel->table);
+
+  pthread_cond_destroy (&parallel->space_free);
+  pthread_cond_destroy (&parallel->frame_ready);
+  pthread_mutex_destroy (&parallel->lock);
+
+  free (parallel->segments);
+  free (parallel->started);
+  free (parallel->threads);
+  free (parallel->file_path);
+  free (parallel);
+}
+
+
+/* private_find_table: the file's cached table if it has one, else one built from packets, else
+   one built by decoding on n_threads */
+
+static fas_error_type private_find_table (fas_parallel_ref_type parallel)
+{
+  fas_context_ref_type context;
+  fas_error_type fas_error;
+
+  fas_error = fas_open_video_with_options (&context, parallel->file_path, parallel->options);
+  if (FAS_SUCCESS != fas_error)
+    return private_show_error ("unable to open video", fas_error);
+
+  seek_table_type table = fas_get_seek_table (context);
+  if (seek_true == table.completed)
+    parallel->table = seek_copy_table (table);
+  fas_close_video (context);
+
+  if (seek_true == parallel->table.completed)
+    return FAS_SUCCESS;
+
+  seek_release_table (&parallel->table);
+  if (FAS_SUCCESS == fas_build_seek_table (parallel->file_path, FAS_INDEX_PACKETS, &parallel->table))
+    return FAS_SUCCESS;
+
+  seek_release_table (&parallel->table);
+  fas_error = fas_build_seek_table_parallel (parallel->file_path, parallel->n_threads, &parallel->table);
+  if (FAS_SUCCESS != fas_error)
+    return private_show_error ("unable to build a seek table", fas_error);
+
+  return FAS_SUCCESS;
+}
+
+/* private_cut_segments: at the first keyframe at least a segment length after the last cut */
+
+static fas_error_type private_cut_segments (fas_parallel_ref_type parallel)
+{
+  seek_table_type *table = &parallel->table;
+  int length = table->num_frames / (parallel->n_threads * SEGMENTS_PER_THREAD);
+  int start = 0;
+  int entry;
+
+  if (table->num_frames <= 0)
+    return FAS_SUCCESS;
+
+  parallel->segments = (segment_type *) calloc (table->num_entries + 1, sizeof (segment_type));
+  if (NULL == parallel->segments)
+    return private_show_error ("unable to allocate segments", FAS_OUT_OF_MEMORY);
+
+  for (entry=0;entry<table->num_entries;entry++)
+    {
+      int key = table->array[entry].display_index;
+
+      if (key >= table->num_frames)
+	break;
+      if (key > start && key - start >= length)
+	{
+	  parallel->segments[parallel->n_segments].first = start;
+	  parallel->segments[parallel->n_segments].last  = key - 1;
+	  parallel->n_segments++;
+	  start = key;
+	}
+    }
+
+  parallel->segments[parallel->n_segments].first = start;
+  parallel->segments[parallel->n_segments].last  = table->num_frames - 1;
+  parallel->n_segments++;
+
+  return FAS_SUCCESS;
+}
+
+/* private_decode_segments: one thread, taking segments in order until none are left */
+
+static void *private_decode_segments (void *parallel_ptr)
+{
+  fas_parallel_ref_type parallel = (fas_parallel_ref_type) parallel_ptr;
+  fas_context_ref_type context = NULL;
+  fas_error_type fas_error;
+  int s;
+
+  for (;;)
+    {
+      pthread_mutex_lock (&parallel->lock);
+      s = parallel->next_segment;
+      if (parallel->closing || s == parallel->n_segments)
+	{
+	  pthread_mutex_unlock (&parallel->lock);
+	  break;
+	}
+      parallel->next_segment++;
+      pthread_mutex_unlock (&parallel->lock);
+
+      if (NULL == context)
+	{
+	  fas_error = fas_open_video_with_options (&context, parallel->file_path, parallel->options);
+	  if (FAS_SUCCESS == fas_error)
+	    fas_error = fas_put_seek_table (context, parallel->table);
+	}
+      else
+	fas_error = FAS_SUCCESS;
+
+      if (FAS_SUCCESS == fas_error)
+	fas_error = private_decode_segment (parallel, context, s);
+
+      pthread_mutex_lock (&parallel->lock);
+      parallel->segments[s].finished = FAS_TRUE;
+      parallel->segments[s].error    = fas_error;
+      pthread_cond_broadcast (&parallel->frame_ready);
+      pthread_mutex_unlock (&parallel->lock);
+
+      /* the caller stops at the failed segment, so later ones are not needed */
+      if (FAS_SUCCESS != fas_error)
+	break;
+    }
+
+  if (NULL != context)
+    fas_close_video (context);
+
+  return NULL;
+}
+
+/* private_decode_segment */
+
+static fas_error_type private_decode_segment (fas_parallel_ref_type parallel, fas_context_ref_type context, int s)
+{
+  segment_type *segment = &parallel->segments[s];
+  fas_raw_image_type image;
+  fas_error_type fas_error;
+  int index;
+
+  segment->frames = (fas_raw_image_type *) malloc ((segment->last - segment->first + 1) * sizeof (fas_raw_image_type));
+  if (NULL == segment->frames)
+    return private_show_error ("unable to allocate segment frames", FAS_OUT_OF_MEMORY);
+
+  fas_error = fas_seek_to_frame (context, segment->first);
+  if (FAS_SUCCESS != fas_error)
+    return private_show_error ("unable to seek to the start of a segment", fas_error);
+
+  for (index=segment->first;index<=segment->last;index++)
+    {
+      if (!fas_frame_available (context) || fas_get_frame_index (context) != index)
+	return private_show_error ("segment ended before the seek table says", FAS_DECODING_ERROR);
+
+      fas_error = fas_get_frame (context, &image);
+      if (FAS_SUCCESS != fas_error)
+	return private_show_error ("unable to get a segment frame", fas_error);
+
+      if (!private_buffer_frame (parallel, s, image))
+	return FAS_SUCCESS;
+
+      if (index < segment->last)
+	{
+	  fas_error = fas_step_forward (context);
+	  if (FAS_SUCCESS != fas_error)
+	    return private_show_error ("unable to step through a segment", fas_error);
+	}
+    }
+
+  return FAS_SUCCESS;
+}
+
+/* private_buffer_frame: waits for room in the budget. the segment the caller is reading only
+   skips the wait when the caller has taken all of its frames: the caller and the other threads
+   would wait on each other otherwise, and the budget is then exceeded by this one frame.
+   FAS_FALSE when closing; the frame is freed then */
+
+static fas_boolean_type private_buffer_frame (fas_parallel_ref_type parallel, int s, fas_raw_image_type image)
+{
+  long long size = (long long) image.bytes_per_line * image.height;
+  segment_type *segment = &parallel->segments[s];
+
+  pthread_mutex_lock (&parallel->lock);
+  while (!parallel->closing && parallel->max_bytes > 0 &&
+	 parallel->bytes > 0 && parallel->bytes + size > parallel->max_bytes &&
+	 !(s == parallel->head && segment->n_taken == segment->n_ready))
+    pthread_cond_wait (&parallel->space_free, &parallel->lock);
+
+  if (parallel->closing)
+    {
+      pthread_mutex_unlock (&parallel->lock);
+      fas_free_frame (image);
+      return FAS_FALSE;
+    }
+
+  segment->frames[segment->n_ready++] = image;
+  parallel->bytes += size;
+  if (parallel->bytes > parallel->peak_bytes)
+    parallel->peak_bytes = parallel->bytes;
+  pthread_cond_broadcast (&parallel->frame_ready);
+  pthread_mutex_unlock (&parallel->lock);
+
+  return FAS_TRUE;
+}
+
+/* private_show_error */
+
+static fas_error_type private_show_error (const char *message, fas_error_type error)
+{
+  if (SHOW_ERROR_MESSAGES)
+    fprintf (stderr, " ===> parallel_decode: %s\n", message);
+  return error;
+}
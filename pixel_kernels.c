@@ -0,0 +1,561 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pixel_kernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* AVX2 functions are compiled for their own target and only called when the CPU has it */
+#if defined(HAVE_SSE2) && defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+/**** Defines *****************************************************************/
+
+/* BT.601 limited range, times 64 */
+#define    Y_OFFSET                16
+#define    C_OFFSET                128
+#define    Y_MUL                   75
+#define    RV_MUL                  102
+#define    GU_MUL                  25
+#define    GV_MUL                  52
+#define    BU_MUL                  129
+#define    ROUND                   32
+#define    SHIFT                   6
+
+typedef struct
+{
+  int bytes_per_pixel;
+  int channel_at[4];          /* which of r, g, b, a (0..3) goes in each byte of a pixel */
+} pixel_layout_type;
+
+static const pixel_layout_type gbl_layouts[] =
+  {
+    { 3, { 0, 1, 2, 0 } },    /* PIXEL_RGB24 */
+    { 3, { 2, 1, 0, 0 } },    /* PIXEL_BGR24 */
+    { 4, { 0, 1, 2, 3 } },    /* PIXEL_RGBA */
+    { 4, { 2, 1, 0, 3 } },    /* PIXEL_BGRA */
+    { 4, { 3, 0, 1, 2 } },    /* PIXEL_ARGB */
+    { 4, { 3, 2, 1, 0 } },    /* PIXEL_ABGR */
+  };
+
+/* set once, on first use; every thread computes the same value */
+static int gbl_level = -1;
+
+static int  private_supported (pixel_level_type level);
+static void private_row_420_scalar (uint8_t *dst, const pixel_layout_type *layout, const uint8_t *y,
+				    const uint8_t *u, const uint8_t *v, int x, int width);
+static void private_row_422_scalar (uint8_t *y, uint8_t *u, uint8_t *v, const uint8_t *src, int uyvy, int x, int width);
+static void private_interleave (uint8_t *dst, const pixel_layout_type *layout, const uint8_t *r, const uint8_t *g,
+				const uint8_t *b, int n);
+
+/*
+ * pixel_best_level
+ */
+
+pixel_level_type pixel_best_level (void)
+{
+  if (private_supported (PIXEL_AVX2))
+    return PIXEL_AVX2;
+  if (private_supported (PIXEL_SSE2))
+    return PIXEL_SSE2;
+  if (private_supported (PIXEL_NEON))
+    return PIXEL_NEON;
+
+  return PIXEL_SCALAR;
+}
+
+/*
+ * pixel_get_level
+ */
+
+pixel_level_type pixel_get_level (void)
+{
+  if (gbl_level < 0)
+    gbl_level = pixel_best_level ();
+
+  return (pixel_level_type) gbl_level;
+}
+
+/*
+ * pixel_set_level
+ */
+
+pixel_level_type pixel_set_level (pixel_level_type level)
+{
+  if (private_supported (level))
+    gbl_level = level;
+
+  return pixel_get_level ();
+}
+
+/*
+ * pixel_copy_plane
+ */
+
+void pixel_copy_plane (uint8_t *dst, int dst_stride, const uint8_t *src, int src_stride, int row_bytes, int rows)
+{
+  int j;
+
+  if (rows <= 0 || row_bytes <= 0)
+    return;
+
+  if (dst_stride == row_bytes && src_stride == row_bytes)
+    {
+      memcpy (dst, src, (size_t) row_bytes * rows);
+      return;
+    }
+
+  for (j = 0; j < rows; j++)
+    memcpy (dst + (size_t) j * dst_stride, src + (size_t) j * src_stride, row_bytes);
+}
+
+/**** YUV 4:2:0 to packed RGB *************************************************/
+
+static void private_row_420_scalar (uint8_t *dst, const pixel_layout_type *layout, const uint8_t *y,
+				    const uint8_t *u, const uint8_t *v, int x, int width)
+{
+  int channel[4];
+  int k;
+
+  channel[3] = 255;
+  for (; x < width; x++)
+    {
+      int luma = (y[x] - Y_OFFSET) * Y_MUL;
+      int cb   = u[x >> 1] - C_OFFSET;
+      int cr   = v[x >> 1] - C_OFFSET;
+
+      channel[0] = (luma + RV_MUL * cr + ROUND) >> SHIFT;
+      channel[1] = (luma - GU_MUL * cb - GV_MUL * cr + ROUND) >> SHIFT;
+      channel[2] = (luma + BU_MUL * cb + ROUND) >> SHIFT;
+
+      for (k = 0; k < 3; k++)
+	channel[k] = channel[k] < 0 ? 0 : (channel[k] > 255 ? 255 : channel[k]);
+
+      for (k = 0; k < layout->bytes_per_pixel; k++)
+	dst[x * layout->bytes_per_pixel + k] = (uint8_t) channel[layout->channel_at[k]];
+    }
+}
+
+static void private_interleave (uint8_t *dst, const pixel_layout_type *layout, const uint8_t *r, const uint8_t *g,
+				const uint8_t *b, int n)
+{
+  /* three-byte pixels from separate channels */
+  uint8_t *at[3];
+  int i;
+
+  at[layout->channel_at[0]] = dst;
+  at[layout->channel_at[1]] = dst + 1;
+  at[layout->channel_at[2]] = dst + 2;
+
+  for (i = 0; i < n; i++)
+    {
+      at[0][3 * i] = r[i];
+      at[1][3 * i] = g[i];
+      at[2][3 * i] = b[i];
+    }
+}
+
+#ifdef HAVE_SSE2
+
+/* 16 pixels of channels (r, g, b, a) stored in layout order */
+static void private_store_sse2 (uint8_t *dst, const pixel_layout_type *layout, __m128i r, __m128i g, __m128i b, __m128i a)
+{
+  __m128i channel[4], lo01, hi01, lo23, hi23;
+  uint8_t rs[16], gs[16], bs[16];
+
+  if (3 == layout->bytes_per_pixel)
+    {
+      _mm_storeu_si128 ((__m128i *) rs, r);
+      _mm_storeu_si128 ((__m128i *) gs, g);
+      _mm_storeu_si128 ((__m128i *) bs, b);
+      private_interleave (dst, layout, rs, gs, bs, 16);
+      return;
+    }
+
+  channel[0] = r;
+  channel[1] = g;
+  channel[2] = b;
+  channel[3] = a;
+
+  lo01 = _mm_unpacklo_epi8 (channel[layout->channel_at[0]], channel[layout->channel_at[1]]);
+  hi01 = _mm_unpackhi_epi8 (channel[layout->channel_at[0]], channel[layout->channel_at[1]]);
+  lo23 = _mm_unpacklo_epi8 (channel[layout->channel_at[2]], channel[layout->channel_at[3]]);
+  hi23 = _mm_unpackhi_epi8 (channel[layout->channel_at[2]], channel[layout->channel_at[3]]);
+
+  _mm_storeu_si128 ((__m128i *) (dst),      _mm_unpacklo_epi16 (lo01, lo23));
+  _mm_storeu_si128 ((__m128i *) (dst + 16), _mm_unpackhi_epi16 (lo01, lo23));
+  _mm_storeu_si128 ((__m128i *) (dst + 32), _mm_unpacklo_epi16 (hi01, hi23));
+  _mm_storeu_si128 ((__m128i *) (dst + 48), _mm_unpackhi_epi16 (hi01, hi23));
+}
+
+static void private_row_420_sse2 (uint8_t *dst, const pixel_layout_type *layout, const uint8_t *y,
+				  const uint8_t *u, const uint8_t *v, int width)
+{
+  const __m128i zero     = _mm_setzero_si128 ();
+  const __m128i y_offset = _mm_set1_epi16 (Y_OFFSET);
+  const __m128i c_offset = _mm_set1_epi16 (C_OFFSET);
+  const __m128i round    = _mm_set1_epi16 (ROUND);
+  const __m128i alpha    = _mm_set1_epi8 ((char) 0xFF);
+  int x;
+
+  for (x = 0; x + 16 <= width; x += 16)
+    {
+      __m128i yy = _mm_loadu_si128 ((const __m128i *) (y + x));
+      __m128i uu = _mm_sub_epi16 (_mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) (u + x / 2)), zero), c_offset);
+      __m128i vv = _mm_sub_epi16 (_mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) (v + x / 2)), zero), c_offset);
+
+      __m128i rv = _mm_mullo_epi16 (vv, _mm_set1_epi16 (RV_MUL));
+      __m128i gc = _mm_adds_epi16 (_mm_mullo_epi16 (uu, _mm_set1_epi16 (GU_MUL)), _mm_mullo_epi16 (vv, _mm_set1_epi16 (GV_MUL)));
+      __m128i bu = _mm_mullo_epi16 (uu, _mm_set1_epi16 (BU_MUL));
+
+      __m128i y_lo = _mm_mullo_epi16 (_mm_sub_epi16 (_mm_unpacklo_epi8 (yy, zero), y_offset), _mm_set1_epi16 (Y_MUL));
+      __m128i y_hi = _mm_mullo_epi16 (_mm_sub_epi16 (_mm_unpackhi_epi8 (yy, zero), y_offset), _mm_set1_epi16 (Y_MUL));
+
+      /* each chroma sample covers two pixels; saturation only happens where the result clips */
+#define SSE2_CHANNEL(op, term)									\
+      _mm_packus_epi16 (_mm_srai_epi16 (_mm_adds_epi16 (op (y_lo, _mm_unpacklo_epi16 (term, term)), round), SHIFT), \
+			_mm_srai_epi16 (_mm_adds_epi16 (op (y_hi, _mm_unpackhi_epi16 (term, term)), round), SHIFT))
+
+      __m128i r = SSE2_CHANNEL (_mm_adds_epi16, rv);
+      __m128i g = SSE2_CHANNEL (_mm_subs_epi16, gc);
+      __m128i b = SSE2_CHANNEL (_mm_adds_epi16, bu);
+#undef SSE2_CHANNEL
+
+      private_store_sse2 (dst + x * layout->bytes_per_pixel, layout, r, g, b, alpha);
+    }
+
+  private_row_420_scalar (dst, layout, y, u, v, x, width);
+}
+
+#endif /* HAVE_SSE2 */
+
+#ifdef HAVE_AVX2
+
+__attribute__ ((target ("avx2")))
+static void private_row_420_avx2 (uint8_t *dst, const pixel_layout_type *layout, const uint8_t *y,
+				  const uint8_t *u, const uint8_t *v, int width)
+{
+  const __m256i y_offset = _mm256_set1_epi16 (Y_OFFSET);
+  const __m256i c_offset = _mm256_set1_epi16 (C_OFFSET);
+  const __m256i round    = _mm256_set1_epi16 (ROUND);
+  const __m128i alpha    = _mm_set1_epi8 ((char) 0xFF);
+  int x;
+
+  for (x = 0; x + 32 <= width; x += 32)
+    {
+      __m256i y_lo = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) (y + x)));
+      __m256i y_hi = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) (y + x + 16)));
+      __m256i uu   = _mm256_sub_epi16 (_mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) (u + x / 2))), c_offset);
+      __m256i vv   = _mm256_sub_epi16 (_mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) (v + x / 2))), c_offset);
+
+      y_lo = _mm256_mullo_epi16 (_mm256_sub_epi16 (y_lo, y_offset), _mm256_set1_epi16 (Y_MUL));
+      y_hi = _mm256_mullo_epi16 (_mm256_sub_epi16 (y_hi, y_offset), _mm256_set1_epi16 (Y_MUL));
+
+      __m256i rv = _mm256_mullo_epi16 (vv, _mm256_set1_epi16 (RV_MUL));
+      __m256i gc = _mm256_adds_epi16 (_mm256_mullo_epi16 (uu, _mm256_set1_epi16 (GU_MUL)),
+				      _mm256_mullo_epi16 (vv, _mm256_set1_epi16 (GV_MUL)));
+      __m256i bu = _mm256_mullo_epi16 (uu, _mm256_set1_epi16 (BU_MUL));
+
+      /* unpacks stay inside 128-bit lanes: duplicate, then put the halves back in pixel order,
+	 and after packing restore the order of the four 8-pixel groups */
+#define AVX2_CHANNEL(op, term, out)								\
+      {												\
+	__m256i dup_a = _mm256_unpacklo_epi16 (term, term);					\
+	__m256i dup_b = _mm256_unpackhi_epi16 (term, term);					\
+	__m256i lo = _mm256_srai_epi16 (_mm256_adds_epi16 (op (y_lo, _mm256_permute2x128_si256 (dup_a, dup_b, 0x20)), round), SHIFT); \
+	__m256i hi = _mm256_srai_epi16 (_mm256_adds_epi16 (op (y_hi, _mm256_permute2x128_si256 (dup_a, dup_b, 0x31)), round), SHIFT); \
+	out = _mm256_permute4x64_epi64 (_mm256_packus_epi16 (lo, hi), 0xD8);			\
+      }
+
+      __m256i r, g, b;
+      AVX2_CHANNEL (_mm256_adds_epi16, rv, r);
+      AVX2_CHANNEL (_mm256_subs_epi16, gc, g);
+      AVX2_CHANNEL (_mm256_adds_epi16, bu, b);
+#undef AVX2_CHANNEL
+
+      uint8_t *out = dst + x * layout->bytes_per_pixel;
+      private_store_sse2 (out, layout, _mm256_castsi256_si128 (r), _mm256_castsi256_si128 (g),
+			  _mm256_castsi256_si128 (b), alpha);
+      private_store_sse2 (out + 16 * layout->bytes_per_pixel, layout, _mm256_extracti128_si256 (r, 1),
+			  _mm256_extracti128_si256 (g, 1), _mm256_extracti128_si256 (b, 1), alpha);
+    }
+
+  private_row_420_sse2 (dst + x * layout->bytes_per_pixel, layout, y + x, u + x / 2, v + x / 2, width - x);
+}
+
+#endif /* HAVE_AVX2 */
+
+#ifdef HAVE_NEON
+
+static void private_row_420_neon (uint8_t *dst, const pixel_layout_type *layout, const uint8_t *y,
+				  const uint8_t *u, const uint8_t *v, int width)
+{
+  const int16x8_t y_offset = vdupq_n_s16 (Y_OFFSET);
+  const int16x8_t c_offset = vdupq_n_s16 (C_OFFSET);
+  const int16x8_t round    = vdupq_n_s16 (ROUND);
+  int x;
+
+  for (x = 0; x + 16 <= width; x += 16)
+    {
+      uint8x16_t yy = vld1q_u8 (y + x);
+      int16x8_t  uu = vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (u + x / 2))), c_offset);
+      int16x8_t  vv = vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (v + x / 2))), c_offset);
+
+      int16x8_t y_lo = vmulq_n_s16 (vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (vget_low_u8 (yy))), y_offset), Y_MUL);
+      int16x8_t y_hi = vmulq_n_s16 (vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (vget_high_u8 (yy))), y_offset), Y_MUL);
+
+      int16x8x2_t rv = vzipq_s16 (vmulq_n_s16 (vv, RV_MUL), vmulq_n_s16 (vv, RV_MUL));
+      int16x8_t   gc_single = vqaddq_s16 (vmulq_n_s16 (uu, GU_MUL), vmulq_n_s16 (vv, GV_MUL));
+      int16x8x2_t gc = vzipq_s16 (gc_single, gc_single);
+      int16x8x2_t bu = vzipq_s16 (vmulq_n_s16 (uu, BU_MUL), vmulq_n_s16 (uu, BU_MUL));
+
+      uint8x16_t channel[4];
+      channel[0] = vcombine_u8 (vqmovun_s16 (vshrq_n_s16 (vqaddq_s16 (vqaddq_s16 (y_lo, rv.val[0]), round), SHIFT)),
+				vqmovun_s16 (vshrq_n_s16 (vqaddq_s16 (vqaddq_s16 (y_hi, rv.val[1]), round), SHIFT)));
+      channel[1] = vcombine_u8 (vqmovun_s16 (vshrq_n_s16 (vqaddq_s16 (vqsubq_s16 (y_lo, gc.val[0]), round), SHIFT)),
+				vqmovun_s16 (vshrq_n_s16 (vqaddq_s16 (vqsubq_s16 (y_hi, gc.val[1]), round), SHIFT)));
+      channel[2] = vcombine_u8 (vqmovun_s16 (vshrq_n_s16 (vqaddq_s16 (vqaddq_s16 (y_lo, bu.val[0]), round), SHIFT)),
+				vqmovun_s16 (vshrq_n_s16 (vqaddq_s16 (vqaddq_s16 (y_hi, bu.val[1]), round), SHIFT)));
+      channel[3] = vdupq_n_u8 (255);
+
+      if (3 == layout->bytes_per_pixel)
+	{
+	  uint8x16x3_t pixels;
+	  pixels.val[0] = channel[layout->channel_at[0]];
+	  pixels.val[1] = channel[layout->channel_at[1]];
+	  pixels.val[2] = channel[layout->channel_at[2]];
+	  vst3q_u8 (dst + x * 3, pixels);
+	}
+      else
+	{
+	  uint8x16x4_t pixels;
+	  pixels.val[0] = channel[layout->channel_at[0]];
+	  pixels.val[1] = channel[layout->channel_at[1]];
+	  pixels.val[2] = channel[layout->channel_at[2]];
+	  pixels.val[3] = channel[layout->channel_at[3]];
+	  vst4q_u8 (dst + x * 4, pixels);
+	}
+    }
+
+  private_row_420_scalar (dst, layout, y, u, v, x, width);
+}
+
+#endif /* HAVE_NEON */
+
+/*
+ * pixel_yuv420p_to_packed
+ */
+
+void pixel_yuv420p_to_packed (uint8_t *dst, int dst_stride, pixel_order_type order,
+			      const uint8_t *y, int y_stride, const uint8_t *u, int u_stride,
+			      const uint8_t *v, int v_stride, int width, int height)
+{
+  const pixel_layout_type *layout = &gbl_layouts[order];
+  pixel_level_type level = pixel_get_level ();
+  int j;
+
+  for (j = 0; j < height; j++)
+    {
+      uint8_t       *dst_row = dst + (size_t) j * dst_stride;
+      const uint8_t *y_row   = y + (size_t) j * y_stride;
+      const uint8_t *u_row   = u + (size_t) (j >> 1) * u_stride;
+      const uint8_t *v_row   = v + (size_t) (j >> 1) * v_stride;
+
+      switch (level)
+	{
+#ifdef HAVE_AVX2
+	case PIXEL_AVX2:
+	  private_row_420_avx2 (dst_row, layout, y_row, u_row, v_row, width);
+	  break;
+#endif
+#ifdef HAVE_SSE2
+	case PIXEL_SSE2:
+	  private_row_420_sse2 (dst_row, layout, y_row, u_row, v_row, width);
+	  break;
+#endif
+#ifdef HAVE_NEON
+	case PIXEL_NEON:
+	  private_row_420_neon (dst_row, layout, y_row, u_row, v_row, width);
+	  break;
+#endif
+	default:
+	  private_row_420_scalar (dst_row, layout, y_row, u_row, v_row, 0, width);
+	  break;
+	}
+    }
+}
+
+/**** Packed 4:2:2 to planar **************************************************/
+
+static void private_row_422_scalar (uint8_t *y, uint8_t *u, uint8_t *v, const uint8_t *src, int uyvy, int x, int width)
+{
+  int y_at = uyvy ? 1 : 0;
+  int u_at = uyvy ? 0 : 1;
+  int v_at = uyvy ? 2 : 3;
+
+  for (; x < width; x += 2)
+    {
+      const uint8_t *pair = src + 2 * x;
+
+      y[x]     = pair[y_at];
+      u[x / 2] = pair[u_at];
+      v[x / 2] = pair[v_at];
+      if (x + 1 < width)
+	y[x + 1] = pair[y_at + 2];
+    }
+}
+
+#ifdef HAVE_SSE2
+
+static void private_row_422_sse2 (uint8_t *y, uint8_t *u, uint8_t *v, const uint8_t *src, int uyvy, int width)
+{
+  const __m128i low_bytes = _mm_set1_epi16 (0x00FF);
+  const __m128i zero      = _mm_setzero_si128 ();
+  int x;
+
+  for (x = 0; x + 16 <= width; x += 16)
+    {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (src + 2 * x));
+      __m128i b = _mm_loadu_si128 ((const __m128i *) (src + 2 * x + 16));
+      __m128i luma, chroma;
+
+      if (uyvy)
+	{
+	  luma   = _mm_packus_epi16 (_mm_srli_epi16 (a, 8), _mm_srli_epi16 (b, 8));
+	  chroma = _mm_packus_epi16 (_mm_and_si128 (a, low_bytes), _mm_and_si128 (b, low_bytes));
+	}
+      else
+	{
+	  luma   = _mm_packus_epi16 (_mm_and_si128 (a, low_bytes), _mm_and_si128 (b, low_bytes));
+	  chroma = _mm_packus_epi16 (_mm_srli_epi16 (a, 8), _mm_srli_epi16 (b, 8));
+	}
+
+      /* chroma is u0 v0 u1 v1 ... */
+      _mm_storeu_si128 ((__m128i *) (y + x), luma);
+      _mm_storel_epi64 ((__m128i *) (u + x / 2), _mm_packus_epi16 (_mm_and_si128 (chroma, low_bytes), zero));
+      _mm_storel_epi64 ((__m128i *) (v + x / 2), _mm_packus_epi16 (_mm_srli_epi16 (chroma, 8), zero));
+    }
+
+  private_row_422_scalar (y, u, v, src, uyvy, x, width);
+}
+
+#endif /* HAVE_SSE2 */
+
+#ifdef HAVE_NEON
+
+static void private_row_422_neon (uint8_t *y, uint8_t *u, uint8_t *v, const uint8_t *src, int uyvy, int width)
+{
+  int x;
+
+  for (x = 0; x + 16 <= width; x += 16)
+    {
+      uint8x8x4_t pairs = vld4_u8 (src + 2 * x);
+      uint8x8x2_t luma;
+
+      luma.val[0] = pairs.val[uyvy ? 1 : 0];
+      luma.val[1] = pairs.val[uyvy ? 3 : 2];
+      vst2_u8 (y + x, luma);
+      vst1_u8 (u + x / 2, pairs.val[uyvy ? 0 : 1]);
+      vst1_u8 (v + x / 2, pairs.val[uyvy ? 2 : 3]);
+    }
+
+  private_row_422_scalar (y, u, v, src, uyvy, x, width);
+}
+
+#endif /* HAVE_NEON */
+
+/*
+ * pixel_packed422_to_planar
+ */
+
+void pixel_packed422_to_planar (uint8_t *y, int y_stride, uint8_t *u, int u_stride, uint8_t *v, int v_stride,
+				const uint8_t *src, int src_stride, int uyvy, int width, int height)
+{
+  pixel_level_type level = pixel_get_level ();
+  int j;
+
+  for (j = 0; j < height; j++)
+    {
+      uint8_t       *y_row   = y + (size_t) j * y_stride;
+      uint8_t       *u_row   = u + (size_t) j * u_stride;
+      uint8_t       *v_row   = v + (size_t) j * v_stride;
+      const uint8_t *src_row = src + (size_t) j * src_stride;
+
+      switch (level)
+	{
+#ifdef HAVE_SSE2
+	case PIXEL_AVX2:      /* memory bound: AVX2 gains nothing over SSE2 here */
+	case PIXEL_SSE2:
+	  private_row_422_sse2 (y_row, u_row, v_row, src_row, uyvy, width);
+	  break;
+#endif
+#ifdef HAVE_NEON
+	case PIXEL_NEON:
+	  private_row_422_neon (y_row, u_row, v_row, src_row, uyvy, width);
+	  break;
+#endif
+	default:
+	  private_row_422_scalar (y_row, u_row, v_row, src_row, uyvy, 0, width);
+	  break;
+	}
+    }
+}
+
+/**** Private functions *******************************************************/
+
+static int private_supported (pixel_level_type level)
+{
+  switch (level)
+    {
+    case PIXEL_SCALAR:
+      return 1;
+#ifdef HAVE_SSE2
+    case PIXEL_SSE2:
+      return 1;
+#endif
+#ifdef HAVE_AVX2
+    case PIXEL_AVX2:
+      __builtin_cpu_init ();
+      return __builtin_cpu_supports ("avx2") ? 1 : 0;
+#endif
+#ifdef HAVE_NEON
+    case PIXEL_NEON:
+      return 1;
+#endif
+    default:
+      return 0;
+    }
+}
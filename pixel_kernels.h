@@ -0,0 +1,85 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef FAS_PIXEL_KERNELS_H
+#define FAS_PIXEL_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* If C++ then we need to __extern "C". Compiler defines __cplusplus */
+#ifdef __cplusplus
+#define __extern extern "C"
+#else
+#define __extern extern
+#endif
+
+
+/**********************************************************************
+ * Pixel Kernels
+ *
+ * Unscaled conversions and plane copies for the common cases, with
+ * SSE2, AVX2 and NEON versions picked at run time. Every version
+ * gives exactly the scalar result. YUV to RGB uses BT.601 limited
+ * range in 6-bit fixed point.
+ **********************************************************************/
+
+typedef enum
+{
+  PIXEL_SCALAR = 0,
+  PIXEL_SSE2   = 1,
+  PIXEL_AVX2   = 2,
+  PIXEL_NEON   = 3,
+} pixel_level_type;
+
+/* byte order of packed RGB output */
+typedef enum
+{
+  PIXEL_RGB24 = 0,
+  PIXEL_BGR24,
+  PIXEL_RGBA,
+  PIXEL_BGRA,
+  PIXEL_ARGB,
+  PIXEL_ABGR,
+} pixel_order_type;
+
+/* the best level this CPU (and build) supports, and the one in use */
+__extern pixel_level_type pixel_best_level (void);
+__extern pixel_level_type pixel_get_level (void);
+
+/* for tests: levels above pixel_best_level are refused (returns the level in use) */
+__extern pixel_level_type pixel_set_level (pixel_level_type level);
+
+/* row_bytes from each of rows rows; one memcpy when both sides are contiguous */
+__extern void pixel_copy_plane (uint8_t *dst, int dst_stride, const uint8_t *src, int src_stride, int row_bytes, int rows);
+
+/* 4:2:0 planes to packed RGB; alpha is 255 */
+__extern void pixel_yuv420p_to_packed (uint8_t *dst, int dst_stride, pixel_order_type order,
+				       const uint8_t *y, int y_stride, const uint8_t *u, int u_stride,
+				       const uint8_t *v, int v_stride, int width, int height);
+
+/* packed 4:2:2 (YUYV when uyvy is 0, UYVY otherwise) to 4:2:2 planes */
+__extern void pixel_packed422_to_planar (uint8_t *y, int y_stride, uint8_t *u, int u_stride, uint8_t *v, int v_stride,
+					 const uint8_t *src, int src_stride, int uyvy, int width, int height);
+
+#endif
+
+/**** End of File *****************************************************/
@@ -22,11 +22,9 @@
 #ifndef FAS_PRIVATE_ERROR_H
 #define FAS_PRIVATE_ERROR_H
 
-#if defined( _WIN32 ) && defined( STATIC_DLL )
-static int  SHOW_ERROR_MESSAGES;
-static int  SHOW_WARNING_MESSAGES;
-#else
-int  SHOW_ERROR_MESSAGES;
-int  SHOW_WARNING_MESSAGES;
-#endif /* _WIN32 && STATIC_DLL */
+/* set by fas_set_logging (under its lock, and only when they change); defined once, in
+   seek_indices.c, which every build of the library and its standalone tests links */
+extern int  SHOW_ERROR_MESSAGES;
+extern int  SHOW_WARNING_MESSAGES;
+
 #endif
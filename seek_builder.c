@@ -0,0 +1,661 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+
+#if defined( _WIN32 ) && defined( STATIC_DLL )
+extern "C" 
+{
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+#else
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#endif /*  _WIN32 && STATIC_DLL */
+
+#include "seek_indices.h"
+#include "private_errors.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#define FIRST_FRAME_INDEX     0
+
+/**** Private Types ***********************************************************/
+
+/* a bare demuxer + decoder pair, independent of any fas context */
+typedef struct
+{
+  AVFormatContext  *format_context;
+  AVCodecContext   *codec_context;
+  AVFrame          *frame;
+  int               stream_idx;
+} builder_stream_type;
+
+/* decodes a stream the way fas_step_forward does, collecting keyframe entries. workers of
+   the parallel builder start mid-stream: their display indices count from their first keyframe */
+typedef struct
+{
+  builder_stream_type stream;
+  fas_boolean_type    active;
+  fas_boolean_type    started;             // a thread is running on this walker (join it)
+  fas_boolean_type    failed;
+  fas_boolean_type    from_start;          // worker 0: indices are already global
+  int64_t             seek_timestamp;
+
+  int64_t             current_dts;
+  int64_t             previous_dts;
+  int64_t             keyframe_packet_dts;
+  int64_t             first_dts;
+  int                 frame_count;         // frames returned so far (= index of the next frame)
+
+  seek_table_type     entries;             // local display indices
+  int64_t             boundary_dts;        // last_packet_dts of the first keyframe (phase 1)
+  int64_t             next_boundary_dts;   // boundary of the next active worker, or AV_NOPTS_VALUE
+
+  int                 boundary_index;      // local index of the next worker's first keyframe, -1 if not reached
+  fas_boolean_type    has_check_entry;     // keyframe after the boundary, to validate the next worker with
+  seek_entry_type     check_entry;
+} builder_walker_type;
+
+/* avcodec_open and avcodec_close are not reentrant; av_find_stream_info opens codecs too.
+   the lock is ffmpeg_fas.c's, so builders and contexts opening at once exclude each other */
+extern pthread_mutex_t  gbl_open_lock;
+
+static fas_error_type   private_show_error (const char *message, fas_error_type error);
+static fas_error_type   private_open_stream (char *file_path, builder_stream_type *stream);
+static void             private_close_stream (builder_stream_type *stream);
+static fas_error_type   private_build_from_packets (char *file_path, seek_table_type *table);
+static fas_error_type   private_build_by_decoding (char *file_path, seek_table_type *table);
+static fas_error_type   private_walk (builder_walker_type *walker, fas_boolean_type *is_key, seek_entry_type *entry);
+static void            *private_find_boundary (void *walker_ptr);
+static void            *private_walk_range (void *walker_ptr);
+static fas_error_type   private_merge_walkers (builder_walker_type *walkers, int n_walkers, seek_table_type *table);
+
+
+/* fas_build_seek_table */
+
+fas_error_type fas_build_seek_table (char *file_path, fas_index_mode_type mode, seek_table_type *table)
+{
+  if (NULL == file_path || NULL == table)
+    return private_show_error ("NULL argument to fas_build_seek_table", FAS_INVALID_ARGUMENT);
+
+  switch (mode)
+    {
+    case FAS_INDEX_PACKETS:
+      return private_build_from_packets (file_path, table);
+    case FAS_INDEX_DECODE:
+      return private_build_by_decoding (file_path, table);
+    }
+
+  return private_show_error ("unknown index mode", FAS_INVALID_ARGUMENT);
+}
+
+/* fas_build_seek_table_parallel */
+
+fas_error_type fas_build_seek_table_parallel (char *file_path, int n_threads, seek_table_type *table)
+{
+  /* Phase 1: worker i > 0 seeks to the start of time range i and decodes up to its first
+     keyframe, whose last_packet_dts becomes its boundary. Workers that land on the same
+     keyframe as an earlier one are dropped.
+
+     Phase 2: every worker decodes on from its boundary until it reaches the next worker's
+     boundary keyframe, plus one more keyframe which must match the next worker's second
+     entry (otherwise the decoders disagree past the boundary and the whole table is rebuilt
+     serially). Worker 0 starts at the first packet, so its indices are global; each later
+     worker's indices are offset by the frames counted before its boundary.
+   */
+  builder_walker_type *walkers;
+  pthread_t *threads;
+  fas_error_type fas_error;
+  int i, last;
+
+  if (NULL == file_path || NULL == table)
+    return private_show_error ("NULL argument to fas_build_seek_table_parallel", FAS_INVALID_ARGUMENT);
+
+  if (n_threads <= 1)
+    return private_build_by_decoding (file_path, table);
+
+  walkers = (builder_walker_type *) calloc (n_threads, sizeof (builder_walker_type));
+  threads = (pthread_t *) calloc (n_threads, sizeof (pthread_t));
+  if (NULL == walkers || NULL == threads)
+    {
+      free (walkers);
+      free (threads);
+      return private_show_error ("unable to allocate workers", FAS_OUT_OF_MEMORY);
+    }
+
+  for (i=0;i<n_threads;i++)
+    {
+      builder_walker_type *walker = &walkers[i];
+
+      fas_error = private_open_stream (file_path, &walker->stream);
+      if (fas_error != FAS_SUCCESS)
+	break;
+
+      walker->active              = FAS_TRUE;
+      walker->from_start          = (i == 0) ? FAS_TRUE : FAS_FALSE;
+      walker->current_dts         = AV_NOPTS_VALUE;
+      walker->previous_dts        = AV_NOPTS_VALUE;
+      walker->keyframe_packet_dts = AV_NOPTS_VALUE;
+      walker->first_dts           = AV_NOPTS_VALUE;
+      walker->boundary_dts        = AV_NOPTS_VALUE;
+      walker->next_boundary_dts   = AV_NOPTS_VALUE;
+      walker->boundary_index      = -1;
+      walker->entries             = seek_init_table (-1);
+    }
+
+  /* time ranges, in the stream's time base */
+  int64_t start = AV_NOPTS_VALUE, duration = AV_NOPTS_VALUE;
+  if (fas_error == FAS_SUCCESS)
+    {
+      AVStream *av_stream = walkers[0].stream.format_context->streams[walkers[0].stream.stream_idx];
+      AVRational time_base_q;
+
+      time_base_q.num = 1;
+      time_base_q.den = AV_TIME_BASE;
+
+      start    = (av_stream->start_time != AV_NOPTS_VALUE) ? av_stream->start_time : 0;
+      duration = av_stream->duration;
+      if (duration == AV_NOPTS_VALUE && walkers[0].stream.format_context->duration != AV_NOPTS_VALUE)
+	duration = av_rescale_q (walkers[0].stream.format_context->duration, time_base_q, av_stream->time_base);
+    }
+
+  if (fas_error != FAS_SUCCESS || duration == AV_NOPTS_VALUE || duration <= 0)
+    {
+      for (i=0;i<n_threads;i++)
+	{
+	  private_close_stream (&walkers[i].stream);
+	  seek_release_table (&walkers[i].entries);
+	}
+      free (walkers);
+      free (threads);
+      private_show_error ("cannot split video into ranges, building seek table serially", FAS_FAILURE);
+      return private_build_by_decoding (file_path, table);
+    }
+
+  /* phase 1 */
+  for (i=1;i<n_threads;i++)
+    {
+      walkers[i].seek_timestamp = start + duration * i / n_threads;
+      walkers[i].started = (pthread_create (&threads[i], NULL, private_find_boundary, &walkers[i]) == 0) ? FAS_TRUE : FAS_FALSE;
+      if (!walkers[i].started)
+	walkers[i].failed = FAS_TRUE;
+    }
+  for (i=1;i<n_threads;i++)
+    if (walkers[i].started)
+      {
+	pthread_join (threads[i], NULL);
+	walkers[i].started = FAS_FALSE;
+      }
+
+  /* keep workers with distinct, increasing boundaries */
+  last = 0;
+  for (i=1;i<n_threads;i++)
+    {
+      if (walkers[i].failed || walkers[i].boundary_dts == AV_NOPTS_VALUE ||
+	  (last > 0 && walkers[i].boundary_dts <= walkers[last].boundary_dts))
+	{
+	  walkers[i].active = FAS_FALSE;
+	  walkers[i].failed = FAS_FALSE;
+	  continue;
+	}
+      walkers[last].next_boundary_dts = walkers[i].boundary_dts;
+      last = i;
+    }
+
+  /* phase 2 */
+  for (i=0;i<n_threads;i++)
+    if (walkers[i].active)
+      {
+	walkers[i].started = (pthread_create (&threads[i], NULL, private_walk_range, &walkers[i]) == 0) ? FAS_TRUE : FAS_FALSE;
+	if (!walkers[i].started)
+	  walkers[i].failed = FAS_TRUE;
+      }
+  for (i=0;i<n_threads;i++)
+    if (walkers[i].started)
+      pthread_join (threads[i], NULL);
+
+  fas_error = private_merge_walkers (walkers, n_threads, table);
+
+  for (i=0;i<n_threads;i++)
+    {
+      private_close_stream (&walkers[i].stream);
+      seek_release_table (&walkers[i].entries);
+    }
+  free (walkers);
+  free (threads);
+
+  if (fas_error != FAS_SUCCESS)
+    {
+      private_show_error ("range boundaries did not line up, building seek table serially", fas_error);
+      return private_build_by_decoding (file_path, table);
+    }
+
+  return FAS_SUCCESS;
+}
+
+/* private_find_boundary (phase 1 thread) */
+
+static void *private_find_boundary (void *walker_ptr)
+{
+  builder_walker_type *walker = (builder_walker_type *) walker_ptr;
+  fas_boolean_type is_key = FAS_FALSE;
+  seek_entry_type entry;
+
+  if (av_seek_frame (walker->stream.format_context, walker->stream.stream_idx, walker->seek_timestamp, AVSEEK_FLAG_BACKWARD) < 0)
+    {
+      walker->failed = FAS_TRUE;
+      return NULL;
+    }
+  avcodec_flush_buffers (walker->stream.codec_context);
+
+  /* frames before the first keyframe may be broken references to the previous range */
+  while (!is_key)
+    if (private_walk (walker, &is_key, &entry) != FAS_SUCCESS)
+      return NULL;   /* nothing left to index in this range */
+
+  walker->boundary_dts = entry.last_packet_dts;
+  walker->frame_count  = 1;
+  entry.display_index  = 0;
+  seek_append_table_entry (&walker->entries, entry);
+
+  return NULL;
+}
+
+/* private_walk_range (phase 2 thread) */
+
+static void *private_walk_range (void *walker_ptr)
+{
+  builder_walker_type *walker = (builder_walker_type *) walker_ptr;
+  fas_boolean_type is_key;
+  seek_entry_type entry;
+  fas_error_type fas_error;
+
+  while (FAS_TRUE)
+    {
+      fas_error = private_walk (walker, &is_key, &entry);
+      if (fas_error == FAS_NO_MORE_FRAMES)
+	break;
+      if (fas_error != FAS_SUCCESS)
+	{
+	  walker->failed = FAS_TRUE;
+	  return NULL;
+	}
+
+      if (is_key && seek_append_table_entry (&walker->entries, entry) != seek_no_error)
+	{
+	  walker->failed = FAS_TRUE;
+	  return NULL;
+	}
+
+      if (walker->next_boundary_dts == AV_NOPTS_VALUE)
+	continue;
+
+      if (walker->boundary_index < 0)
+	{
+	  if (is_key && entry.last_packet_dts == walker->next_boundary_dts)
+	    walker->boundary_index = entry.display_index;
+	  else if (walker->current_dts >= walker->next_boundary_dts)
+	    {
+	      walker->failed = FAS_TRUE;   /* passed the boundary without producing its keyframe */
+	      return NULL;
+	    }
+	}
+      else if (is_key)
+	{
+	  walker->has_check_entry = FAS_TRUE;
+	  walker->check_entry     = entry;
+	  return NULL;
+	}
+    }
+
+  if (walker->next_boundary_dts != AV_NOPTS_VALUE && walker->boundary_index < 0)
+    walker->failed = FAS_TRUE;
+
+  return NULL;
+}
+
+/* private_merge_walkers */
+
+static fas_error_type private_merge_walkers (builder_walker_type *walkers, int n_walkers, seek_table_type *table)
+{
+  int base = 0;   /* global index of the current worker's local index 0 */
+  int i, j, next;
+
+  *table = seek_init_table (-1);
+
+  for (i=0;i<n_walkers;i=next)
+    {
+      builder_walker_type *walker = &walkers[i];
+
+      for (next = i + 1; next < n_walkers && !walkers[next].active; next++)
+	;
+
+      if (walker->failed)
+	break;
+
+      /* worker i > 0: its entry 0 came from the previous worker, with the right first_packet_dts */
+      for (j = walker->from_start ? 0 : 1; j < walker->entries.num_entries; j++)
+	{
+	  seek_entry_type entry = walker->entries.array[j];
+	  if (next < n_walkers && entry.display_index > walker->boundary_index)
+	    break;
+	  entry.display_index += base;
+	  seek_append_table_entry (table, entry);
+	}
+
+      if (next == n_walkers)
+	{
+	  table->num_frames = base + walker->frame_count;
+	  table->completed  = seek_true;
+	  return FAS_SUCCESS;
+	}
+
+      /* the next worker must agree with this one past the boundary */
+      builder_walker_type *successor = &walkers[next];
+      if (successor->failed)
+	break;
+
+      if (walker->has_check_entry)
+	{
+	  if (successor->entries.num_entries < 2 ||
+	      successor->entries.array[1].display_index    != walker->check_entry.display_index - walker->boundary_index ||
+	      successor->entries.array[1].first_packet_dts != walker->check_entry.first_packet_dts ||
+	      successor->entries.array[1].last_packet_dts  != walker->check_entry.last_packet_dts)
+	    break;
+	}
+      else if (successor->entries.num_entries != 1 ||
+	       successor->frame_count != walker->frame_count - walker->boundary_index)
+	break;
+
+      base += walker->boundary_index;
+    }
+
+  seek_release_table (table);
+  return FAS_SEEK_ERROR;
+}
+
+/* private_walk */
+
+static fas_error_type private_walk (builder_walker_type *walker, fas_boolean_type *is_key, seek_entry_type *entry)
+{
+  /* the bookkeeping mirrors fas_step_forward, so entries come out identical */
+  AVPacket packet;
+  int frame_finished;
+
+  while (FAS_TRUE)
+    {
+      if (av_read_frame (walker->stream.format_context, &packet) < 0)
+	return FAS_NO_MORE_FRAMES;
+
+      if (packet.stream_index == walker->stream.stream_idx)
+	{
+	  walker->previous_dts = walker->current_dts;
+	  walker->current_dts  = packet.dts;
+
+	  if (walker->first_dts == AV_NOPTS_VALUE)
+	    walker->first_dts = packet.dts;
+
+	  if (packet.flags & PKT_FLAG_KEY)
+	    walker->keyframe_packet_dts = (walker->previous_dts == AV_NOPTS_VALUE) ? packet.dts : walker->previous_dts;
+
+	  avcodec_decode_video (walker->stream.codec_context, walker->stream.frame, &frame_finished,
+				packet.data, packet.size);
+
+	  if (frame_finished)
+	    {
+	      *is_key = walker->stream.frame->key_frame ? FAS_TRUE : FAS_FALSE;
+	      entry->display_index    = walker->frame_count;
+	      entry->first_packet_dts = walker->keyframe_packet_dts;
+	      entry->last_packet_dts  = packet.dts;
+
+	      if (walker->from_start && walker->frame_count == FIRST_FRAME_INDEX)
+		entry->first_packet_dts = walker->first_dts;
+
+	      walker->frame_count++;
+	      av_free_packet (&packet);
+	      return FAS_SUCCESS;
+	    }
+	}
+
+      av_free_packet (&packet);
+    }
+}
+
+/* private_build_by_decoding */
+
+static fas_error_type private_build_by_decoding (char *file_path, seek_table_type *table)
+{
+  fas_context_ref_type context;
+  fas_error_type fas_error = fas_open_video (&context, file_path);
+
+  if (fas_error != FAS_SUCCESS)
+    return fas_error;
+
+  while (fas_frame_available (context))
+    {
+      fas_error = fas_step_forward (context);
+      if (fas_error != FAS_SUCCESS)
+	{
+	  fas_close_video (context);
+	  return private_show_error ("decoding failed while building seek table", fas_error);
+	}
+    }
+
+  *table = seek_copy_table (fas_get_seek_table (context));
+  fas_close_video (context);
+
+  return FAS_SUCCESS;
+}
+
+/* private_build_from_packets */
+
+static fas_error_type private_build_from_packets (char *file_path, seek_table_type *table)
+{
+  /* Every video packet is one frame and keyframes come out of the decoder on their own
+     packet, as long as the codec does not reorder frames. Under that assumption the table
+     fas_step_forward would build can be read off the packets: display_index is the packet
+     count and last_packet_dts the keyframe packet's own dts. Only packets flagged as key
+     (and the very first packet) are decoded, to confirm the key_frame flag. Anything that
+     breaks the assumption makes the stream untrusted and FAS_UNSUPPORTED_CODEC is returned.
+   */
+  builder_stream_type stream;
+  fas_error_type fas_error = private_open_stream (file_path, &stream);
+
+  if (fas_error != FAS_SUCCESS)
+    return fas_error;
+
+  if (stream.codec_context->has_b_frames)
+    {
+      private_close_stream (&stream);
+      return private_show_error ("stream reorders frames, packets cannot be trusted", FAS_UNSUPPORTED_CODEC);
+    }
+
+  *table = seek_init_table (-1);
+
+  fas_boolean_type trusted     = FAS_TRUE;
+  int              frame_count = 0;
+  int64_t          previous_dts = AV_NOPTS_VALUE;
+  int64_t          first_dts    = AV_NOPTS_VALUE;
+  int64_t          keyframe_packet_dts = AV_NOPTS_VALUE;
+  AVPacket         packet;
+
+  while (trusted && av_read_frame (stream.format_context, &packet) >= 0)
+    {
+      if (packet.stream_index != stream.stream_idx)
+	{
+	  av_free_packet (&packet);
+	  continue;
+	}
+
+      if (first_dts == AV_NOPTS_VALUE)
+	first_dts = packet.dts;
+
+      if (packet.dts == AV_NOPTS_VALUE || (previous_dts != AV_NOPTS_VALUE && packet.dts <= previous_dts))
+	trusted = FAS_FALSE;
+      else if (packet.size > 0)
+	{
+	  /* same workaround as fas_step_forward: seek from the packet before the keyframe */
+	  if (packet.flags & PKT_FLAG_KEY)
+	    keyframe_packet_dts = (previous_dts == AV_NOPTS_VALUE) ? packet.dts : previous_dts;
+
+	  if ((packet.flags & PKT_FLAG_KEY) || frame_count == FIRST_FRAME_INDEX)
+	    {
+	      int frame_finished;
+
+	      avcodec_flush_buffers (stream.codec_context);
+	      avcodec_decode_video (stream.codec_context, stream.frame, &frame_finished, packet.data, packet.size);
+
+	      if (!frame_finished)
+		trusted = FAS_FALSE;
+	      else if (stream.frame->key_frame)
+		{
+		  seek_entry_type entry;
+		  entry.display_index    = frame_count;
+		  entry.first_packet_dts = (frame_count == FIRST_FRAME_INDEX) ? first_dts : keyframe_packet_dts;
+		  entry.last_packet_dts  = packet.dts;
+
+		  if (seek_append_table_entry (table, entry) != seek_no_error)
+		    trusted = FAS_FALSE;
+		}
+	    }
+
+	  frame_count++;
+	}
+
+      previous_dts = packet.dts;
+      av_free_packet (&packet);
+    }
+
+  /* containers that know their frame count get one more sanity check */
+  int64_t nb_frames = stream.format_context->streams[stream.stream_idx]->nb_frames;
+  if (nb_frames > 0 && nb_frames != frame_count)
+    trusted = FAS_FALSE;
+
+  if (table->num_entries == 0)
+    trusted = FAS_FALSE;
+
+  private_close_stream (&stream);
+
+  if (!trusted)
+    {
+      seek_release_table (table);
+      return private_show_error ("packets cannot be trusted for a seek table, decode instead", FAS_UNSUPPORTED_CODEC);
+    }
+
+  table->num_frames = frame_count;
+  table->completed  = seek_true;
+
+  return FAS_SUCCESS;
+}
+
+/* private_open_stream */
+
+static fas_error_type private_open_stream (char *file_path, builder_stream_type *stream)
+{
+  unsigned int stream_idx;
+  AVCodec *codec;
+
+  memset (stream, 0, sizeof (builder_stream_type));
+
+  if (av_open_input_file (&stream->format_context, file_path, NULL, 0, NULL) != 0)
+    return private_show_error ("failure to open file", FAS_UNSUPPORTED_FORMAT);
+
+  pthread_mutex_lock (&gbl_open_lock);
+  int found = av_find_stream_info (stream->format_context);
+  pthread_mutex_unlock (&gbl_open_lock);
+
+  if (found < 0)
+    {
+      private_close_stream (stream);
+      return private_show_error ("could not extract stream information", FAS_UNSUPPORTED_FORMAT);
+    }
+
+  for (stream_idx = 0; stream_idx < stream->format_context->nb_streams; stream_idx++)
+    if (stream->format_context->streams[stream_idx]->codec->codec_type == CODEC_TYPE_VIDEO)
+      {
+	stream->stream_idx    = stream_idx;
+	stream->codec_context = stream->format_context->streams[stream_idx]->codec;
+	break;
+      }
+
+  if (NULL == stream->codec_context)
+    {
+      private_close_stream (stream);
+      return private_show_error ("failure to find a video stream", FAS_UNSUPPORTED_FORMAT);
+    }
+
+  codec = avcodec_find_decoder (stream->codec_context->codec_id);
+
+  pthread_mutex_lock (&gbl_open_lock);
+  int opened = (NULL != codec) ? avcodec_open (stream->codec_context, codec) : -1;
+  pthread_mutex_unlock (&gbl_open_lock);
+
+  if (opened < 0)
+    {
+      stream->codec_context = NULL;
+      private_close_stream (stream);
+      return private_show_error ("failed to open codec", FAS_UNSUPPORTED_CODEC);
+    }
+
+  stream->frame = avcodec_alloc_frame ();
+  if (NULL == stream->frame)
+    {
+      private_close_stream (stream);
+      return private_show_error ("failed to allocate frame buffer", FAS_OUT_OF_MEMORY);
+    }
+
+  return FAS_SUCCESS;
+}
+
+/* private_close_stream */
+
+static void private_close_stream (builder_stream_type *stream)
+{
+  if (stream->codec_context)
+    {
+      pthread_mutex_lock (&gbl_open_lock);
+      avcodec_close (stream->codec_context);
+      pthread_mutex_unlock (&gbl_open_lock);
+    }
+
+  if (stream->format_context)
+    av_close_input_file (stream->format_context);
+
+  if (stream->frame)
+    av_free (stream->frame);
+
+  memset (stream, 0, sizeof (builder_stream_type));
+}
+
+/* private_show_error */
+
+static fas_error_type private_show_error (const char *message, fas_error_type error)
+{
+  if (SHOW_ERROR_MESSAGES)
+    fprintf (stderr, " ===> seek_builder: %s\n", message);
+  return error;
+}
@@ -0,0 +1,373 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include "seek_cache.h"
+#include "private_errors.h"
+
+/**** Defines *****************************************************************/
+
+#define    CACHE_SUFFIX            ".fst"
+#define    CACHE_TEMP_PREFIX       "tmp."
+#define    CACHE_PATH_SIZE         4096
+#define    STALE_TEMP_SECONDS      3600       /* temp files left behind by crashed writers */
+
+#define    HASH_SEED_1             14695981039346656037ULL
+#define    HASH_SEED_2             0x9e3779b97f4a7c15ULL
+
+typedef struct
+{
+  char    name[CACHE_PATH_SIZE];
+  time_t  mtime;
+  int64_t size;
+} cache_file_type;
+
+static seek_error_type private_show_error (const char *message, seek_error_type error);
+static seek_error_type private_trim (const char *cache_dir, int64_t max_bytes, const char *keep);
+
+#ifndef _WIN32
+
+/*
+ * private_hash (FNV-1a)
+ */
+
+static uint64_t private_hash (uint64_t hash, const void *data, size_t size)
+{
+  const unsigned char *bytes = (const unsigned char *) data;
+  size_t i;
+
+  for (i=0;i<size;i++)
+    {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+  return hash;
+}
+
+/*
+ * private_entry_name
+ */
+
+static seek_error_type private_entry_name (const char *cache_dir, char *video_path, const char *variant, char *name)
+{
+  /* identity = resolved path, size, mtime and the first/last SEEK_CACHE_HASH_BYTES of content */
+  struct stat video_stat;
+  char resolved[PATH_MAX];
+  unsigned char *buffer;
+  uint64_t key[2] = { HASH_SEED_1, HASH_SEED_2 };
+  int64_t size, mtime;
+  size_t n;
+  int i;
+
+  if (stat(video_path, &video_stat) < 0)
+    return private_show_error ("unable to stat video for seek cache", seek_bad_argument);
+
+  if (NULL == realpath(video_path, resolved))
+    {
+      strncpy(resolved, video_path, sizeof(resolved) - 1);
+      resolved[sizeof(resolved) - 1] = 0;
+    }
+
+  size  = (int64_t) video_stat.st_size;
+  mtime = (int64_t) video_stat.st_mtime;
+
+  for (i=0;i<2;i++)
+    {
+      key[i] = private_hash(key[i], resolved, strlen(resolved));
+      key[i] = private_hash(key[i], &size, sizeof(size));
+      key[i] = private_hash(key[i], &mtime, sizeof(mtime));
+      if (variant)
+	key[i] = private_hash(key[i], variant, strlen(variant) + 1);
+    }
+
+  buffer = (unsigned char *) malloc (SEEK_CACHE_HASH_BYTES);
+  FILE *video = fopen(video_path, "rb");
+  if (NULL == buffer || NULL == video)
+    {
+      free(buffer);
+      if (video)
+	fclose(video);
+      return private_show_error ("unable to read video for seek cache", seek_bad_argument);
+    }
+
+  n = fread(buffer, 1, SEEK_CACHE_HASH_BYTES, video);
+  key[0] = private_hash(key[0], buffer, n);
+  key[1] = private_hash(key[1], buffer, n);
+
+  if (size > SEEK_CACHE_HASH_BYTES && fseek(video, -SEEK_CACHE_HASH_BYTES, SEEK_END) == 0)
+    {
+      n = fread(buffer, 1, SEEK_CACHE_HASH_BYTES, video);
+      key[0] = private_hash(key[0], buffer, n);
+      key[1] = private_hash(key[1], buffer, n);
+    }
+
+  fclose(video);
+  free(buffer);
+
+  snprintf(name, CACHE_PATH_SIZE, "%s/%016llx%016llx%s", cache_dir,
+	   (unsigned long long) key[0], (unsigned long long) key[1], CACHE_SUFFIX);
+
+  return seek_no_error;
+}
+
+/*
+ * private_compare_age
+ */
+
+static int private_compare_age (const void *a, const void *b)
+{
+  const cache_file_type *fa = (const cache_file_type *) a;
+  const cache_file_type *fb = (const cache_file_type *) b;
+
+  if (fa->mtime < fb->mtime) return -1;
+  if (fa->mtime > fb->mtime) return 1;
+  return 0;
+}
+
+static int private_has_suffix (const char *name, const char *suffix)
+{
+  size_t n = strlen(name);
+  size_t m = strlen(suffix);
+  return n > m && !strcmp(name + n - m, suffix);
+}
+
+#endif /* _WIN32 */
+
+/*
+ * seek_cache_load
+ */
+
+seek_error_type seek_cache_load (const char *cache_dir, char *video_path, const char *variant, seek_table_type *table)
+{
+  /* a miss is not an error worth reporting: returns seek_unknown_error quietly */
+
+  if (NULL == cache_dir || NULL == video_path || NULL == table)
+    return private_show_error ("NULL argument to seek_cache_load", seek_bad_argument);
+
+#ifndef _WIN32
+  char name[CACHE_PATH_SIZE];
+  seek_error_type error = private_entry_name(cache_dir, video_path, variant, name);
+  if (error != seek_no_error)
+    return error;
+
+  if (access(name, R_OK) != 0)
+    return seek_unknown_error;
+
+  /* entries are packed on disk and unpacked for the decoder, which searches plain tables */
+  seek_packed_table_type packed;
+  if (seek_map_packed_table_file(name, &packed) != seek_no_error)
+    return seek_unknown_error;
+
+  seek_table_type loaded = seek_unpack_table(&packed);
+  seek_release_packed_table(&packed);
+  if (NULL == loaded.array)
+    return seek_unknown_error;
+
+  if (loaded.completed != seek_true)
+    {
+      seek_release_table(&loaded);
+      return seek_unknown_error;
+    }
+
+  /* entries are aged by mtime, so touch on use */
+  utime(name, NULL);
+
+  *table = loaded;
+  return seek_no_error;
+#else
+  return seek_unknown_error;
+#endif /* _WIN32 */
+}
+
+/*
+ * seek_cache_store
+ */
+
+seek_error_type seek_cache_store (const char *cache_dir, char *video_path, const char *variant, seek_table_type table, int64_t max_bytes)
+{
+  if (NULL == cache_dir || NULL == video_path)
+    return private_show_error ("NULL argument to seek_cache_store", seek_bad_argument);
+
+  if (NULL == table.array || table.num_entries <= 0 || table.completed != seek_true)
+    return private_show_error ("only completed seek tables are cached", seek_bad_argument);
+
+#ifndef _WIN32
+  char name[CACHE_PATH_SIZE];
+  char temp_name[CACHE_PATH_SIZE];
+  seek_error_type error = private_entry_name(cache_dir, video_path, variant, name);
+  if (error != seek_no_error)
+    return error;
+
+  mkdir(cache_dir, 0777);
+
+  /* write to a private temp file and publish with rename, which is atomic within a directory */
+  snprintf(temp_name, sizeof(temp_name), "%s/%sXXXXXX", cache_dir, CACHE_TEMP_PREFIX);
+  int fd = mkstemp(temp_name);
+  if (fd < 0)
+    return private_show_error ("unable to create seek cache file", seek_unknown_error);
+
+  fchmod(fd, 0644);
+  FILE *file = fdopen(fd, "wb");
+  if (NULL == file)
+    {
+      close(fd);
+      unlink(temp_name);
+      return private_show_error ("unable to create seek cache file", seek_unknown_error);
+    }
+
+  seek_packed_table_type packed;
+  error = seek_pack_table(table, &packed, 0);
+  if (error == seek_no_error)
+    {
+      error = seek_write_packed_table(file, packed);
+      seek_release_packed_table(&packed);
+    }
+  if (fclose(file) != 0 && error == seek_no_error)
+    error = seek_unknown_error;
+
+  if (error != seek_no_error || rename(temp_name, name) != 0)
+    {
+      unlink(temp_name);
+      return private_show_error ("unable to write seek cache file", seek_unknown_error);
+    }
+
+  if (max_bytes > 0)
+    return private_trim(cache_dir, max_bytes, name);
+
+  return seek_no_error;
+#else
+  return private_show_error ("seek table cache is not supported on this platform", seek_unknown_error);
+#endif /* _WIN32 */
+}
+
+/*
+ * seek_cache_trim
+ */
+
+seek_error_type seek_cache_trim (const char *cache_dir, int64_t max_bytes)
+{
+  /* evicts least recently used entries until the cache holds at most max_bytes */
+
+  if (NULL == cache_dir)
+    return private_show_error ("NULL argument to seek_cache_trim", seek_bad_argument);
+
+  return private_trim(cache_dir, max_bytes, NULL);
+}
+
+/*
+ * private_trim
+ */
+
+static seek_error_type private_trim (const char *cache_dir, int64_t max_bytes, const char *keep)
+{
+  /* keep (if not NULL) is the entry just stored: mtimes only have a resolution of
+     seconds, so it could otherwise tie with (and lose to) older entries */
+
+#ifndef _WIN32
+  DIR *dir = opendir(cache_dir);
+  if (NULL == dir)
+    return private_show_error ("unable to open seek cache directory", seek_bad_argument);
+
+  cache_file_type *files = NULL;
+  int num_files = 0;
+  int allocated = 0;
+  int64_t total = 0;
+  time_t now = time(NULL);
+  struct dirent *dir_entry;
+  struct stat file_stat;
+  char name[CACHE_PATH_SIZE];
+
+  while (NULL != (dir_entry = readdir(dir)))
+    {
+      snprintf(name, sizeof(name), "%s/%s", cache_dir, dir_entry->d_name);
+
+      if (!strncmp(dir_entry->d_name, CACHE_TEMP_PREFIX, strlen(CACHE_TEMP_PREFIX)))
+	{
+	  if (stat(name, &file_stat) == 0 && now - file_stat.st_mtime > STALE_TEMP_SECONDS)
+	    unlink(name);
+	  continue;
+	}
+
+      if (!private_has_suffix(dir_entry->d_name, CACHE_SUFFIX) || stat(name, &file_stat) != 0)
+	continue;
+
+      if (num_files == allocated)
+	{
+	  allocated = allocated ? allocated * 2 : 64;
+	  cache_file_type *grown = (cache_file_type *) realloc (files, allocated * sizeof(cache_file_type));
+	  if (NULL == grown)
+	    {
+	      free(files);
+	      closedir(dir);
+	      return private_show_error ("unable to allocate seek cache listing", seek_malloc_failed);
+	    }
+	  files = grown;
+	}
+
+      strcpy(files[num_files].name, name);
+      files[num_files].mtime = file_stat.st_mtime;
+      files[num_files].size  = (int64_t) file_stat.st_size;
+      total += files[num_files].size;
+      num_files++;
+    }
+  closedir(dir);
+
+  if (total > max_bytes)
+    {
+      int i;
+      qsort(files, num_files, sizeof(cache_file_type), private_compare_age);
+      for (i=0; i < num_files && total > max_bytes; i++)
+	if ((NULL == keep || strcmp(files[i].name, keep)) && unlink(files[i].name) == 0)
+	  total -= files[i].size;
+    }
+
+  free(files);
+  return seek_no_error;
+#else
+  return private_show_error ("seek table cache is not supported on this platform", seek_unknown_error);
+#endif /* _WIN32 */
+}
+
+/*
+ * private_show_error
+ */
+
+static seek_error_type private_show_error (const char *message, seek_error_type error)
+{
+  if (SHOW_ERROR_MESSAGES)
+    fprintf (stderr, " ===> seek_cache: %s\n", message);
+
+  return error;
+}
@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef FAS_SEEK_CACHE_H
+#define FAS_SEEK_CACHE_H
+
+#include <stdint.h>
+
+/* If C++ then we need to __extern "C". Compiler defines __cplusplus */
+#ifdef __cplusplus
+#define __extern extern "C"
+#else
+#define __extern extern
+#endif
+
+#include "seek_indices.h"
+
+
+/**********************************************************************
+ * Seek Table Cache
+ *
+ * Completed seek tables are kept as packed table files in a cache
+ * directory and unpacked to a seek_table_type on load; files in the
+ * older binary table format are treated as misses and rewritten. A video is identified by its path, size, modification
+ * time and a hash of its first and last SEEK_CACHE_HASH_BYTES bytes.
+ * Entries are published with an atomic rename, so concurrent writers
+ * (threads or processes) never expose a partial file. When max_bytes
+ * is positive, least recently used entries are evicted after a store.
+ * Tables whose dts bookkeeping depends on how the video was decoded
+ * are keyed by an extra variant string (NULL for the default decoder).
+ **********************************************************************/
+
+#define SEEK_CACHE_HASH_BYTES   (64 * 1024)
+
+__extern seek_error_type seek_cache_load  (const char *cache_dir, char *video_path, const char *variant, seek_table_type *table);
+__extern seek_error_type seek_cache_store (const char *cache_dir, char *video_path, const char *variant, seek_table_type table, int64_t max_bytes);
+__extern seek_error_type seek_cache_trim  (const char *cache_dir, int64_t max_bytes);
+
+#endif
+
+/**** End of File *****************************************************/
@@ -24,6 +24,13 @@
 #include <stdint.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include "seek_indices.h"
 #include "private_errors.h"
 
@@ -31,8 +38,46 @@
 
 #define    DEFAULT_INITIAL_SIZE    100
 
+/* binary table file: 32 byte header followed by num_entries 24 byte records, little-endian
+ *
+ *   header: magic[8] version(u32) entry_size(u32) num_frames(i32) num_entries(i32) completed(i32) checksum(u32)
+ *   record: display_index(i32) reserved(i32, zero) first_packet_dts(i64) last_packet_dts(i64)
+ *
+ * the record layout matches seek_entry_type on common little-endian ABIs, so seek_map_table_file
+ * can hand out the mapped records directly. checksum is FNV-1a over the record bytes.
+ */
+#define    BINARY_MAGIC            "FASSEEK"    /* plus terminating zero */
+#define    BINARY_VERSION          1
+#define    BINARY_HEADER_SIZE      32
+#define    BINARY_ENTRY_SIZE       24
+#define    CHECKSUM_SEED           2166136261U
+
+/* packed (compressed) table file: 40 byte header, num_blocks 24 byte restart records, then data
+ *
+ *   header: magic[8] version(u32) block_size(u32) num_frames(i32) num_entries(i32) completed(i32)
+ *           num_blocks(i32) data_size(u32) checksum(u32)
+ *   block:  display_index(i32) offset(u32) first_packet_dts(i64) last_packet_dts(i64)
+ *
+ * entries after a restart point are three varints each: display_index delta, zigzag first_packet_dts
+ * delta (from the previous entry) and zigzag last_packet_dts - first_packet_dts (of the same entry).
+ */
+#define    PACKED_MAGIC            "FASPACK"
+#define    PACKED_VERSION          1
+#define    PACKED_HEADER_SIZE      40
+#define    PACKED_BLOCK_SIZE       24
+#define    DEFAULT_BLOCK_SIZE      64
+
+/* the library's logging flags (private_errors.h) */
+int SHOW_ERROR_MESSAGES;
+int SHOW_WARNING_MESSAGES;
+
 static seek_error_type private_show_error (const char *message, seek_error_type error);
 static seek_error_type private_resize_table (seek_table_type *table, int new_size);
+static void            private_release_array (seek_table_type *table);
+static seek_table_type private_read_binary_table (FILE *file);
+static seek_error_type private_read_packed_table (FILE *file, seek_packed_table_type *packed);
+static seek_table_type private_empty_table (void);
+static int             private_find_entry (seek_table_type *table, int display_index);
 
 
 /*
@@ -79,6 +124,9 @@ seek_table_type seek_init_table (int initial_size)
   table.num_entries    = 0;
   table.num_frames     = -1;
   table.completed      = seek_false;
+  table.search         = seek_search_binary;
+  table.mapped_base    = NULL;
+  table.mapped_size    = 0;
 
   table.array = (seek_entry_type *)malloc (initial_size * sizeof(seek_entry_type));
   
@@ -103,7 +151,7 @@ void seek_release_table (seek_table_type *table)
   if (NULL == table || NULL == table->array) 
     return; 
 
-  free (table->array);
+  private_release_array (table);
   return;
 }
 
@@ -117,6 +165,9 @@ seek_table_type seek_copy_table (seek_table_type source)
   dest.num_entries = source.num_entries;
   dest.num_frames  = source.num_frames;
   dest.completed   = source.completed;
+  dest.search      = source.search;
+  dest.mapped_base = NULL;
+  dest.mapped_size = 0;
 
   if (NULL == source.array) 
     {
@@ -186,12 +237,7 @@ seek_error_type seek_get_nearest_entry (seek_table_type *table, seek_entry_type
   if (display_index < table->array[0].display_index)
     return private_show_error ("tried to seek to frame index before first frame", seek_bad_argument);
 
-  int i;
-  for (i=0; i < table->num_entries; i++)
-    if (table->array[i].display_index > display_index)
-      break;
-
-  i = i-1;
+  int i = private_find_entry (table, display_index);
 
   if (i<offset)   /* target was lower than first element (including offset) */
     return private_show_error ("target index out of table range (too small)", seek_bad_argument);
@@ -203,14 +249,47 @@ seek_error_type seek_get_nearest_entry (seek_table_type *table, seek_entry_type
 }
 
 
+/*
+ * seek_set_search_hint
+ */
+
+void seek_set_search_hint (seek_table_type *table, seek_search_type search)
+{
+  if (NULL == table)
+    return;
+
+  table->search = search;
+}
+
 /* read raw file */
 seek_table_type read_table_file(char *name)
 {
   seek_table_type ans = { NULL, (seek_boolean_type) 0, (seek_boolean_type) 0 };
   
-  FILE *table_file = fopen(name, "r");
+  FILE *table_file = fopen(name, "rb");
   if (table_file == NULL)    
     return ans;
+
+  char magic[sizeof(BINARY_MAGIC)];
+  if (fread(magic, 1, sizeof(magic), table_file) == sizeof(magic) && !memcmp(magic, BINARY_MAGIC, sizeof(magic)))
+    {
+      ans = private_read_binary_table(table_file);
+      fclose(table_file);
+      return ans;
+    }
+
+  if (!memcmp(magic, PACKED_MAGIC, sizeof(magic)))
+    {
+      seek_packed_table_type packed;
+      if (private_read_packed_table(table_file, &packed) == seek_no_error)
+	{
+	  ans = seek_unpack_table(&packed);
+	  seek_release_packed_table(&packed);
+	}
+      fclose(table_file);
+      return ans;
+    }
+  rewind(table_file);
   
   int completed_flag;
   fscanf(table_file, "%d %d %d\n", &ans.num_frames, &ans.num_entries, &completed_flag);
@@ -231,6 +310,737 @@ seek_table_type read_table_file(char *name)
   return ans;
 }
 
+/**** Binary table files ****************************************************/
+
+static void private_put_le32 (unsigned char *p, uint32_t v)
+{
+  p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static void private_put_le64 (unsigned char *p, uint64_t v)
+{
+  private_put_le32(p, (uint32_t) v);
+  private_put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint32_t private_get_le32 (const unsigned char *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t private_get_le64 (const unsigned char *p)
+{
+  return (uint64_t)private_get_le32(p) | ((uint64_t)private_get_le32(p + 4) << 32);
+}
+
+static uint32_t private_checksum (uint32_t hash, const unsigned char *data, size_t size)
+{
+  size_t i;
+  for (i=0;i<size;i++)
+    {
+      hash ^= data[i];
+      hash *= 16777619U;
+    }
+  return hash;
+}
+
+static void private_encode_entry (unsigned char *record, const seek_entry_type *entry)
+{
+  private_put_le32(record,      (uint32_t) entry->display_index);
+  private_put_le32(record + 4,  0);
+  private_put_le64(record + 8,  (uint64_t) entry->first_packet_dts);
+  private_put_le64(record + 16, (uint64_t) entry->last_packet_dts);
+}
+
+static void private_decode_entry (seek_entry_type *entry, const unsigned char *record)
+{
+  entry->display_index    = (int)     private_get_le32(record);
+  entry->first_packet_dts = (int64_t) private_get_le64(record + 8);
+  entry->last_packet_dts  = (int64_t) private_get_le64(record + 16);
+}
+
+/* true if on-disk records can be used as a seek_entry_type array without conversion */
+static int private_native_layout (void)
+{
+  const uint32_t one = 1;
+  seek_entry_type probe;
+
+  seek_block_type block;
+
+  return (*(const unsigned char *)&one == 1)                                                &&
+    (sizeof(seek_entry_type) == BINARY_ENTRY_SIZE)                                          &&
+    ((unsigned char *)&probe.first_packet_dts - (unsigned char *)&probe == 8)               &&
+    ((unsigned char *)&probe.last_packet_dts  - (unsigned char *)&probe == 16)              &&
+    (sizeof(seek_block_type) == PACKED_BLOCK_SIZE)                                          &&
+    ((unsigned char *)&block.offset           - (unsigned char *)&block == 4)               &&
+    ((unsigned char *)&block.first_packet_dts - (unsigned char *)&block == 8)               &&
+    ((unsigned char *)&block.last_packet_dts  - (unsigned char *)&block == 16);
+}
+
+/* fills the counters of table from header, returns the stored checksum in *checksum */
+static seek_error_type private_parse_header (const unsigned char *header, seek_table_type *table, uint32_t *checksum)
+{
+  if (memcmp(header, BINARY_MAGIC, sizeof(BINARY_MAGIC)))
+    return private_show_error ("not a binary seek table", seek_bad_argument);
+
+  if (private_get_le32(header + 8) != BINARY_VERSION || private_get_le32(header + 12) != BINARY_ENTRY_SIZE)
+    return private_show_error ("unsupported binary seek table version", seek_bad_argument);
+
+  table->num_frames  = (int) private_get_le32(header + 16);
+  table->num_entries = (int) private_get_le32(header + 20);
+  table->completed   = private_get_le32(header + 24) == 1 ? seek_true : seek_false;
+  *checksum          = private_get_le32(header + 28);
+
+  if (table->num_entries <= 0)
+    return private_show_error ("binary seek table has no entries", seek_bad_argument);
+
+  return seek_no_error;
+}
+
+seek_error_type seek_write_binary_table (FILE *file, seek_table_type table)
+{
+  unsigned char header[BINARY_HEADER_SIZE];
+  unsigned char record[BINARY_ENTRY_SIZE];
+  uint32_t checksum = CHECKSUM_SEED;
+  int index;
+
+  if (NULL == file || NULL == table.array || table.num_entries <= 0)
+    return private_show_error ("NULL or invalid seek table", seek_bad_argument);
+
+  for (index = 0; index < table.num_entries; index++)
+    {
+      private_encode_entry(record, &table.array[index]);
+      checksum = private_checksum(checksum, record, BINARY_ENTRY_SIZE);
+    }
+
+  memset(header, 0, sizeof(header));
+  memcpy(header, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  private_put_le32(header + 8,  BINARY_VERSION);
+  private_put_le32(header + 12, BINARY_ENTRY_SIZE);
+  private_put_le32(header + 16, (uint32_t) table.num_frames);
+  private_put_le32(header + 20, (uint32_t) table.num_entries);
+  private_put_le32(header + 24, table.completed == seek_true ? 1 : 0);
+  private_put_le32(header + 28, checksum);
+
+  if (fwrite(header, 1, BINARY_HEADER_SIZE, file) != BINARY_HEADER_SIZE)
+    return private_show_error ("failed writing binary seek table", seek_unknown_error);
+
+  for (index = 0; index < table.num_entries; index++)
+    {
+      private_encode_entry(record, &table.array[index]);
+      if (fwrite(record, 1, BINARY_ENTRY_SIZE, file) != BINARY_ENTRY_SIZE)
+	return private_show_error ("failed writing binary seek table", seek_unknown_error);
+    }
+
+  return seek_no_error;
+}
+
+/* file is positioned just past the magic */
+static seek_table_type private_read_binary_table (FILE *file)
+{
+  seek_table_type table = private_empty_table();
+  unsigned char header[BINARY_HEADER_SIZE];
+  unsigned char record[BINARY_ENTRY_SIZE];
+  uint32_t checksum = CHECKSUM_SEED;
+  uint32_t expected;
+  int i;
+
+  memcpy(header, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  if (fread(header + sizeof(BINARY_MAGIC), 1, BINARY_HEADER_SIZE - sizeof(BINARY_MAGIC), file) != BINARY_HEADER_SIZE - sizeof(BINARY_MAGIC) ||
+      private_parse_header(header, &table, &expected) != seek_no_error)
+    return private_empty_table();
+
+  table.array = (seek_entry_type *) malloc (table.num_entries * sizeof(seek_entry_type));
+  if (NULL == table.array)
+    {
+      private_show_error ("unable to allocate binary seek table", seek_malloc_failed);
+      return private_empty_table();
+    }
+  table.allocated_size = table.num_entries;
+
+  for (i=0;i<table.num_entries;i++)
+    {
+      if (fread(record, 1, BINARY_ENTRY_SIZE, file) != BINARY_ENTRY_SIZE)
+	break;
+      checksum = private_checksum(checksum, record, BINARY_ENTRY_SIZE);
+      private_decode_entry(&table.array[i], record);
+    }
+
+  if (i != table.num_entries || checksum != expected)
+    {
+      private_show_error ("truncated or corrupt binary seek table", seek_bad_argument);
+      free(table.array);
+      return private_empty_table();
+    }
+
+  return table;
+}
+
+#ifndef _WIN32
+/* maps name read-only if it starts with magic. returns 0 on success */
+static int private_map_file (char *name, const char *magic, unsigned char **base, size_t *size)
+{
+  struct stat file_stat;
+  int fd;
+
+  fd = open(name, O_RDONLY);
+  if (fd < 0)
+    return -1;
+
+  if (fstat(fd, &file_stat) < 0 || file_stat.st_size < PACKED_HEADER_SIZE)
+    {
+      close(fd);
+      return -1;
+    }
+
+  *size = (size_t) file_stat.st_size;
+  *base = (unsigned char *) mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (*base == (unsigned char *) MAP_FAILED)
+    return -1;
+
+  if (memcmp(*base, magic, sizeof(BINARY_MAGIC)))
+    {
+      munmap(*base, *size);
+      return -1;
+    }
+
+  return 0;
+}
+#endif /* _WIN32 */
+
+/* seek_map_table_file */
+
+seek_table_type seek_map_table_file (char *name)
+{
+  /* binary tables are mapped read-only and the records are used in place. tables in the
+     text format, or on platforms where the record layout differs, are read as usual.
+   */
+#ifndef _WIN32
+  seek_table_type table;
+  unsigned char  *base;
+  size_t          size;
+  uint32_t        expected;
+
+  if (!private_native_layout() || private_map_file(name, BINARY_MAGIC, &base, &size) != 0)
+    return read_table_file(name);
+
+  table = private_empty_table();
+
+  if (private_parse_header(base, &table, &expected) != seek_no_error ||
+      (uint64_t) size != BINARY_HEADER_SIZE + (uint64_t) table.num_entries * BINARY_ENTRY_SIZE ||
+      private_checksum(CHECKSUM_SEED, base + BINARY_HEADER_SIZE, (size_t) table.num_entries * BINARY_ENTRY_SIZE) != expected)
+    {
+      private_show_error ("truncated or corrupt binary seek table", seek_bad_argument);
+      munmap(base, size);
+      return private_empty_table();
+    }
+
+  table.array          = (seek_entry_type *)(base + BINARY_HEADER_SIZE);
+  table.allocated_size = table.num_entries;
+  table.mapped_base    = base;
+  table.mapped_size    = size;
+
+  return table;
+#else
+  return read_table_file(name);
+#endif /* _WIN32 */
+}
+
+
+/**** Packed tables ***********************************************************/
+
+static size_t private_put_varint (unsigned char *p, uint64_t v)
+{
+  size_t n = 0;
+  while (v >= 0x80)
+    {
+      if (p) p[n] = (unsigned char)(v | 0x80);
+      v >>= 7;
+      n++;
+    }
+  if (p) p[n] = (unsigned char) v;
+  return n + 1;
+}
+
+/* NULL if the varint runs past end (or past 64 bits) */
+static const unsigned char *private_get_varint (const unsigned char *p, const unsigned char *end, uint64_t *v)
+{
+  uint64_t value = 0;
+  int shift = 0;
+  while (p < end && (*p & 0x80))
+    {
+      if (shift > 56)
+	return NULL;
+      value |= (uint64_t)(*p++ & 0x7f) << shift;
+      shift += 7;
+    }
+  if (p >= end)
+    return NULL;
+  *v = value | ((uint64_t)*p++ << shift);
+  return p;
+}
+
+static uint64_t private_zigzag (int64_t v)
+{
+  return ((uint64_t) v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t private_unzigzag (uint64_t v)
+{
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/* encodes entry relative to prev. with data == NULL only returns the size */
+static size_t private_pack_entry (unsigned char *data, const seek_entry_type *prev, const seek_entry_type *entry)
+{
+  size_t n = 0;
+  n += private_put_varint(data ? data + n : NULL, (uint64_t)(entry->display_index - prev->display_index));
+  n += private_put_varint(data ? data + n : NULL, private_zigzag(entry->first_packet_dts - prev->first_packet_dts));
+  n += private_put_varint(data ? data + n : NULL, private_zigzag(entry->last_packet_dts - entry->first_packet_dts));
+  return n;
+}
+
+/* NULL if the entry runs past end, the end of its block */
+static const unsigned char *private_unpack_entry (const unsigned char *data, const unsigned char *end,
+						  const seek_entry_type *prev, seek_entry_type *entry)
+{
+  uint64_t v;
+  if (NULL == (data = private_get_varint(data, end, &v)))
+    return NULL;
+  entry->display_index = prev->display_index + (int) v;
+  if (NULL == (data = private_get_varint(data, end, &v)))
+    return NULL;
+  entry->first_packet_dts = prev->first_packet_dts + private_unzigzag(v);
+  if (NULL == (data = private_get_varint(data, end, &v)))
+    return NULL;
+  entry->last_packet_dts = entry->first_packet_dts + private_unzigzag(v);
+  return data;
+}
+
+/* where the deltas of block end */
+static const unsigned char *private_block_end (seek_packed_table_type *packed, int block)
+{
+  return packed->data + (block + 1 < packed->num_blocks ? packed->blocks[block + 1].offset : packed->data_size);
+}
+
+static void private_restart_entry (const seek_block_type *block, seek_entry_type *entry)
+{
+  entry->display_index    = block->display_index;
+  entry->first_packet_dts = block->first_packet_dts;
+  entry->last_packet_dts  = block->last_packet_dts;
+}
+
+/* decodes entry number index */
+static seek_error_type private_packed_get_entry (seek_packed_table_type *packed, int index, seek_entry_type *entry)
+{
+  int block = index / packed->block_size;
+  const unsigned char *data = packed->data + packed->blocks[block].offset;
+  const unsigned char *end  = private_block_end(packed, block);
+  int k;
+
+  private_restart_entry(&packed->blocks[block], entry);
+  for (k = block * packed->block_size; k < index; k++)
+    {
+      seek_entry_type prev = *entry;
+      if (NULL == (data = private_unpack_entry(data, end, &prev, entry)))
+	return private_show_error ("corrupt packed seek table block", seek_bad_argument);
+    }
+
+  return seek_no_error;
+}
+
+/* offsets must stay inside data and never go back, so each block's deltas lie between its own
+   offset and the next block's */
+static seek_error_type private_check_packed_blocks (seek_packed_table_type *packed)
+{
+  int b;
+
+  for (b=0;b<packed->num_blocks;b++)
+    if (packed->blocks[b].offset > packed->data_size || (b > 0 && packed->blocks[b].offset < packed->blocks[b - 1].offset))
+      return private_show_error ("packed seek table block outside its data", seek_bad_argument);
+
+  return seek_no_error;
+}
+
+/*
+ * seek_pack_table
+ */
+
+seek_error_type seek_pack_table (seek_table_type table, seek_packed_table_type *packed, int block_size)
+{
+  size_t data_size = 0;
+  int i;
+
+  if (NULL == packed)
+    return private_show_error ("NULL packed table", seek_bad_argument);
+
+  memset(packed, 0, sizeof(seek_packed_table_type));
+
+  if (NULL == table.array || table.num_entries <= 0)
+    return private_show_error ("NULL or invalid seek table", seek_bad_argument);
+
+  if (block_size <= 0)
+    block_size = DEFAULT_BLOCK_SIZE;
+
+  for (i=0;i<table.num_entries;i++)
+    if (i % block_size)
+      data_size += private_pack_entry(NULL, &table.array[i - 1], &table.array[i]);
+
+  if (data_size > 0xffffffffU)
+    return private_show_error ("seek table too large to pack", seek_bad_argument);
+
+  packed->num_blocks  = (table.num_entries + block_size - 1) / block_size;
+  packed->block_size  = block_size;
+  packed->num_entries = table.num_entries;
+  packed->num_frames  = table.num_frames;
+  packed->completed   = table.completed;
+  packed->data_size   = (uint32_t) data_size;
+
+  packed->blocks = (seek_block_type *) malloc (packed->num_blocks * sizeof(seek_block_type));
+  packed->data   = (unsigned char *) malloc (data_size + 1);
+  if (NULL == packed->blocks || NULL == packed->data)
+    {
+      seek_release_packed_table(packed);
+      return private_show_error ("unable to allocate packed table", seek_malloc_failed);
+    }
+
+  data_size = 0;
+  for (i=0;i<table.num_entries;i++)
+    {
+      if (i % block_size)
+	{
+	  data_size += private_pack_entry(packed->data + data_size, &table.array[i - 1], &table.array[i]);
+	  continue;
+	}
+
+      seek_block_type *block = &packed->blocks[i / block_size];
+      block->display_index    = table.array[i].display_index;
+      block->offset           = (uint32_t) data_size;
+      block->first_packet_dts = table.array[i].first_packet_dts;
+      block->last_packet_dts  = table.array[i].last_packet_dts;
+    }
+
+  return seek_no_error;
+}
+
+/*
+ * seek_unpack_table
+ */
+
+seek_table_type seek_unpack_table (seek_packed_table_type *packed)
+{
+  seek_table_type table;
+  int b, i;
+
+  if (NULL == packed || NULL == packed->blocks || packed->num_entries <= 0)
+    {
+      private_show_error ("NULL or invalid packed table", seek_bad_argument);
+      return private_empty_table();
+    }
+
+  table = seek_init_table(packed->num_entries);
+  if (NULL == table.array)
+    return table;
+
+  for (b=0;b<packed->num_blocks;b++)
+    {
+      const unsigned char *data = packed->data + packed->blocks[b].offset;
+      const unsigned char *data_end = private_block_end(packed, b);
+      int end = (b + 1) * packed->block_size;
+      if (end > packed->num_entries)
+	end = packed->num_entries;
+
+      i = b * packed->block_size;
+      private_restart_entry(&packed->blocks[b], &table.array[i]);
+      for (i++; i < end; i++)
+	if (NULL == (data = private_unpack_entry(data, data_end, &table.array[i - 1], &table.array[i])))
+	  {
+	    private_show_error ("corrupt packed seek table block", seek_bad_argument);
+	    seek_release_table(&table);
+	    return private_empty_table();
+	  }
+    }
+
+  table.num_entries = packed->num_entries;
+  table.num_frames  = packed->num_frames;
+  table.completed   = packed->completed;
+
+  return table;
+}
+
+/*
+ * seek_release_packed_table
+ */
+
+void seek_release_packed_table (seek_packed_table_type *packed)
+{
+  if (NULL == packed)
+    return;
+
+#ifndef _WIN32
+  if (NULL != packed->mapped_base)
+    munmap (packed->mapped_base, packed->mapped_size);
+  else
+#endif
+    {
+      free (packed->blocks);
+      free (packed->data);
+    }
+
+  memset(packed, 0, sizeof(seek_packed_table_type));
+  packed->num_frames = -1;
+}
+
+/*
+ * seek_packed_get_nearest_entry
+ */
+
+seek_error_type seek_packed_get_nearest_entry (seek_packed_table_type *packed, seek_entry_type *entry, int display_index, int offset)
+{
+  /* same contract as seek_get_nearest_entry. bisects the restart points, then decodes a single block */
+
+  if (NULL == packed || NULL == packed->blocks || packed->num_entries <= 0)
+    return private_show_error ("NULL or invalid packed table", seek_bad_argument);
+
+  if (NULL == entry)
+    return private_show_error ("NULL entry buffer (for return)", seek_bad_argument);
+
+  if (display_index < packed->blocks[0].display_index)
+    return private_show_error ("tried to seek to frame index before first frame", seek_bad_argument);
+
+  int lo = 0;
+  int hi = packed->num_blocks;
+  while (hi - lo > 1)
+    {
+      int mid = lo + (hi - lo) / 2;
+      if (packed->blocks[mid].display_index <= display_index)
+	lo = mid;
+      else
+	hi = mid;
+    }
+
+  int i   = lo * packed->block_size;
+  int end = i + packed->block_size;
+  if (end > packed->num_entries)
+    end = packed->num_entries;
+
+  const unsigned char *data = packed->data + packed->blocks[lo].offset;
+  const unsigned char *data_end = private_block_end(packed, lo);
+  seek_entry_type next;
+
+  private_restart_entry(&packed->blocks[lo], entry);
+  for (; i + 1 < end; i++)
+    {
+      if (NULL == (data = private_unpack_entry(data, data_end, entry, &next)))
+	return private_show_error ("corrupt packed seek table block", seek_bad_argument);
+      if (next.display_index > display_index)
+	break;
+      *entry = next;
+    }
+
+  if (i<offset)   /* target was lower than first element (including offset) */
+    return private_show_error ("target index out of table range (too small)", seek_bad_argument);
+
+  if (offset > 0)
+    {
+      if (private_packed_get_entry(packed, i - offset, &next) != seek_no_error)
+	return seek_bad_argument;
+      entry->first_packet_dts = next.first_packet_dts;
+    }
+
+  return seek_no_error;
+}
+
+static void private_encode_block (unsigned char *record, const seek_block_type *block)
+{
+  private_put_le32(record,      (uint32_t) block->display_index);
+  private_put_le32(record + 4,  block->offset);
+  private_put_le64(record + 8,  (uint64_t) block->first_packet_dts);
+  private_put_le64(record + 16, (uint64_t) block->last_packet_dts);
+}
+
+static void private_decode_block (seek_block_type *block, const unsigned char *record)
+{
+  block->display_index    = (int)     private_get_le32(record);
+  block->offset           =           private_get_le32(record + 4);
+  block->first_packet_dts = (int64_t) private_get_le64(record + 8);
+  block->last_packet_dts  = (int64_t) private_get_le64(record + 16);
+}
+
+/* fills the counters of packed from header, returns the stored checksum in *checksum */
+static seek_error_type private_parse_packed_header (const unsigned char *header, seek_packed_table_type *packed, uint32_t *checksum)
+{
+  memset(packed, 0, sizeof(seek_packed_table_type));
+
+  if (memcmp(header, PACKED_MAGIC, sizeof(PACKED_MAGIC)) || private_get_le32(header + 8) != PACKED_VERSION)
+    return private_show_error ("unsupported packed seek table", seek_bad_argument);
+
+  packed->block_size  = (int) private_get_le32(header + 12);
+  packed->num_frames  = (int) private_get_le32(header + 16);
+  packed->num_entries = (int) private_get_le32(header + 20);
+  packed->completed   = private_get_le32(header + 24) == 1 ? seek_true : seek_false;
+  packed->num_blocks  = (int) private_get_le32(header + 28);
+  packed->data_size   = private_get_le32(header + 32);
+  *checksum           = private_get_le32(header + 36);
+
+  if (packed->num_entries <= 0 || packed->block_size <= 0 ||
+      packed->num_blocks != (packed->num_entries + packed->block_size - 1) / packed->block_size)
+    return private_show_error ("invalid packed seek table header", seek_bad_argument);
+
+  return seek_no_error;
+}
+
+/*
+ * seek_write_packed_table
+ */
+
+seek_error_type seek_write_packed_table (FILE *file, seek_packed_table_type packed)
+{
+  unsigned char header[PACKED_HEADER_SIZE];
+  unsigned char record[PACKED_BLOCK_SIZE];
+  uint32_t checksum = CHECKSUM_SEED;
+  int b;
+
+  if (NULL == file || NULL == packed.blocks || packed.num_entries <= 0)
+    return private_show_error ("NULL or invalid packed table", seek_bad_argument);
+
+  for (b=0;b<packed.num_blocks;b++)
+    {
+      private_encode_block(record, &packed.blocks[b]);
+      checksum = private_checksum(checksum, record, PACKED_BLOCK_SIZE);
+    }
+  checksum = private_checksum(checksum, packed.data, packed.data_size);
+
+  memset(header, 0, sizeof(header));
+  memcpy(header, PACKED_MAGIC, sizeof(PACKED_MAGIC));
+  private_put_le32(header + 8,  PACKED_VERSION);
+  private_put_le32(header + 12, (uint32_t) packed.block_size);
+  private_put_le32(header + 16, (uint32_t) packed.num_frames);
+  private_put_le32(header + 20, (uint32_t) packed.num_entries);
+  private_put_le32(header + 24, packed.completed == seek_true ? 1 : 0);
+  private_put_le32(header + 28, (uint32_t) packed.num_blocks);
+  private_put_le32(header + 32, packed.data_size);
+  private_put_le32(header + 36, checksum);
+
+  if (fwrite(header, 1, PACKED_HEADER_SIZE, file) != PACKED_HEADER_SIZE)
+    return private_show_error ("failed writing packed seek table", seek_unknown_error);
+
+  for (b=0;b<packed.num_blocks;b++)
+    {
+      private_encode_block(record, &packed.blocks[b]);
+      if (fwrite(record, 1, PACKED_BLOCK_SIZE, file) != PACKED_BLOCK_SIZE)
+	return private_show_error ("failed writing packed seek table", seek_unknown_error);
+    }
+
+  if (fwrite(packed.data, 1, packed.data_size, file) != packed.data_size)
+    return private_show_error ("failed writing packed seek table", seek_unknown_error);
+
+  return seek_no_error;
+}
+
+/* file is positioned just past the magic */
+static seek_error_type private_read_packed_table (FILE *file, seek_packed_table_type *packed)
+{
+  unsigned char header[PACKED_HEADER_SIZE];
+  unsigned char record[PACKED_BLOCK_SIZE];
+  uint32_t checksum = CHECKSUM_SEED;
+  uint32_t expected;
+  int b;
+
+  memcpy(header, PACKED_MAGIC, sizeof(PACKED_MAGIC));
+  if (fread(header + sizeof(PACKED_MAGIC), 1, PACKED_HEADER_SIZE - sizeof(PACKED_MAGIC), file) != PACKED_HEADER_SIZE - sizeof(PACKED_MAGIC))
+    return private_show_error ("truncated packed seek table", seek_bad_argument);
+
+  if (private_parse_packed_header(header, packed, &expected) != seek_no_error)
+    return seek_bad_argument;
+
+  packed->blocks = (seek_block_type *) malloc (packed->num_blocks * sizeof(seek_block_type));
+  packed->data   = (unsigned char *) malloc (packed->data_size + 1);
+  if (NULL == packed->blocks || NULL == packed->data)
+    {
+      seek_release_packed_table(packed);
+      return private_show_error ("unable to allocate packed table", seek_malloc_failed);
+    }
+
+  for (b=0;b<packed->num_blocks;b++)
+    {
+      if (fread(record, 1, PACKED_BLOCK_SIZE, file) != PACKED_BLOCK_SIZE)
+	break;
+      checksum = private_checksum(checksum, record, PACKED_BLOCK_SIZE);
+      private_decode_block(&packed->blocks[b], record);
+    }
+
+  if (b != packed->num_blocks || fread(packed->data, 1, packed->data_size, file) != packed->data_size ||
+      private_checksum(checksum, packed->data, packed->data_size) != expected ||
+      private_check_packed_blocks(packed) != seek_no_error)
+    {
+      seek_release_packed_table(packed);
+      return private_show_error ("truncated or corrupt packed seek table", seek_bad_argument);
+    }
+
+  return seek_no_error;
+}
+
+/*
+ * seek_map_packed_table_file
+ */
+
+seek_error_type seek_map_packed_table_file (char *name, seek_packed_table_type *packed)
+{
+  /* like seek_map_table_file: restart points and deltas are used straight from the mapping */
+
+  if (NULL == packed)
+    return private_show_error ("NULL packed table", seek_bad_argument);
+
+#ifndef _WIN32
+  unsigned char *base;
+  size_t         size;
+  uint32_t       expected;
+
+  if (private_native_layout() && private_map_file(name, PACKED_MAGIC, &base, &size) == 0)
+    {
+      if (private_parse_packed_header(base, packed, &expected) != seek_no_error ||
+	  (uint64_t) size != PACKED_HEADER_SIZE + (uint64_t) packed->num_blocks * PACKED_BLOCK_SIZE + packed->data_size ||
+	  private_checksum(CHECKSUM_SEED, base + PACKED_HEADER_SIZE, size - PACKED_HEADER_SIZE) != expected)
+	{
+	  munmap(base, size);
+	  seek_release_packed_table(packed);
+	  return private_show_error ("truncated or corrupt packed seek table", seek_bad_argument);
+	}
+
+      packed->blocks      = (seek_block_type *)(base + PACKED_HEADER_SIZE);
+      packed->data        = base + PACKED_HEADER_SIZE + packed->num_blocks * PACKED_BLOCK_SIZE;
+      packed->mapped_base = base;
+      packed->mapped_size = size;
+
+      /* the checksum only catches accidents; a crafted file must not send lookups outside the mapping */
+      if (private_check_packed_blocks(packed) != seek_no_error)
+	{
+	  seek_release_packed_table(packed);
+	  return seek_bad_argument;
+	}
+      return seek_no_error;
+    }
+#endif /* _WIN32 */
+
+  FILE *file = fopen(name, "rb");
+  char magic[sizeof(PACKED_MAGIC)];
+  seek_error_type error = seek_bad_argument;
+
+  memset(packed, 0, sizeof(seek_packed_table_type));
+  if (file == NULL)
+    return private_show_error ("unable to open packed seek table", seek_bad_argument);
+
+  if (fread(magic, 1, sizeof(magic), file) == sizeof(magic) && !memcmp(magic, PACKED_MAGIC, sizeof(magic)))
+    error = private_read_packed_table(file, packed);
+  else
+    private_show_error ("not a packed seek table", seek_bad_argument);
+
+  fclose(file);
+  return error;
+}
+
 seek_error_type seek_show_raw_table (FILE* file, seek_table_type table)
 {
   seek_entry_type *entry;
@@ -292,6 +1102,66 @@ static seek_error_type private_show_error (const char *message, seek_error_type
   return error;
 }
 
+/*
+ * private_find_entry
+ */
+
+static int private_find_entry (seek_table_type *table, int display_index)
+{
+  /* returns the last entry at or before display_index. entries are kept sorted by
+     seek_append_table_entry and the caller has checked array[0] <= display_index.
+   */
+
+  seek_entry_type *array = table->array;
+  int lo = 0;
+  int hi = table->num_entries;   /* array[lo] <= display_index < array[hi] (hi is exclusive) */
+
+  if (array[hi - 1].display_index <= display_index)
+    return hi - 1;
+
+  if (table->search == seek_search_interpolate && hi > 2)
+    {
+      /* evenly spaced gops: guess the slot, then gallop out from the guess to bracket it */
+      int64_t span  = array[hi - 1].display_index - array[0].display_index;
+      int     guess = (int)((int64_t)(display_index - array[0].display_index) * (hi - 1) / span);
+      int     step  = 1;
+
+      if (array[guess].display_index <= display_index)
+	{
+	  lo = guess;
+	  while (lo + step < hi && array[lo + step].display_index <= display_index)
+	    {
+	      lo += step;
+	      step <<= 1;
+	    }
+	  if (lo + step < hi)
+	    hi = lo + step;
+	}
+      else
+	{
+	  hi = guess;
+	  while (hi - step > lo && array[hi - step].display_index > display_index)
+	    {
+	      hi -= step;
+	      step <<= 1;
+	    }
+	  if (hi - step > lo)
+	    lo = hi - step;
+	}
+    }
+
+  while (hi - lo > 1)
+    {
+      int mid = lo + (hi - lo) / 2;
+      if (array[mid].display_index <= display_index)
+	lo = mid;
+      else
+	hi = mid;
+    }
+
+  return lo;
+}
+
 /*
  * private_resize_table
  */
@@ -310,10 +1180,44 @@ static seek_error_type private_resize_table (seek_table_type *table, int new_siz
   }
 
   memcpy (new_array, table->array, table->allocated_size * sizeof (seek_entry_type));
-  free (table->array);
+  private_release_array (table);
 
   table->allocated_size = new_size;
   table->array          = new_array;
     
   return seek_no_error;
 }
+
+/*
+ * private_empty_table
+ */
+
+static seek_table_type private_empty_table (void)
+{
+  seek_table_type table;
+
+  memset (&table, 0, sizeof (table));
+  table.num_frames = -1;
+  table.completed  = seek_false;
+  table.search     = seek_search_binary;
+
+  return table;
+}
+
+/*
+ * private_release_array
+ */
+
+static void private_release_array (seek_table_type *table)
+{
+  /* mapped tables are copied to the heap on their first resize */
+#ifndef _WIN32
+  if (NULL != table->mapped_base)
+    munmap (table->mapped_base, table->mapped_size);
+  else
+#endif
+    free (table->array);
+
+  table->mapped_base = NULL;
+  table->mapped_size = 0;
+}
@@ -51,6 +51,12 @@ typedef enum
   seek_true  = 1
 } seek_boolean_type;
 
+typedef enum
+{
+  seek_search_binary      = 0,  /* bisect the table (default) */
+  seek_search_interpolate = 1,  /* guess from evenly spaced gops, then bisect around the guess */
+} seek_search_type;
+
 typedef struct
 {
   int     display_index;
@@ -65,10 +71,39 @@ typedef struct
   int num_frames;               // total number of frames
   int num_entries;              // ie, number of seek-points (keyframes)
   int allocated_size;
+  seek_search_type search;      // lookup strategy used by seek_get_nearest_entry
+  void  *mapped_base;           // non-NULL when array points into a mapped binary table file
+  size_t mapped_size;
 } seek_table_type;
 
 
 
+/* compressed tables: entries are grouped in blocks of block_size. the first entry of every
+   block is stored in full as a restart point; the rest are varint deltas in data. */
+
+typedef struct
+{
+  int      display_index;       // restart entry of the block
+  uint32_t offset;              // where the block's remaining entries start in data
+  int64_t  first_packet_dts;
+  int64_t  last_packet_dts;
+} seek_block_type;
+
+typedef struct
+{
+  seek_block_type   *blocks;
+  unsigned char     *data;
+  int                num_blocks;
+  int                block_size;
+  uint32_t           data_size;
+  seek_boolean_type  completed;
+  int                num_frames;
+  int                num_entries;
+  void              *mapped_base;   // non-NULL when blocks and data point into a mapped file
+  size_t             mapped_size;
+} seek_packed_table_type;
+
+
 /**********************************************************************
  * Seek Table Functions
  **********************************************************************/
@@ -83,11 +118,23 @@ __extern int             compare_seek_tables(seek_table_type t1, seek_table_type
 __extern seek_error_type seek_append_table_entry (seek_table_type *table, seek_entry_type entry);
 
 __extern seek_error_type seek_get_nearest_entry (seek_table_type *table, seek_entry_type *entry, int display_index, int offset);
+__extern void            seek_set_search_hint   (seek_table_type *table, seek_search_type search);
 
 __extern seek_error_type seek_show_table (seek_table_type table);          /* human readable */
 __extern seek_error_type seek_show_raw_table (FILE *file, seek_table_type table);
 
-__extern seek_table_type read_table_file(char *name);                      /* read raw file */
+__extern seek_table_type read_table_file(char *name);                      /* read raw file (text or binary) */
+
+__extern seek_error_type seek_write_binary_table (FILE *file, seek_table_type table);
+__extern seek_table_type seek_map_table_file (char *name);                 /* binary file, entries are used in place */
+
+__extern seek_error_type seek_pack_table            (seek_table_type table, seek_packed_table_type *packed, int block_size);
+__extern seek_table_type seek_unpack_table          (seek_packed_table_type *packed);
+__extern void            seek_release_packed_table  (seek_packed_table_type *packed);
+__extern seek_error_type seek_packed_get_nearest_entry (seek_packed_table_type *packed, seek_entry_type *entry, int display_index, int offset);
+
+__extern seek_error_type seek_write_packed_table    (FILE *file, seek_packed_table_type packed);
+__extern seek_error_type seek_map_packed_table_file (char *name, seek_packed_table_type *packed);
 
 #endif 
 
@@ -4,4 +4,28 @@ gcc dump_keyframes.c -I.. $LINK -o dump_keyframes
 gcc show_seek_table.c -I.. $LINK -o show_seek_table
 gcc seek_test.c -I.. $LINK -o seek_test
 gcc external_seek_test.c -I.. $LINK -o external_seek_test
-gcc generate_seek_table.c -I.. -I../ffmpeg/ ../ffmpeg/libavformat/libavformat.a ../ffmpeg/libavutil/libavutil.a ../ffmpeg/libavcodec/libavcodec.a -lm -lz ../lib/libffmpeg_fas.so -o generate_seek_table
\ No newline at end of file
+gcc generate_seek_table.c -I.. -I../ffmpeg/ ../ffmpeg/libavformat/libavformat.a ../ffmpeg/libavutil/libavutil.a ../ffmpeg/libavcodec/libavcodec.a -lm -lz ../lib/libffmpeg_fas.so -o generate_seek_table
+gcc seek_lookup_bench.c ../seek_indices.c -I.. -O2 -o seek_lookup_bench
+gcc seek_table_file_test.c ../seek_indices.c -I.. -o seek_table_file_test
+gcc seek_cache_test.c ../seek_cache.c ../seek_indices.c -I.. -o seek_cache_test
+gcc pixel_kernels_test.c ../pixel_kernels.c -I.. -O2 -o pixel_kernels_test
+gcc packet_index_test.c -I.. $LINK -o packet_index_test
+gcc parallel_seek_table_test.c -I.. $LINK -lpthread -o parallel_seek_table_test
+gcc threaded_seek_test.c -I.. $LINK -o threaded_seek_test
+gcc read_ahead_test.c -I.. $LINK -lpthread -o read_ahead_test
+gcc frame_cache_test.c -I.. $LINK -lpthread -o frame_cache_test
+gcc step_backward_test.c -I.. $LINK -lpthread -o step_backward_test
+gcc frame_view_test.c -I.. $LINK -o frame_view_test
+gcc frame_pool_test.c -I.. $LINK -o frame_pool_test
+gcc output_format_test.c -I.. $LINK -lpthread -o output_format_test
+gcc output_geometry_test.c -I.. $LINK -lpthread -o output_geometry_test
+gcc lowres_test.c -I.. $LINK -o lowres_test
+gcc keyframe_step_test.c -I.. $LINK -o keyframe_step_test
+gcc seek_skip_test.c -I.. $LINK -o seek_skip_test
+gcc seek_cost_test.c -I.. $LINK -o seek_cost_test
+gcc get_frames_test.c -I.. $LINK -o get_frames_test
+gcc sampling_test.c -I.. $LINK -o sampling_test
+gcc thread_stress_test.c -I.. $LINK -lpthread -o thread_stress_test
+gcc decode_pool_test.c -I.. $LINK -lpthread -o decode_pool_test
+gcc parallel_decode_test.c -I.. $LINK -o parallel_decode_test
+gcc custom_io_test.c -I.. $LINK -o custom_io_test
@@ -0,0 +1,198 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ *
+ * This file is part of the Frame Accurate Seeking extension library to
+ * ffmpeg (ffmpeg-fas).
+ *
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "test_support.h"
+#include "frame_checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_FRAMES       300
+#define N_SEEKS        30
+#define BUFFER_SIZE    4096           /* smaller than the default, so reads cross buffers often */
+
+/* Opens a video from memory, through seekable FILE callbacks and through read-only callbacks,
+   and checks the frames (in order, and after random seeks where the input can seek) against
+   the same video opened from its file. */
+
+int file_read(void *opaque, unsigned char *buffer, int size)
+{
+  return (int) fread(buffer, 1, size, (FILE *) opaque);
+}
+
+long long file_seek(void *opaque, long long offset, int whence)
+{
+  if (fseek((FILE *) opaque, (long) offset, whence))
+    return -1;
+  return ftell((FILE *) opaque);
+}
+
+long long file_size(void *opaque)
+{
+  FILE *file = (FILE *) opaque;
+  long position = ftell(file);
+  long size;
+
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  fseek(file, position, SEEK_SET);
+  return size;
+}
+
+void check_video(fas_context_ref_type context, unsigned long *checksums, int n_frames,
+		 fas_boolean_type seekable, char *what)
+{
+  fas_raw_image_type image;
+  int i;
+
+  for (i=0;i<n_frames;i++)
+    {
+      if (!fas_frame_available(context) || fas_get_frame_index(context) != i)
+	{
+	  fprintf(stderr, "(%s, frame %d) ", what, i);
+	  fail("stepping does not follow the reference\n");
+	}
+
+      if (FAS_SUCCESS != fas_get_frame(context, &image))
+	fail("fail on get_frame\n");
+      if (image_checksum(&image) != checksums[i])
+	{
+	  fprintf(stderr, "(%s, frame %d) ", what, i);
+	  fail("frame differs from the reference\n");
+	}
+      fas_free_frame(image);
+
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step\n");
+    }
+
+  if (!seekable)
+    return;
+
+  for (i=0;i<N_SEEKS;i++)
+    {
+      int target = rand() % n_frames;
+
+      if (FAS_SUCCESS != fas_seek_to_frame(context, target) || fas_get_frame_index(context) != target)
+	{
+	  fprintf(stderr, "(%s, frame %d) ", what, target);
+	  fail("fail on seek\n");
+	}
+
+      if (FAS_SUCCESS != fas_get_frame(context, &image))
+	fail("fail on get_frame\n");
+      if (image_checksum(&image) != checksums[target])
+	{
+	  fprintf(stderr, "(%s, seek to %d) ", what, target);
+	  fail("frame differs from the reference\n");
+	}
+      fas_free_frame(image);
+    }
+}
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type context;
+  fas_open_options_type options = fas_default_open_options();
+  fas_custom_io_type io;
+  fas_raw_image_type image;
+  unsigned long checksums[N_FRAMES];
+  unsigned char *data;
+  long long data_size;
+  FILE *file;
+  int n_frames = 0;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video_with_options(&context, argv[1], options))
+    fail("fail on open (reference)\n");
+
+  while (n_frames < N_FRAMES && fas_frame_available(context))
+    {
+      if (FAS_SUCCESS != fas_get_frame(context, &image))
+	fail("fail on get_frame (reference)\n");
+      checksums[n_frames++] = image_checksum(&image);
+      fas_free_frame(image);
+
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step (reference)\n");
+    }
+  fas_close_video(context);
+
+  file = fopen(argv[1], "rb");
+  if (NULL == file)
+    fail("unable to open the file\n");
+  data_size = file_size(file);
+  data = (unsigned char *) malloc(data_size);
+  if (fread(data, 1, data_size, file) != (size_t) data_size)
+    fail("unable to read the file\n");
+
+  srand(12345);
+
+  /* memory */
+  memset(&io, 0, sizeof(io));
+  io.data        = data;
+  io.data_size   = data_size;
+  io.buffer_size = BUFFER_SIZE;
+  io.name        = argv[1];
+  if (FAS_SUCCESS != fas_open_video_custom_io(&context, &io, options))
+    fail("fail on open (memory)\n");
+  check_video(context, checksums, n_frames, FAS_TRUE, "memory");
+  fas_close_video(context);
+
+  /* seekable callbacks, without a name to probe by */
+  memset(&io, 0, sizeof(io));
+  io.read   = file_read;
+  io.seek   = file_seek;
+  io.size   = file_size;
+  io.opaque = file;
+  rewind(file);
+  if (FAS_SUCCESS != fas_open_video_custom_io(&context, &io, options))
+    fail("fail on open (callbacks)\n");
+  check_video(context, checksums, n_frames, FAS_TRUE, "callbacks");
+  fas_close_video(context);
+
+  /* a stream: read only */
+  io.seek = NULL;
+  io.size = NULL;
+  rewind(file);
+  if (FAS_SUCCESS != fas_open_video_custom_io(&context, &io, options))
+    fail("fail on open (read only)\n");
+  check_video(context, checksums, n_frames, FAS_FALSE, "read only");
+  fas_close_video(context);
+
+  memset(&io, 0, sizeof(io));
+  if (FAS_SUCCESS == fas_open_video_custom_io(&context, &io, options))
+    fail("open without data or callbacks succeeded\n");
+
+  fclose(file);
+  free(data);
+
+  success();
+}
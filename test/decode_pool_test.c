@@ -0,0 +1,239 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ *
+ * This file is part of the Frame Accurate Seeking extension library to
+ * ffmpeg (ffmpeg-fas).
+ *
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define N_WORKERS      4
+#define N_WHOLE_JOBS   6
+#define N_INDICES      200
+#define MAX_FRAMES     20000
+
+/* Runs whole-file jobs, a part of the file and a random index set (with duplicates) through a
+   pool, and checks that every requested frame arrives exactly once (as often as it was asked
+   for) and equals the frame read by a plain context. */
+
+typedef struct
+{
+  pthread_mutex_t lock;
+  int            *counts;        /* deliveries per frame */
+  int             mismatches;
+  int             done_calls;
+  fas_error_type  done_error;
+} job_record_type;
+
+unsigned int *gbl_checksums;
+int           gbl_n_frames;
+
+unsigned int view_checksum(fas_frame_view_type *view)
+{
+  unsigned int sum = 2166136261U;
+  int row, col;
+
+  for (row=0;row<view->height;row++)
+    for (col=0;col<view->width;col++)
+      sum = (sum ^ view->data[0][row * view->linesize[0] + col]) * 16777619U;
+
+  return sum;
+}
+
+void on_frame(void *user_data, int frame_index, fas_frame_view_type *view)
+{
+  job_record_type *record = (job_record_type *) user_data;
+  unsigned int sum = view_checksum(view);
+
+  pthread_mutex_lock(&record->lock);
+  if (frame_index < 0 || frame_index >= gbl_n_frames || sum != gbl_checksums[frame_index])
+    record->mismatches++;
+  else
+    record->counts[frame_index]++;
+  pthread_mutex_unlock(&record->lock);
+}
+
+void on_done(void *user_data, fas_error_type error)
+{
+  job_record_type *record = (job_record_type *) user_data;
+
+  pthread_mutex_lock(&record->lock);
+  record->done_calls++;
+  record->done_error = error;
+  pthread_mutex_unlock(&record->lock);
+}
+
+void init_record(job_record_type *record)
+{
+  pthread_mutex_init(&record->lock, NULL);
+  record->counts     = (int *) calloc(gbl_n_frames, sizeof(int));
+  record->mismatches = 0;
+  record->done_calls = 0;
+  record->done_error = FAS_FAILURE;
+}
+
+void check_record(job_record_type *record, int *expected, char *what)
+{
+  int i;
+
+  if (record->done_calls != 1 || record->done_error != FAS_SUCCESS)
+    {
+      fprintf(stderr, "(%s) ", what);
+      fail("job did not finish once, successfully\n");
+    }
+
+  if (record->mismatches)
+    {
+      fprintf(stderr, "(%s, %d frames) ", what, record->mismatches);
+      fail("pool frame differs from the reference\n");
+    }
+
+  for (i=0;i<gbl_n_frames;i++)
+    if (record->counts[i] != expected[i])
+      {
+	fprintf(stderr, "(%s, frame %d: %d times, expected %d) ", what, i, record->counts[i], expected[i]);
+	fail("wrong number of deliveries\n");
+      }
+}
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type context;
+  fas_open_options_type options = fas_default_open_options();
+  fas_frame_view_type view;
+  fas_pool_ref_type pool;
+  fas_pool_job_type job;
+  fas_pool_stats_type stats;
+  job_record_type whole[N_WHOLE_JOBS], part, sampled;
+  int *all, *part_expected, *sampled_expected;
+  int indices[N_INDICES];
+  int i;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+  options.format = FAS_GRAY8;
+
+  if (FAS_SUCCESS != fas_open_video_with_options(&context, argv[1], options))
+    fail("fail on open (reference)\n");
+
+  gbl_checksums = (unsigned int *) malloc(MAX_FRAMES * sizeof(unsigned int));
+  gbl_n_frames = 0;
+  while (gbl_n_frames < MAX_FRAMES && fas_frame_available(context))
+    {
+      if (FAS_SUCCESS != fas_get_frame_view(context, &view))
+	fail("fail on get_frame_view (reference)\n");
+      gbl_checksums[gbl_n_frames++] = view_checksum(&view);
+
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step (reference)\n");
+    }
+  fas_close_video(context);
+
+  if (gbl_n_frames == MAX_FRAMES)
+    fail("video too long for this test\n");
+
+  all              = (int *) calloc(gbl_n_frames, sizeof(int));
+  part_expected    = (int *) calloc(gbl_n_frames, sizeof(int));
+  sampled_expected = (int *) calloc(gbl_n_frames, sizeof(int));
+  for (i=0;i<gbl_n_frames;i++)
+    all[i] = 1;
+  for (i=gbl_n_frames/3;i<=gbl_n_frames/2;i++)
+    part_expected[i] = 1;
+
+  srand(12345);
+  for (i=0;i<N_INDICES;i++)
+    {
+      indices[i] = (i % 10 == 9) ? indices[i - 1] : rand() % gbl_n_frames;
+      sampled_expected[indices[i]]++;
+    }
+
+  if (FAS_SUCCESS != fas_pool_create(&pool, N_WORKERS, options))
+    fail("fail on pool create\n");
+
+  memset(&job, 0, sizeof(job));
+  job.file_path = argv[1];
+  job.callback  = on_frame;
+  job.done      = on_done;
+
+  for (i=0;i<N_WHOLE_JOBS;i++)
+    {
+      init_record(&whole[i]);
+      job.first_frame = 0;
+      job.last_frame  = -1;
+      job.user_data   = &whole[i];
+      if (FAS_SUCCESS != fas_pool_submit(pool, &job))
+	fail("fail on submit (whole file)\n");
+    }
+
+  init_record(&part);
+  job.first_frame = gbl_n_frames / 3;
+  job.last_frame  = gbl_n_frames / 2;
+  job.user_data   = &part;
+  if (FAS_SUCCESS != fas_pool_submit(pool, &job))
+    fail("fail on submit (part)\n");
+
+  init_record(&sampled);
+  job.indices   = indices;
+  job.n_indices = N_INDICES;
+  job.user_data = &sampled;
+  if (FAS_SUCCESS != fas_pool_submit(pool, &job))
+    fail("fail on submit (index set)\n");
+
+  if (FAS_SUCCESS != fas_pool_wait(pool))
+    fail("a pool job failed\n");
+
+  for (i=0;i<N_WHOLE_JOBS;i++)
+    check_record(&whole[i], all, "whole file");
+  check_record(&part, part_expected, "part");
+  check_record(&sampled, sampled_expected, "index set");
+
+  if (FAS_SUCCESS != fas_get_pool_stats(pool, &stats) || stats.jobs != N_WHOLE_JOBS + 2)
+    fail("pool stats do not count the jobs\n");
+
+  fprintf(stderr, "(%lld chunks, %lld stolen, %lld on reused contexts) ", stats.chunks, stats.steals, stats.reuses);
+
+  /* a job past the end fails on its own */
+  free(part.counts);
+  init_record(&part);
+  memset(&job, 0, sizeof(job));
+  job.file_path   = argv[1];
+  job.callback    = on_frame;
+  job.done        = on_done;
+  job.user_data   = &part;
+  job.first_frame = 0;
+  job.last_frame  = gbl_n_frames + 10;
+  if (FAS_SUCCESS != fas_pool_submit(pool, &job))
+    fail("fail on submit (past the end)\n");
+
+  if (FAS_SUCCESS == fas_pool_wait(pool) || part.done_calls != 1 || part.done_error == FAS_SUCCESS)
+    fail("job past the end did not fail\n");
+
+  fas_pool_destroy(pool);
+
+  success();
+}
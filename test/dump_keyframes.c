@@ -27,7 +27,7 @@
 int main (int argc, char **argv)
 {
   fas_error_type video_error;
-  fas_context_ref_type context, seek_context;
+  fas_context_ref_type context;
   
   if (argc < 3) {
     fprintf (stderr, "usage: %s <video_file> <seek_table>\n", argv[0]);
@@ -46,17 +46,10 @@ int main (int argc, char **argv)
   video_error = fas_put_seek_table(context, table);
   if (video_error != FAS_SUCCESS)    fail("fail on put_seek_table\n");
 
-  video_error = fas_open_video (&seek_context, argv[1]);
-  if (video_error != FAS_SUCCESS)    fail("fail on open\n");
-  
-  int i;
-  for(i=0;i<table.num_entries;i++)
+  /* keyframes are streamed: the packets in between are demuxed, not decoded */
+  while (fas_frame_available (context))
     {
-      //      int frame_index = table.array[table.num_entries - i - 1].display_index;
-      int frame_index = table.array[i].display_index;
-      if (FAS_SUCCESS != fas_seek_to_frame(context, frame_index))
-	fail("failed on seek");
-
+      int frame_index = fas_get_frame_index(context);
       fas_raw_image_type image_buffer;
 
       if (FAS_SUCCESS != fas_get_frame (context, &image_buffer))
@@ -65,10 +58,13 @@ int main (int argc, char **argv)
       char filename[50];
       sprintf(filename, "frame_%04d.ppm", frame_index);
       
-      fprintf(stderr, "Writing %s (seek_table_value=%d frame_index=%d)\n", filename, frame_index, fas_get_frame_index(context));
+      fprintf(stderr, "Writing %s (frame_index=%d)\n", filename, frame_index);
       ppm_save(&image_buffer, filename);
       
       fas_free_frame (image_buffer);
+
+      if (FAS_SUCCESS != fas_step_to_next_keyframe (context))
+	fail("failed on step to next keyframe\n");
     }
   
   success();
@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_FRAMES       200
+#define CACHE_FRAMES   40
+#define N_SCRUBS       20
+
+/* Scrubs back and forth over a window that fits in the frame cache (with and without
+   read-ahead) and checks frames against a plain decode, and that revisits are cache hits. */
+
+int same_frame(fas_raw_image_type a, fas_raw_image_type b)
+{
+  if (a.width != b.width || a.height != b.height || a.bytes_per_line != b.bytes_per_line)
+    return 0;
+
+  return !memcmp(a.data, b.data, a.bytes_per_line * a.height);
+}
+
+void check_frame(fas_context_ref_type context, fas_raw_image_type *frames, int index)
+{
+  fas_raw_image_type image;
+
+  if (fas_get_frame_index(context) != index)
+    fail("wrong frame index\n");
+
+  if (FAS_SUCCESS != fas_get_frame(context, &image))
+    fail("fail on get_frame\n");
+
+  if (!same_frame(frames[index], image))
+    fail("frame differs from plain decode\n");
+  fas_free_frame(image);
+}
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type context;
+  fas_open_options_type options = fas_default_open_options();
+  fas_frame_cache_stats_type stats;
+  fas_raw_image_type frames[N_FRAMES];
+  int n_frames = 0;
+  int pass, i, j;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video(&context, argv[1]))
+    fail("fail on open (reference)\n");
+
+  while (n_frames < N_FRAMES && fas_frame_available(context))
+    {
+      if (FAS_SUCCESS != fas_get_frame(context, &frames[n_frames]))
+	fail("fail on get_frame (reference)\n");
+      n_frames++;
+
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step (reference)\n");
+    }
+  fas_close_video(context);
+
+  if (n_frames < 2)
+    fail("video too short\n");
+
+  for (pass = 0; pass < 2; pass++)
+    {
+      options.read_ahead = pass ? 8 : 0;
+      if (FAS_SUCCESS != fas_open_video_with_options(&context, argv[1], options))
+	fail("fail on open\n");
+
+      /* decoded frames are at most 4 bytes per pixel */
+      long long frame_bytes = 4LL * fas_get_current_width(context) * fas_get_current_height(context);
+      if (FAS_SUCCESS != fas_set_frame_cache(context, CACHE_FRAMES * frame_bytes))
+	fail("fail on set_frame_cache\n");
+
+      int window = (n_frames < CACHE_FRAMES / 2) ? n_frames : CACHE_FRAMES / 2;
+      int start  = n_frames - window;
+
+      /* first pass over the window decodes, later ones only hit the cache */
+      for (i = 0; i < N_SCRUBS; i++)
+	{
+	  for (j = start + window - 1; j >= start; j--)
+	    {
+	      if (FAS_SUCCESS != fas_seek_to_frame(context, j))
+		fail("fail on backward seek\n");
+	      check_frame(context, frames, j);
+	    }
+
+	  for (j = start + 1; j < start + window; j++)
+	    {
+	      if (FAS_SUCCESS != fas_step_forward(context))
+		fail("fail on step\n");
+	      check_frame(context, frames, j);
+	    }
+
+	  if (i == 0 && FAS_SUCCESS != fas_get_frame_cache_stats(context, &stats))
+	    fail("fail on stats\n");
+	}
+
+      fas_frame_cache_stats_type after;
+      fas_get_frame_cache_stats(context, &after);
+      if (after.misses != stats.misses)
+	fail("revisiting a cached window missed\n");
+      if (after.hits <= stats.hits || after.num_frames <= 0 || after.bytes > CACHE_FRAMES * frame_bytes)
+	fail("cache stats are off\n");
+
+      /* leaving the cached window hands back to the decoder */
+      if (FAS_SUCCESS != fas_seek_to_frame(context, 0))
+	fail("fail on seek to start\n");
+      for (j = 0; j < n_frames; j++)
+	{
+	  check_frame(context, frames, j);
+	  if (FAS_SUCCESS != fas_step_forward(context))
+	    fail("fail on step\n");
+	}
+
+      fas_close_video(context);
+    }
+
+  for (i=0;i<n_frames;i++)
+    fas_free_frame(frames[i]);
+
+  success();
+}
@@ -0,0 +1,57 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#ifndef FAS_TEST_FRAME_CHECKSUM
+#define FAS_TEST_FRAME_CHECKSUM
+
+/* frame hashes for the tests that link libffmpeg_fas (test_support.h is also used by tests
+   built from single library sources) */
+
+#include "ffmpeg_fas.h"
+#include "test_support.h"
+
+/* hash of an image's bytes, for comparing frames from different decodes */
+static unsigned long image_checksum(fas_raw_image_type *image)
+{
+    unsigned long sum = 0;
+    int i;
+
+    for (i=0; i<image->bytes_per_line * image->height; i++)
+      sum = sum * 31 + image->data[i];
+
+    return sum;
+}
+
+/* image_checksum of the context's current frame */
+static unsigned long frame_checksum(fas_context_ref_type context)
+{
+    fas_raw_image_type image;
+    unsigned long sum;
+
+    if (FAS_SUCCESS != fas_get_frame(context, &image))
+      fail("fail on get_frame\n");
+    sum = image_checksum(&image);
+    fas_free_frame(image);
+
+    return sum;
+}
+
+#endif
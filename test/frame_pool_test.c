@@ -0,0 +1,123 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define N_FRAMES       200
+#define POOL_SIZE      4
+#define ROW_PADDING    64
+
+/* Checks fas_get_frame from the buffer pool and fas_get_frame_into a padded caller image
+   against each other, and the first frame against a malloc'ed fas_get_frame. With images
+   freed as they are used, every pooled fas_get_frame after the first should reuse a buffer. */
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type context;
+  fas_raw_image_type plain, pooled, mine;
+  fas_frame_pool_stats_type stats;
+  int n_frames = 0;
+  int j;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video(&context, argv[1]))
+    fail("fail on open\n");
+
+  /* taken before the pool is on and released after, so it must still be free()d */
+  if (FAS_SUCCESS != fas_get_frame(context, &plain))
+    fail("fail on get_frame\n");
+
+  fas_set_frame_pool(POOL_SIZE);
+
+  mine.width          = fas_get_current_width(context);
+  mine.height         = fas_get_current_height(context);
+  mine.bytes_per_line = plain.bytes_per_line + ROW_PADDING;
+  mine.data           = malloc(mine.bytes_per_line * mine.height);
+
+  while (n_frames < N_FRAMES && fas_frame_available(context))
+    {
+      if (FAS_SUCCESS != fas_get_frame(context, &pooled))
+	fail("fail on pooled get_frame\n");
+
+      if (((uintptr_t) pooled.data) % 32)
+	fail("pooled buffer not aligned\n");
+
+      memset(mine.data, 0xAB, mine.bytes_per_line * mine.height);
+      if (FAS_SUCCESS != fas_get_frame_into(context, &mine))
+	fail("fail on get_frame_into\n");
+
+      if (mine.color_space != pooled.color_space || pooled.bytes_per_line != plain.bytes_per_line)
+	fail("image layouts differ\n");
+
+      for (j = 0; j < pooled.height; j++)
+	{
+	  if (0 == n_frames && memcmp(plain.data + j * plain.bytes_per_line, pooled.data + j * pooled.bytes_per_line, plain.bytes_per_line))
+	    fail("pooled frame differs from malloc'ed one\n");
+	  if (memcmp(pooled.data + j * pooled.bytes_per_line, mine.data + j * mine.bytes_per_line, pooled.bytes_per_line))
+	    fail("caller's frame differs\n");
+	  if (mine.data[j * mine.bytes_per_line + pooled.bytes_per_line] != 0xAB)
+	    fail("get_frame_into wrote into the row padding\n");
+	}
+
+      fas_free_frame(pooled);
+
+      n_frames++;
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step\n");
+    }
+
+  fas_free_frame(plain);
+
+  fas_get_frame_pool_stats(&stats);
+  fprintf(stderr, "(%lld allocations, %lld reuses) ", stats.allocations, stats.reuses);
+
+  if (stats.allocations != 1 || stats.reuses != n_frames - 1 || stats.lent != 0)
+    fail("pool did not reuse its buffer\n");
+
+  /* turning the pool off frees what it kept */
+  fas_set_frame_pool(0);
+  fas_get_frame_pool_stats(&stats);
+  if (stats.idle != 0)
+    fail("pool still holds buffers\n");
+
+  mine.width++;
+  if (FAS_INVALID_ARGUMENT != fas_get_frame_into(context, &mine))
+    fail("get_frame_into accepted the wrong size\n");
+
+  free(mine.data);
+  fas_close_video(context);
+
+  success();
+}
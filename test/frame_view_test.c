@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_FRAMES       200
+
+/* Checks that frame views (with their strides) hold the same pixels as fas_get_frame and
+   fas_fill_420p_ptrs, that views of one frame share a generation, and that stepping and
+   seeking change it. */
+
+int same_rows(fas_raw_image_type image, fas_frame_view_type view)
+{
+  int j;
+
+  if (image.width != view.width || image.height != view.height || image.color_space != view.color_space)
+    return 0;
+
+  for (j = 0; j < image.height; j++)
+    if (memcmp(image.data + j * image.bytes_per_line, view.data[0] + j * view.linesize[0], image.bytes_per_line))
+      return 0;
+
+  return 1;
+}
+
+int same_420p(fas_context_ref_type context, fas_frame_view_type view)
+{
+  int width = view.width, height = view.height;
+  unsigned char *y = malloc(width * height);
+  unsigned char *u = malloc(width * height / 4);
+  unsigned char *v = malloc(width * height / 4);
+  int j, same = 1;
+
+  if (FAS_SUCCESS != fas_fill_420p_ptrs(context, y, u, v))
+    fail("fail on fill_420p_ptrs\n");
+
+  for (j = 0; j < height; j++)
+    same = same && !memcmp(y + j * width, view.data[0] + j * view.linesize[0], width);
+  for (j = 0; j < height / 2; j++)
+    {
+      same = same && !memcmp(u + j * width / 2, view.data[1] + j * view.linesize[1], width / 2);
+      same = same && !memcmp(v + j * width / 2, view.data[2] + j * view.linesize[2], width / 2);
+    }
+
+  free(y);
+  free(u);
+  free(v);
+  return same;
+}
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type context;
+  fas_raw_image_type frames[N_FRAMES];
+  fas_frame_view_type view, again, decoded;
+  unsigned long long last_generation = 0;
+  int n_frames = 0;
+  int i;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video(&context, argv[1]))
+    fail("fail on open\n");
+
+  while (n_frames < N_FRAMES && fas_frame_available(context))
+    {
+      if (FAS_SUCCESS != fas_get_frame(context, &frames[n_frames]))
+	fail("fail on get_frame\n");
+
+      if (FAS_SUCCESS != fas_get_frame_view(context, &view) || FAS_SUCCESS != fas_get_frame_view(context, &again))
+	fail("fail on get_frame_view\n");
+
+      if (!same_rows(frames[n_frames], view))
+	fail("view differs from get_frame\n");
+
+      if (view.generation != again.generation || view.data[0] != again.data[0])
+	fail("two views of one frame differ\n");
+
+      if (n_frames > 0 && view.generation == last_generation)
+	fail("generation did not change with the frame\n");
+      last_generation = view.generation;
+
+      /* the decoder's planes are only handed out when they can be described */
+      if (FAS_SUCCESS == fas_get_decoded_view(context, &decoded))
+	{
+	  if (decoded.generation != view.generation)
+	    fail("decoded view from another generation\n");
+	  if (decoded.color_space == FAS_YUV420P && !same_420p(context, decoded))
+	    fail("decoded view differs from fill_420p_ptrs\n");
+	}
+
+      n_frames++;
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step\n");
+    }
+
+  srand(12345);
+  for (i = 0; i < n_frames; i++)
+    {
+      int target = rand() % n_frames;
+      int previous = fas_get_frame_index(context);
+
+      if (FAS_SUCCESS != fas_seek_to_frame(context, target))
+	fail("fail on seek\n");
+
+      if (FAS_SUCCESS != fas_get_frame_view(context, &view))
+	fail("fail on get_frame_view after seek\n");
+
+      if (!same_rows(frames[target], view))
+	fail("view differs after seek\n");
+
+      if (target != previous && view.generation == last_generation)
+	fail("generation did not change with the seek\n");
+      last_generation = view.generation;
+    }
+
+  for (i = 0; i < n_frames; i++)
+    fas_free_frame(frames[i]);
+
+  fas_close_video(context);
+
+  success();
+}
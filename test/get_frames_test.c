@@ -0,0 +1,96 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "test_support.h"
+#include "frame_checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_FRAMES       300
+#define N_REQUESTS     100
+
+/* Asks fas_get_frames for random frames (with repeats, in random order) and checks each
+   image against a sequential decode; a batch with a bad index returns nothing. */
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type context;
+  fas_raw_image_type images[N_REQUESTS];
+  fas_seek_stats_type stats;
+  unsigned long sums[N_FRAMES];
+  int indices[N_REQUESTS];
+  int n_frames = 0;
+  int i;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video(&context, argv[1]))
+    fail("fail on open (reference)\n");
+  while (n_frames < N_FRAMES && fas_frame_available(context))
+    {
+      sums[n_frames++] = frame_checksum(context);
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step (reference)\n");
+    }
+  fas_close_video(context);
+
+  if (FAS_SUCCESS != fas_open_video(&context, argv[1]))
+    fail("fail on open\n");
+
+  srand(1);
+  for (i=0;i<N_REQUESTS;i++)
+    indices[i] = (i % 10 == 9) ? indices[i / 2] : rand() % n_frames;
+
+  if (FAS_SUCCESS != fas_get_frames(context, indices, N_REQUESTS, images))
+    fail("fail on get_frames\n");
+
+  for (i=0;i<N_REQUESTS;i++)
+    {
+      if (image_checksum(&images[i]) != sums[indices[i]])
+	fail("wrong frame in batch\n");
+      fas_free_frame(images[i]);
+    }
+
+  /* sorted into display order, the batch mostly decodes forward */
+  if (FAS_SUCCESS != fas_get_seek_stats(context, &stats))
+    fail("fail on get_seek_stats\n");
+  fprintf(stderr, "(%lld forward, %lld keyframe seeks) ", stats.forward_seeks, stats.keyframe_seeks);
+
+  indices[N_REQUESTS / 2] = 1 << 30;
+  if (FAS_SUCCESS == fas_get_frames(context, indices, N_REQUESTS, images))
+    fail("batch with a bad index succeeded\n");
+  for (i=0;i<N_REQUESTS;i++)
+    if (images[i].data != NULL)
+      fail("failed batch returned an image\n");
+
+  fas_close_video(context);
+
+  success();
+}
@@ -0,0 +1,112 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include "frame_checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Walks a video keyframe by keyframe with fas_step_to_next_keyframe and checks the indices
+   against the seek table of a full decode, and the images against seeks to the same frames.
+   Then checks that normal stepping carries on correctly from a keyframe reached that way. */
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type reference, context;
+  seek_table_type table;
+  unsigned long *sums;
+  int i;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video(&reference, argv[1]))
+    fail("fail on open (reference)\n");
+
+  while (fas_frame_available(reference))
+    if (FAS_SUCCESS != fas_step_forward(reference))
+      fail("fail on step (reference)\n");
+
+  table = seek_copy_table(fas_get_seek_table(reference));
+  if (table.num_entries == 0)
+    fail("no keyframes\n");
+
+  sums = (unsigned long *) malloc(table.num_entries * sizeof(unsigned long));
+  for (i=0;i<table.num_entries;i++) {
+    if (FAS_SUCCESS != fas_seek_to_frame(reference, table.array[i].display_index))
+      fail("fail on seek (reference)\n");
+    sums[i] = frame_checksum(reference);
+  }
+
+  /* a fresh context: its table is built as it goes, or completed first */
+  if (FAS_SUCCESS != fas_open_video(&context, argv[1]))
+    fail("fail on open\n");
+
+  i = 0;
+  while (fas_frame_available(context)) {
+    if (i >= table.num_entries)
+      fail("more keyframes than in the table\n");
+    if (fas_get_frame_index(context) != table.array[i].display_index)
+      fail("wrong keyframe index\n");
+    if (frame_checksum(context) != sums[i])
+      fail("keyframe differs from seek\n");
+    i++;
+
+    if (FAS_SUCCESS != fas_step_to_next_keyframe(context))
+      fail("fail on step_to_next_keyframe\n");
+  }
+  if (i != table.num_entries)
+    fail("missed keyframes\n");
+
+  /* stepping on normally after a keyframe step */
+  if (table.num_entries > 1 && table.array[1].display_index + 1 < table.num_frames) {
+    int next = table.array[1].display_index + 1;
+
+    if (FAS_SUCCESS != fas_seek_to_frame(context, 0))
+      fail("fail on seek to start\n");
+    if (FAS_SUCCESS != fas_step_to_next_keyframe(context))
+      fail("fail on step_to_next_keyframe\n");
+    if (FAS_SUCCESS != fas_step_forward(context))
+      fail("fail on step after keyframe\n");
+    if (fas_get_frame_index(context) != next)
+      fail("wrong index after keyframe\n");
+    if (FAS_SUCCESS != fas_seek_to_frame(reference, next))
+      fail("fail on seek (reference)\n");
+    if (frame_checksum(context) != frame_checksum(reference))
+      fail("frame after keyframe differs\n");
+  }
+
+  free(sums);
+  seek_release_table(&table);
+  fas_close_video(context);
+  fas_close_video(reference);
+
+  success();
+}
@@ -0,0 +1,141 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_FRAMES       200
+#define N_SEEKS        50
+#define MAX_MEAN_DIFF  16.0
+
+/* Decodes a video at full and at quarter resolution (lowres 2). When the codec can do it, the
+   reduced context must report and return reduced frames, seek to the same indices, and look
+   like the full frames scaled down to its size. */
+
+double mean_difference(fas_raw_image_type a, fas_raw_image_type b)
+{
+  long long total = 0;
+  int i, j;
+
+  for (j = 0; j < a.height; j++)
+    for (i = 0; i < a.width * 3; i++)
+      total += abs(a.data[j * a.bytes_per_line + i] - b.data[j * b.bytes_per_line + i]);
+
+  return (double) total / (a.width * 3 * a.height);
+}
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type full, reduced;
+  fas_open_options_type options = fas_default_open_options();
+  fas_output_geometry_type geometry;
+  fas_raw_image_type full_image, image;
+  int n_frames = 0;
+  int i;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  options.lowres = 2;
+  if (FAS_SUCCESS != fas_open_video(&full, argv[1]) || FAS_SUCCESS != fas_open_video_with_options(&reduced, argv[1], options))
+    fail("fail on open\n");
+
+  if (fas_get_lowres(reduced) == 0)
+    {
+      fprintf(stderr, "(codec decodes full frames only) ");
+      if (fas_get_current_width(reduced) != fas_get_current_width(full))
+	fail("size changed without lowres\n");
+      success();
+    }
+
+  int width  = fas_get_current_width(reduced);
+  int height = fas_get_current_height(reduced);
+  if (width != (fas_get_current_width(full) + 3) / 4 || height != (fas_get_current_height(full) + 3) / 4)
+    fail("reduced size not reported\n");
+
+  /* the full frames, scaled to the reduced size, are the reference */
+  memset(&geometry, 0, sizeof(geometry));
+  geometry.width  = width;
+  geometry.height = height;
+  geometry.filter = FAS_FILTER_AREA;
+  fas_set_output_geometry(full, geometry);
+
+  clock_t full_time = 0, reduced_time = 0, start;
+  while (n_frames < N_FRAMES && fas_frame_available(full))
+    {
+      if (!fas_frame_available(reduced) || fas_get_frame_index(reduced) != n_frames)
+	fail("reduced context out of step\n");
+
+      if (FAS_SUCCESS != fas_get_frame(full, &full_image) || FAS_SUCCESS != fas_get_frame(reduced, &image))
+	fail("fail on get_frame\n");
+
+      if (image.width != width || image.height != height)
+	fail("reduced frame has the wrong size\n");
+
+      if (mean_difference(full_image, image) > MAX_MEAN_DIFF)
+	fail("reduced frame does not look like the full one\n");
+
+      fas_free_frame(full_image);
+      fas_free_frame(image);
+
+      n_frames++;
+      start = clock();
+      if (FAS_SUCCESS != fas_step_forward(full))
+	fail("fail on step\n");
+      full_time += clock() - start;
+
+      start = clock();
+      if (FAS_SUCCESS != fas_step_forward(reduced))
+	fail("fail on step (reduced)\n");
+      reduced_time += clock() - start;
+    }
+
+  fprintf(stderr, "(decode %.2fs full, %.2fs reduced) ", (double) full_time / CLOCKS_PER_SEC, (double) reduced_time / CLOCKS_PER_SEC);
+
+  srand(12345);
+  for (i = 0; i < N_SEEKS; i++)
+    {
+      int target = rand() % n_frames;
+
+      if (FAS_SUCCESS != fas_seek_to_frame(reduced, target) || fas_get_frame_index(reduced) != target)
+	fail("reduced seek landed on the wrong index\n");
+
+      if (FAS_SUCCESS != fas_get_frame(reduced, &image) || image.width != width || image.height != height)
+	fail("reduced frame after seek has the wrong size\n");
+      fas_free_frame(image);
+    }
+
+  fas_close_video(full);
+  fas_close_video(reduced);
+
+  success();
+}
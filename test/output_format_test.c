@@ -0,0 +1,111 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_FRAMES       100
+
+/* Decodes one video as RGB24 and GRAY8 side by side, in two contexts and by switching one
+   (read-ahead) context back and forth, and checks every frame against the fixed-format
+   contexts. The GRAY8 context must also agree with fas_fill_gray8_ptr. */
+
+int same_image(fas_raw_image_type a, fas_raw_image_type b)
+{
+  if (a.width != b.width || a.height != b.height || a.bytes_per_line != b.bytes_per_line || a.color_space != b.color_space)
+    return 0;
+
+  return !memcmp(a.data, b.data, a.bytes_per_line * a.height);
+}
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type rgb, gray, both;
+  fas_open_options_type options = fas_default_open_options();
+  fas_raw_image_type rgb_image, gray_image, image;
+  unsigned char *y;
+  int n_frames = 0;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video(&rgb, argv[1]))
+    fail("fail on open (rgb)\n");
+
+  if (FAS_SUCCESS != fas_open_video(&gray, argv[1]) || FAS_SUCCESS != fas_set_output_format(gray, FAS_GRAY8))
+    fail("fail on open (gray8)\n");
+
+  options.read_ahead = 4;
+  if (FAS_SUCCESS != fas_open_video_with_options(&both, argv[1], options))
+    fail("fail on open (switching)\n");
+
+  if (fas_get_output_format(rgb) != FAS_RGB24 || fas_get_output_format(gray) != FAS_GRAY8)
+    fail("output formats not kept per video\n");
+
+  y = malloc(fas_get_current_width(gray) * fas_get_current_height(gray));
+
+  while (n_frames < N_FRAMES && fas_frame_available(rgb))
+    {
+      if (FAS_SUCCESS != fas_get_frame(rgb, &rgb_image) || FAS_SUCCESS != fas_get_frame(gray, &gray_image))
+	fail("fail on get_frame\n");
+
+      if (gray_image.color_space != FAS_GRAY8 || gray_image.bytes_per_line != gray_image.width)
+	fail("gray8 image has the wrong layout\n");
+
+      if (FAS_SUCCESS != fas_fill_gray8_ptr(gray, y) || memcmp(y, gray_image.data, gray_image.width * gray_image.height))
+	fail("gray8 frame differs from fill_gray8_ptr\n");
+
+      /* both formats of the same frame from the switching context */
+      fas_set_output_format(both, (n_frames % 2) ? FAS_GRAY8 : FAS_RGB24);
+      if (FAS_SUCCESS != fas_get_frame(both, &image) || !same_image(image, (n_frames % 2) ? gray_image : rgb_image))
+	fail("switched frame differs\n");
+      fas_free_frame(image);
+
+      fas_set_output_format(both, (n_frames % 2) ? FAS_RGB24 : FAS_GRAY8);
+      if (FAS_SUCCESS != fas_get_frame(both, &image) || !same_image(image, (n_frames % 2) ? rgb_image : gray_image))
+	fail("frame differs after switching back\n");
+      fas_free_frame(image);
+
+      fas_free_frame(rgb_image);
+      fas_free_frame(gray_image);
+
+      n_frames++;
+      if (FAS_SUCCESS != fas_step_forward(rgb) || FAS_SUCCESS != fas_step_forward(gray) || FAS_SUCCESS != fas_step_forward(both))
+	fail("fail on step\n");
+    }
+
+  free(y);
+  fas_close_video(rgb);
+  fas_close_video(gray);
+  fas_close_video(both);
+
+  success();
+}
@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_FRAMES       60
+#define TOLERANCE      8
+
+/* Crops without scaling and checks the result against the same rectangle of the whole frame
+   (chroma filtering at the crop edges may differ slightly). Decoders with packed output only
+   take crops at 0,0, so for those the offset crop must be refused and the test crops at 0,0.
+   Then scales to half size, with and without read-ahead, and checks sizes, aspect ratio and
+   that both contexts agree. */
+
+int close_to_rectangle(fas_raw_image_type whole, fas_raw_image_type crop, int x, int y)
+{
+  int i, j;
+
+  for (j = 0; j < crop.height; j++)
+    for (i = 0; i < crop.width * 3; i++)
+      {
+	int a = whole.data[(y + j) * whole.bytes_per_line + x * 3 + i];
+	int b = crop.data[j * crop.bytes_per_line + i];
+	if (abs(a - b) > TOLERANCE)
+	  return 0;
+      }
+
+  return 1;
+}
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type whole, cropped, scaled, scaled_ahead;
+  fas_open_options_type options = fas_default_open_options();
+  fas_output_geometry_type geometry;
+  fas_raw_image_type whole_image, image, ahead_image;
+  fas_frame_view_type view;
+  fas_error_type fas_error;
+  int n_frames = 0;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video(&whole, argv[1]) || FAS_SUCCESS != fas_open_video(&cropped, argv[1]) ||
+      FAS_SUCCESS != fas_open_video(&scaled, argv[1]))
+    fail("fail on open\n");
+
+  options.read_ahead = 4;
+  if (FAS_SUCCESS != fas_open_video_with_options(&scaled_ahead, argv[1], options))
+    fail("fail on open (read-ahead)\n");
+
+  int width  = fas_get_current_width(whole);
+  int height = fas_get_current_height(whole);
+
+  memset(&geometry, 0, sizeof(geometry));
+  geometry.crop_x      = width / 4;
+  geometry.crop_y      = height / 4;
+  geometry.crop_width  = width / 2;
+  geometry.crop_height = height / 2;
+  geometry.filter      = FAS_FILTER_POINT;
+  fas_error = fas_set_output_geometry(cropped, geometry);
+  if (FAS_INVALID_ARGUMENT == fas_error)
+    {
+      if (FAS_SUCCESS == fas_get_decoded_view(cropped, &view) &&
+	  (view.color_space == FAS_YUV420P || view.color_space == FAS_YUV422P || view.color_space == FAS_YUV444P))
+	fail("crop offset refused for a planar decoder\n");
+
+      geometry.crop_x = geometry.crop_y = 0;
+      fas_error = fas_set_output_geometry(cropped, geometry);
+    }
+  if (FAS_SUCCESS != fas_error)
+    fail("fail on set_output_geometry (crop)\n");
+  int crop_x = geometry.crop_x & ~1;
+  int crop_y = geometry.crop_y & ~1;
+
+  memset(&geometry, 0, sizeof(geometry));
+  geometry.width  = width / 2;
+  geometry.filter = FAS_FILTER_AREA;
+  if (FAS_SUCCESS != fas_set_output_geometry(scaled, geometry) || FAS_SUCCESS != fas_set_output_geometry(scaled_ahead, geometry))
+    fail("fail on set_output_geometry (scale)\n");
+
+  geometry.crop_x = width;
+  if (FAS_INVALID_ARGUMENT != fas_set_output_geometry(scaled, geometry))
+    fail("crop outside the frame accepted\n");
+
+  while (n_frames < N_FRAMES && fas_frame_available(whole))
+    {
+      if (FAS_SUCCESS != fas_get_frame(whole, &whole_image) || FAS_SUCCESS != fas_get_frame(cropped, &image))
+	fail("fail on get_frame\n");
+
+      if (image.width != width / 2 || image.height != height / 2 || image.bytes_per_line != image.width * 3)
+	fail("cropped image has the wrong size\n");
+
+      if (!close_to_rectangle(whole_image, image, crop_x, crop_y))
+	fail("crop differs from the whole frame\n");
+      fas_free_frame(image);
+
+      if (FAS_SUCCESS != fas_get_frame(scaled, &image) || FAS_SUCCESS != fas_get_frame(scaled_ahead, &ahead_image))
+	fail("fail on get_frame (scaled)\n");
+
+      if (image.width != width / 2 || image.height != (int) ((long long) height * (width / 2) / width))
+	fail("scaled image has the wrong size\n");
+
+      if (image.bytes_per_line != ahead_image.bytes_per_line || image.height != ahead_image.height ||
+	  memcmp(image.data, ahead_image.data, image.bytes_per_line * image.height))
+	fail("read-ahead scaled frame differs\n");
+
+      fas_free_frame(whole_image);
+      fas_free_frame(image);
+      fas_free_frame(ahead_image);
+
+      n_frames++;
+      if (FAS_SUCCESS != fas_step_forward(whole) || FAS_SUCCESS != fas_step_forward(cropped) ||
+	  FAS_SUCCESS != fas_step_forward(scaled) || FAS_SUCCESS != fas_step_forward(scaled_ahead))
+	fail("fail on step\n");
+    }
+
+  fas_close_video(whole);
+  fas_close_video(cropped);
+  fas_close_video(scaled);
+  fas_close_video(scaled_ahead);
+
+  success();
+}
@@ -0,0 +1,88 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <time.h>
+
+/* Builds the seek table from packets and by decoding and checks they agree. Videos the
+   packet scan refuses are reported and pass: the library decodes those instead. */
+
+int main (int argc, char **argv)
+{
+  seek_table_type decoded, packets;
+  fas_error_type video_error;
+  clock_t start;
+  double decode_time, packet_time;
+  int i, j;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  start = clock();
+  video_error = fas_build_seek_table (argv[1], FAS_INDEX_PACKETS, &packets);
+  packet_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  if (video_error == FAS_UNSUPPORTED_CODEC)
+    {
+      fprintf(stderr, "(not indexable from packets) ");
+      success();
+    }
+  if (video_error != FAS_SUCCESS)
+    fail("fail on packet index\n");
+
+  start = clock();
+  video_error = fas_build_seek_table (argv[1], FAS_INDEX_DECODE, &decoded);
+  decode_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+  if (video_error != FAS_SUCCESS)
+    fail("fail on decode index\n");
+
+  if (packets.num_frames != decoded.num_frames)
+    fail("frame counts differ\n");
+
+  /* every packet seek point must be one the decoder found too (the decoder may find more) */
+  for (i=0, j=0; i<packets.num_entries; i++)
+    {
+      while (j < decoded.num_entries && decoded.array[j].display_index < packets.array[i].display_index)
+	j++;
+
+      if (j == decoded.num_entries ||
+	  decoded.array[j].display_index    != packets.array[i].display_index ||
+	  decoded.array[j].first_packet_dts != packets.array[i].first_packet_dts ||
+	  decoded.array[j].last_packet_dts  != packets.array[i].last_packet_dts)
+	fail("packet seek table entry does not match decoded table\n");
+    }
+
+  fprintf(stderr, "(packets: %.2fs decode: %.2fs) ", packet_time, decode_time);
+
+  seek_release_table(&packets);
+  seek_release_table(&decoded);
+
+  success();
+}
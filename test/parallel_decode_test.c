@@ -0,0 +1,143 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ *
+ * This file is part of the Frame Accurate Seeking extension library to
+ * ffmpeg (ffmpeg-fas).
+ *
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "test_support.h"
+#include "frame_checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define N_THREADS      4
+#define MAX_FRAMES     20000
+#define SMALL_BUDGET   16            /* frames */
+
+/* Reads a file through the parallel decoder with a budget of a few frames and with no budget,
+   and checks that the frames come out in display order, equal to fas_step_forward's, and that
+   a slow reader keeps the buffered frames within the budget. Then closes one part way through. */
+
+void check_pass(char *file_path, long long max_bytes, long long frame_bytes, fas_open_options_type options,
+		unsigned long *checksums, int n_frames)
+{
+  fas_parallel_ref_type parallel;
+  fas_parallel_stats_type stats;
+  fas_raw_image_type image;
+  fas_error_type fas_error;
+  int i = 0;
+
+  if (FAS_SUCCESS != fas_parallel_open(&parallel, file_path, N_THREADS, max_bytes, options))
+    fail("fail on parallel open\n");
+
+  while (FAS_SUCCESS == (fas_error = fas_parallel_next(parallel, &image)))
+    {
+      if (i >= n_frames || image_checksum(&image) != checksums[i])
+	{
+	  fprintf(stderr, "(frame %d, budget %lld) ", i, max_bytes);
+	  fail("parallel frame differs from the reference\n");
+	}
+      fas_free_frame(image);
+      i++;
+
+      /* give the decoders time to fill the budget */
+      if (max_bytes > 0)
+	usleep(200);
+    }
+
+  if (FAS_NO_MORE_FRAMES != fas_error)
+    fail("parallel pass ended with an error\n");
+
+  if (i != n_frames)
+    {
+      fprintf(stderr, "(%d of %d frames, budget %lld) ", i, n_frames, max_bytes);
+      fail("parallel pass returned the wrong number of frames\n");
+    }
+
+  /* one frame over is allowed, for the segment being read */
+  if (FAS_SUCCESS != fas_get_parallel_stats(parallel, &stats) || stats.bytes != 0)
+    fail("parallel stats do not add up\n");
+  if (max_bytes > 0 && stats.peak_bytes > max_bytes + frame_bytes)
+    {
+      fprintf(stderr, "(%lld bytes buffered, budget %lld) ", stats.peak_bytes, max_bytes);
+      fail("parallel pass went over its budget\n");
+    }
+
+  fas_parallel_close(parallel);
+}
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type context;
+  fas_open_options_type options = fas_default_open_options();
+  fas_parallel_ref_type parallel;
+  fas_raw_image_type image;
+  unsigned long *checksums;
+  long long frame_bytes = 0;
+  int n_frames = 0;
+  int i;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+  options.format = FAS_GRAY8;
+
+  if (FAS_SUCCESS != fas_open_video_with_options(&context, argv[1], options))
+    fail("fail on open (reference)\n");
+
+  checksums = (unsigned long *) malloc(MAX_FRAMES * sizeof(unsigned long));
+  while (n_frames < MAX_FRAMES && fas_frame_available(context))
+    {
+      if (FAS_SUCCESS != fas_get_frame(context, &image))
+	fail("fail on get_frame (reference)\n");
+      checksums[n_frames++] = image_checksum(&image);
+      frame_bytes = (long long) image.bytes_per_line * image.height;
+      fas_free_frame(image);
+
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step (reference)\n");
+    }
+  fas_close_video(context);
+
+  if (n_frames == MAX_FRAMES)
+    fail("video too long for this test\n");
+
+  check_pass(argv[1], SMALL_BUDGET * frame_bytes, frame_bytes, options, checksums, n_frames);
+  check_pass(argv[1], 0, frame_bytes, options, checksums, n_frames);
+
+  /* closing with threads still decoding (or waiting for room) */
+  if (FAS_SUCCESS != fas_parallel_open(&parallel, argv[1], N_THREADS, SMALL_BUDGET * frame_bytes, options))
+    fail("fail on parallel open (early close)\n");
+
+  for (i=0;i<n_frames/4;i++)
+    {
+      if (FAS_SUCCESS != fas_parallel_next(parallel, &image))
+	fail("fail on parallel next (early close)\n");
+      fas_free_frame(image);
+    }
+  fas_parallel_close(parallel);
+
+  success();
+}
@@ -0,0 +1,75 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+/* The parallel seek table builder must produce exactly the single-threaded table. */
+
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+int main (int argc, char **argv)
+{
+  seek_table_type serial, parallel;
+  int n_threads = 4;
+  double start, serial_time, parallel_time;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file> [n_threads]\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  if (argc > 2)
+    n_threads = atoi(argv[2]);
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  start = now();
+  if (FAS_SUCCESS != fas_build_seek_table (argv[1], FAS_INDEX_DECODE, &serial))
+    fail("fail on serial table\n");
+  serial_time = now() - start;
+
+  start = now();
+  if (FAS_SUCCESS != fas_build_seek_table_parallel (argv[1], n_threads, &parallel))
+    fail("fail on parallel table\n");
+  parallel_time = now() - start;
+
+  if (!compare_seek_tables(serial, parallel))
+    fail("parallel table differs from serial table\n");
+
+  fprintf(stderr, "(serial: %.2fs parallel x%d: %.2fs) ", serial_time, n_threads, parallel_time);
+
+  seek_release_table(&serial);
+  seek_release_table(&parallel);
+
+  success();
+}
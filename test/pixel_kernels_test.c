@@ -0,0 +1,139 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "pixel_kernels.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Runs every kernel at every level this machine supports and checks the output
+   matches the scalar level byte for byte, over odd sizes and padded strides. */
+
+#define N_SIZES 6
+
+static const int widths[N_SIZES]  = { 1, 7, 16, 33, 67, 640 };
+static const int heights[N_SIZES] = { 1, 3, 2, 9, 5, 24 };
+
+static uint8_t *random_plane(int stride, int rows)
+{
+  uint8_t *plane = (uint8_t *) malloc(stride * rows);
+  int i;
+  if (plane == NULL)
+    fail("out of memory\n");
+  for (i=0;i<stride * rows;i++)
+    plane[i] = rand() & 0xff;
+  return plane;
+}
+
+static void check_420(pixel_level_type level, int width, int height)
+{
+  int cw = (width + 1) / 2, ch = (height + 1) / 2;
+  int y_stride = width + 5, c_stride = cw + 3;
+  uint8_t *y = random_plane(y_stride, height);
+  uint8_t *u = random_plane(c_stride, ch);
+  uint8_t *v = random_plane(c_stride, ch);
+  int order;
+
+  for (order=PIXEL_RGB24;order<=PIXEL_ABGR;order++) {
+    int stride = width * 4 + 9;
+    uint8_t *expected = (uint8_t *) calloc(stride, height);
+    uint8_t *actual = (uint8_t *) calloc(stride, height);
+    int j;
+
+    pixel_set_level(PIXEL_SCALAR);
+    pixel_yuv420p_to_packed(expected, stride, (pixel_order_type) order, y, y_stride, u, c_stride, v, c_stride, width, height);
+    pixel_set_level(level);
+    pixel_yuv420p_to_packed(actual, stride, (pixel_order_type) order, y, y_stride, u, c_stride, v, c_stride, width, height);
+
+    for (j=0;j<height;j++)
+      if (memcmp(expected + j * stride, actual + j * stride, width * (order <= PIXEL_BGR24 ? 3 : 4)))
+        fail("yuv420p to packed differs from scalar\n");
+
+    free(expected);
+    free(actual);
+  }
+
+  free(y);
+  free(u);
+  free(v);
+}
+
+static void check_422(pixel_level_type level, int width, int height, int uyvy)
+{
+  int cw = (width + 1) / 2;
+  int src_stride = cw * 4 + 6;
+  uint8_t *src = random_plane(src_stride, height);
+  uint8_t *planes[2][3];
+  int pass, p, j;
+
+  for (pass=0;pass<2;pass++) {
+    for (p=0;p<3;p++)
+      planes[pass][p] = (uint8_t *) calloc(width + 16, height);
+    pixel_set_level(pass ? level : PIXEL_SCALAR);
+    pixel_packed422_to_planar(planes[pass][0], width + 16, planes[pass][1], width + 16, planes[pass][2], width + 16,
+                              src, src_stride, uyvy, width, height);
+  }
+
+  for (j=0;j<height;j++)
+    if (memcmp(planes[0][0] + j * (width + 16), planes[1][0] + j * (width + 16), width) ||
+        memcmp(planes[0][1] + j * (width + 16), planes[1][1] + j * (width + 16), cw) ||
+        memcmp(planes[0][2] + j * (width + 16), planes[1][2] + j * (width + 16), cw))
+      fail("packed 4:2:2 to planar differs from scalar\n");
+
+  /* and the scalar result really is the byte shuffle */
+  if (planes[0][0][0] != src[uyvy ? 1 : 0] || planes[0][1][0] != src[uyvy ? 0 : 1] || planes[0][2][0] != src[uyvy ? 2 : 3])
+    fail("packed 4:2:2 layout\n");
+
+  for (pass=0;pass<2;pass++)
+    for (p=0;p<3;p++)
+      free(planes[pass][p]);
+  free(src);
+}
+
+int main (int argc, char **argv)
+{
+  uint8_t y[2] = { 235, 16 }, u[1] = { 128 }, v[1] = { 128 }, rgb[6];
+  int level, i;
+
+  srand(1);
+
+  fprintf(stderr, "best level %d : ", pixel_best_level());
+
+  /* white and black stay white and black */
+  pixel_set_level(PIXEL_SCALAR);
+  pixel_yuv420p_to_packed(rgb, 6, PIXEL_RGB24, y, 2, u, 1, v, 1, 2, 1);
+  if (rgb[0] != 255 || rgb[1] != 255 || rgb[2] != 255 || rgb[3] != 0 || rgb[4] != 0 || rgb[5] != 0)
+    fail("reference colors\n");
+
+  for (level=PIXEL_SCALAR;level<=PIXEL_NEON;level++) {
+    if (pixel_set_level((pixel_level_type) level) != level)
+      continue;
+    for (i=0;i<N_SIZES;i++) {
+      check_420((pixel_level_type) level, widths[i], heights[i]);
+      check_422((pixel_level_type) level, widths[i], heights[i], 0);
+      check_422((pixel_level_type) level, widths[i], heights[i], 1);
+    }
+  }
+
+  success();
+}
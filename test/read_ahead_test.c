@@ -0,0 +1,166 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define READ_AHEAD     8
+#define N_FRAMES       300
+#define N_ITERATIONS   200
+
+/* Steps and seeks a read-ahead context and checks every frame (and index) against a plain
+   context: seeks that land inside the read-ahead window and ones that cancel it are mixed.
+   Along the way it takes the seek table while frames are being read ahead, and walks it. */
+
+int same_frame(fas_raw_image_type a, fas_raw_image_type b)
+{
+  if (a.width != b.width || a.height != b.height || a.bytes_per_line != b.bytes_per_line)
+    return 0;
+
+  return !memcmp(a.data, b.data, a.bytes_per_line * a.height);
+}
+
+void check_frame(fas_context_ref_type context, fas_raw_image_type *frames, char *what)
+{
+  fas_raw_image_type image;
+  int index = fas_get_frame_index(context);
+
+  if (FAS_SUCCESS != fas_get_frame(context, &image))
+    fail("fail on get_frame\n");
+
+  if (!same_frame(frames[index], image))
+    {
+      fprintf(stderr, "(frame %d, %s) ", index, what);
+      fail("read-ahead frame differs\n");
+    }
+  fas_free_frame(image);
+}
+
+void check_table(fas_context_ref_type context, fas_raw_image_type *frames)
+{
+  seek_table_type table;
+  int index = fas_get_frame_index(context);
+  int i, previous = -1;
+
+  table = fas_get_seek_table(context);
+  if (table.num_entries < 1 || NULL == table.array)
+    fail("empty seek table during read-ahead\n");
+
+  /* read every entry after giving the producer time to append (were it still running) */
+  usleep(2000);
+  for (i=0;i<table.num_entries;i++)
+    {
+      if (table.array[i].display_index <= previous)
+	fail("seek table taken during read-ahead is out of order\n");
+      previous = table.array[i].display_index;
+    }
+
+  if (fas_get_frame_index(context) != index)
+    fail("taking the seek table moved the current frame\n");
+  check_frame(context, frames, "after taking the seek table");
+}
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type reference, context;
+  fas_open_options_type options = fas_default_open_options();
+  fas_raw_image_type frames[N_FRAMES];
+  int n_frames = 0;
+  int i;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video(&reference, argv[1]))
+    fail("fail on open (reference)\n");
+
+  while (n_frames < N_FRAMES && fas_frame_available(reference))
+    {
+      if (FAS_SUCCESS != fas_get_frame(reference, &frames[n_frames]))
+	fail("fail on get_frame (reference)\n");
+      n_frames++;
+
+      if (FAS_SUCCESS != fas_step_forward(reference))
+	fail("fail on step (reference)\n");
+    }
+  fas_close_video(reference);
+
+  options.read_ahead = READ_AHEAD;
+  if (FAS_SUCCESS != fas_open_video_with_options(&context, argv[1], options))
+    fail("fail on open (read-ahead)\n");
+
+  for (i=0;i<n_frames;i++)
+    {
+      if (fas_get_frame_index(context) != i || !fas_frame_available(context))
+	fail("read-ahead index out of step\n");
+
+      check_frame(context, frames, "stepping");
+
+      if (i % 25 == 10)
+	check_table(context, frames);
+
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step (read-ahead)\n");
+    }
+
+  srand(12345);
+  for (i=0;i<N_ITERATIONS;i++)
+    {
+      int target = rand() % n_frames;
+
+      /* every other seek stays close, usually inside what was already read ahead */
+      if (i % 2 && fas_get_frame_index(context) + READ_AHEAD / 2 < n_frames)
+	target = fas_get_frame_index(context) + 1 + rand() % (READ_AHEAD / 2);
+
+      if (FAS_SUCCESS != fas_seek_to_frame(context, target))
+	fail("fail on seek (read-ahead)\n");
+
+      if (fas_get_frame_index(context) != target)
+	fail("read-ahead seek landed on the wrong index\n");
+
+      check_frame(context, frames, "seek");
+
+      if (target + 1 < n_frames)
+	{
+	  if (FAS_SUCCESS != fas_step_forward(context))
+	    fail("fail on step after seek\n");
+	  check_frame(context, frames, "step after seek");
+	}
+    }
+
+  for (i=0;i<n_frames;i++)
+    fas_free_frame(frames[i]);
+
+  fas_close_video(context);
+
+  success();
+}
@@ -0,0 +1,104 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "test_support.h"
+#include "frame_checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_FRAMES       600
+#define STRIDE         7
+
+/* Samples a video every STRIDE frames and once a second with fas_step_sample, checking the
+   frames against a sequential decode and the indices against the frame rate. */
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type context;
+  unsigned long sums[N_FRAMES];
+  int n_frames = 0;
+  int samples = 0;
+  double frames_per_second;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video(&context, argv[1]))
+    fail("fail on open (reference)\n");
+  while (n_frames < N_FRAMES && fas_frame_available(context))
+    {
+      sums[n_frames++] = frame_checksum(context);
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step (reference)\n");
+    }
+  fas_close_video(context);
+
+  if (FAS_SUCCESS != fas_open_video(&context, argv[1]))
+    fail("fail on open\n");
+
+  /* every STRIDE frames */
+  if (FAS_SUCCESS != fas_set_sampling(context, STRIDE, 0))
+    fail("fail on set_sampling\n");
+  while (fas_frame_available(context) && fas_get_frame_index(context) < n_frames)
+    {
+      if (fas_get_frame_index(context) != samples * STRIDE)
+	fail("wrong frame index for stride\n");
+      if (frame_checksum(context) != sums[samples * STRIDE])
+	fail("sampled frame differs\n");
+      samples++;
+
+      if (FAS_SUCCESS != fas_step_sample(context))
+	fail("fail on step_sample\n");
+    }
+
+  /* once a second, from the start */
+  frames_per_second = 10000000. / fas_get_frame_duration(context);
+  if (FAS_SUCCESS != fas_seek_to_frame(context, 0))
+    fail("fail on seek\n");
+  if (FAS_SUCCESS != fas_set_sampling(context, 0, 1.0))
+    fail("fail on set_sampling (fps)\n");
+
+  samples = 0;
+  while (fas_frame_available(context) && fas_get_frame_index(context) < n_frames)
+    {
+      int expected = (int) (samples * (frames_per_second < 1. ? 1. : frames_per_second) + 0.5);
+      if (fas_get_frame_index(context) != expected)
+	fail("wrong frame index for fps\n");
+      if (frame_checksum(context) != sums[expected])
+	fail("sampled frame differs (fps)\n");
+      samples++;
+
+      if (FAS_SUCCESS != fas_step_sample(context))
+	fail("fail on step_sample (fps)\n");
+    }
+
+  fas_close_video(context);
+
+  success();
+}
@@ -0,0 +1,129 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "seek_cache.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Stores and reloads seek tables through the on-disk cache, using fake "video" files. */
+
+#define CACHE_DIR "seek_cache_test.dir"
+
+static void write_video(char *name, int seed, int size)
+{
+  FILE *file = fopen(name, "wb");
+  int i;
+  if (file == NULL)
+    fail("creating video file\n");
+  for (i=0;i<size;i++)
+    fputc((i * 31 + seed) & 0xff, file);
+  fclose(file);
+}
+
+static seek_table_type make_table(int num_entries)
+{
+  seek_table_type table = seek_init_table(-1);
+  seek_entry_type entry;
+  int i;
+
+  for (i=0;i<num_entries;i++)
+    {
+      entry.display_index    = i * 12;
+      entry.first_packet_dts = i * 12 * 3600 - 3600;
+      entry.last_packet_dts  = i * 12 * 3600;
+      seek_append_table_entry(&table, entry);
+    }
+
+  table.num_frames = num_entries * 12;
+  table.completed  = seek_true;
+  return table;
+}
+
+int main (int argc, char **argv)
+{
+  char names[3][32] = { "seek_cache_test_0.vid", "seek_cache_test_1.vid", "seek_cache_test_2.vid" };
+  seek_table_type table = make_table(1000);
+  seek_table_type loaded;
+  int i;
+
+  for (i=0;i<3;i++)
+    write_video(names[i], i, 200 * 1024);
+
+  if (seek_cache_load(CACHE_DIR, names[0], NULL, &loaded) == seek_no_error)
+    fail("hit in an empty cache\n");
+
+  if (seek_cache_store(CACHE_DIR, names[0], NULL, table, 0) != seek_no_error)
+    fail("store\n");
+
+  if (seek_cache_load(CACHE_DIR, names[0], NULL, &loaded) != seek_no_error || !compare_seek_tables(table, loaded))
+    fail("stored table does not load back\n");
+  seek_release_table(&loaded);
+
+  if (seek_cache_load(CACHE_DIR, names[1], NULL, &loaded) == seek_no_error)
+    fail("hit for a different video\n");
+
+  if (seek_cache_load(CACHE_DIR, names[0], "frame-threads", &loaded) == seek_no_error)
+    fail("hit for a different decoder variant\n");
+
+  /* same size, different content at the end: must miss */
+  write_video(names[0], 0, 200 * 1024 - 1);
+  FILE *file = fopen(names[0], "ab");
+  fputc(0x42, file);
+  fclose(file);
+  if (seek_cache_load(CACHE_DIR, names[0], NULL, &loaded) == seek_no_error)
+    fail("hit after the video changed\n");
+
+  /* incomplete tables are never cached */
+  table.completed = seek_false;
+  if (seek_cache_store(CACHE_DIR, names[1], NULL, table, 0) == seek_no_error)
+    fail("stored an incomplete table\n");
+  table.completed = seek_true;
+
+  /* a cap of one entry keeps only the most recent store */
+  if (seek_cache_store(CACHE_DIR, names[1], NULL, table, 0) != seek_no_error ||
+      seek_cache_store(CACHE_DIR, names[2], NULL, table, 10000) != seek_no_error)
+    fail("store\n");
+
+  if (seek_cache_load(CACHE_DIR, names[2], NULL, &loaded) != seek_no_error)
+    fail("most recent entry was evicted\n");
+  seek_release_table(&loaded);
+
+  int hits = 0;
+  for (i=0;i<2;i++)
+    if (seek_cache_load(CACHE_DIR, names[i], NULL, &loaded) == seek_no_error)
+      {
+	hits++;
+	seek_release_table(&loaded);
+      }
+  if (hits != 0)
+    fail("cache was not trimmed\n");
+
+  seek_cache_trim(CACHE_DIR, 1);
+  for (i=0;i<3;i++)
+    remove(names[i]);
+  remove(CACHE_DIR);
+  seek_release_table(&table);
+
+  success();
+}
@@ -0,0 +1,94 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "test_support.h"
+#include "frame_checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_FRAMES       300
+#define STRIDE         3
+
+/* A sampling loop (every STRIDE-th frame through fas_seek_to_frame) should decode forward
+   without a single keyframe seek, and return the same frames as a sequential decode; a
+   seek backwards has to go to a keyframe. */
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type context;
+  fas_seek_stats_type stats;
+  unsigned long sums[N_FRAMES];
+  int n_frames = 0;
+  int i;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video(&context, argv[1]))
+    fail("fail on open (reference)\n");
+  while (n_frames < N_FRAMES && fas_frame_available(context))
+    {
+      sums[n_frames++] = frame_checksum(context);
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step (reference)\n");
+    }
+  fas_close_video(context);
+
+  if (FAS_SUCCESS != fas_open_video(&context, argv[1]))
+    fail("fail on open\n");
+
+  for (i=STRIDE;i<n_frames;i+=STRIDE)
+    {
+      if (FAS_SUCCESS != fas_seek_to_frame(context, i))
+	fail("fail on seek\n");
+      if (fas_get_frame_index(context) != i || frame_checksum(context) != sums[i])
+	fail("wrong frame after forward seek\n");
+    }
+
+  if (FAS_SUCCESS != fas_get_seek_stats(context, &stats))
+    fail("fail on get_seek_stats\n");
+  if (stats.keyframe_seeks != 0 || stats.forward_seeks != (n_frames - 1) / STRIDE)
+    fail("sampling loop did not decode forward\n");
+
+  if (FAS_SUCCESS != fas_seek_to_frame(context, 1))
+    fail("fail on seek back\n");
+  if (frame_checksum(context) != sums[1])
+    fail("wrong frame after seek back\n");
+
+  if (FAS_SUCCESS != fas_get_seek_stats(context, &stats))
+    fail("fail on get_seek_stats\n");
+  if (stats.keyframe_seeks != 1 || stats.frame_usec <= 0 || stats.seek_usec <= 0)
+    fail("seek back did not go to a keyframe\n");
+
+  fprintf(stderr, "(%lld frames at %lld us, seeks %lld us) ", stats.frames_decoded, stats.frame_usec, stats.seek_usec);
+
+  fas_close_video(context);
+
+  success();
+}
@@ -0,0 +1,179 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Compares seek_get_nearest_entry (and the packed table lookup) against the old linear scan on synthetic tables.
+   Every lookup is checked against the scan, so this also doubles as a correctness test.
+ */
+
+#define GOP_SIZE   12
+#define SCAN_WORK  200000000.0   /* bound on entries touched by the linear scan per table size */
+
+static int linear_find(seek_table_type *table, int display_index)
+{
+  int i;
+  for (i=0; i < table->num_entries; i++)
+    if (table->array[i].display_index > display_index)
+      break;
+
+  return i - 1;
+}
+
+static seek_table_type make_table(int num_entries, int jitter)
+{
+  seek_table_type table = seek_init_table(num_entries);
+  seek_entry_type entry;
+  int i;
+
+  entry.display_index = 0;
+  for (i=0;i<num_entries;i++)
+    {
+      entry.first_packet_dts = (int64_t)entry.display_index * 3600;
+      entry.last_packet_dts  = entry.first_packet_dts + 3600;
+      if (seek_no_error != seek_append_table_entry(&table, entry))
+	fail("append failed\n");
+
+      entry.display_index += GOP_SIZE;
+      if (jitter)
+	entry.display_index += random() % GOP_SIZE;
+    }
+
+  table.num_frames = entry.display_index;
+  table.completed  = seek_true;
+  return table;
+}
+
+static double time_packed_lookups(seek_packed_table_type *packed, int *targets, int n_targets)
+{
+  seek_entry_type entry;
+  clock_t start = clock();
+  int i;
+
+  for (i=0;i<n_targets;i++)
+    if (seek_no_error != seek_packed_get_nearest_entry(packed, &entry, targets[i], 0))
+      fail("packed lookup failed\n");
+
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static double time_lookups(seek_table_type *table, int *targets, int n_targets, int use_scan)
+{
+  seek_entry_type entry;
+  clock_t start = clock();
+  int i;
+
+  for (i=0;i<n_targets;i++)
+    {
+      if (use_scan)
+	{
+	  if (linear_find(table, targets[i]) < 0)
+	    fail("scan failed\n");
+	}
+      else if (seek_no_error != seek_get_nearest_entry(table, &entry, targets[i], 0))
+	fail("lookup failed\n");
+    }
+
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void run_size(int num_entries, int jitter)
+{
+  seek_table_type table = make_table(num_entries, jitter);
+  seek_packed_table_type packed;
+  int n_targets = (int)(SCAN_WORK / num_entries);
+  int *targets;
+  int i;
+
+  if (n_targets < 100)
+    n_targets = 100;
+  if (n_targets > 1000000)
+    n_targets = 1000000;
+
+  targets = (int *)malloc(n_targets * sizeof(int));
+  for (i=0;i<n_targets;i++)
+    targets[i] = random() % table.num_frames;
+
+  if (seek_no_error != seek_pack_table(table, &packed, -1))
+    fail("pack failed\n");
+
+  /* all strategies must agree with the scan */
+  for (i=0;i<n_targets && i<10000;i++)
+    {
+      seek_entry_type entry;
+      int expected = linear_find(&table, targets[i]);
+
+      seek_set_search_hint(&table, seek_search_binary);
+      seek_get_nearest_entry(&table, &entry, targets[i], 0);
+      if (entry.display_index != table.array[expected].display_index)
+	fail("binary search disagrees with scan\n");
+
+      seek_set_search_hint(&table, seek_search_interpolate);
+      seek_get_nearest_entry(&table, &entry, targets[i], 0);
+      if (entry.display_index != table.array[expected].display_index)
+	fail("interpolation search disagrees with scan\n");
+
+      seek_packed_get_nearest_entry(&packed, &entry, targets[i], 1);
+      if (expected >= 1 &&
+	  (entry.display_index != table.array[expected].display_index ||
+	   entry.last_packet_dts != table.array[expected].last_packet_dts ||
+	   entry.first_packet_dts != table.array[expected - 1].first_packet_dts))
+	fail("packed lookup disagrees with scan\n");
+    }
+
+  double scan = time_lookups(&table, targets, n_targets, 1);
+  seek_set_search_hint(&table, seek_search_binary);
+  double bisect = time_lookups(&table, targets, n_targets, 0);
+  seek_set_search_hint(&table, seek_search_interpolate);
+  double interp = time_lookups(&table, targets, n_targets, 0);
+  double packed_time = time_packed_lookups(&packed, targets, n_targets);
+
+  printf("%9d entries %-8s %8d lookups   scan: %10.1f ns   binary: %7.1f ns   interpolate: %7.1f ns   packed: %7.1f ns (%.1f bytes/entry)\n",
+	 num_entries, jitter ? "jitter" : "regular", n_targets,
+	 scan * 1e9 / n_targets, bisect * 1e9 / n_targets, interp * 1e9 / n_targets, packed_time * 1e9 / n_targets,
+	 (packed.num_blocks * sizeof(seek_block_type) + packed.data_size) / (double) num_entries);
+
+  free(targets);
+  seek_release_packed_table(&packed);
+  seek_release_table(&table);
+}
+
+int main (int argc, char **argv)
+{
+  int max_entries = 10000000;
+  int n;
+
+  if (argc > 1)
+    max_entries = atoi(argv[1]);
+
+  for (n = 1000; n <= max_entries; n *= 10)
+    {
+      run_size(n, 0);
+      run_size(n, 1);
+    }
+
+  success();
+}
@@ -0,0 +1,103 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_SEEKS 200
+
+/* Random seeks on a context that may skip B-pictures while rolling forward, checked against
+   a context that decodes every frame (a frame cache too small to hold anything turns skipping
+   off). Prints both times; MPEG-1/2 with B-pictures should show the difference. */
+
+int same_frame(fas_raw_image_type a, fas_raw_image_type b)
+{
+  if (a.width != b.width || a.height != b.height || a.bytes_per_line != b.bytes_per_line)
+    return 0;
+
+  return !memcmp(a.data, b.data, a.bytes_per_line * a.height);
+}
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type skipping, decoding;
+  fas_raw_image_type a, b;
+  clock_t skip_time = 0, decode_time = 0, start;
+  int n_frames, i;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video(&skipping, argv[1]))
+    fail("fail on open\n");
+  if (FAS_SUCCESS != fas_open_video(&decoding, argv[1]))
+    fail("fail on open (reference)\n");
+  if (FAS_SUCCESS != fas_set_frame_cache(decoding, 1))
+    fail("fail on set_frame_cache\n");
+
+  n_frames = fas_get_frame_count(skipping);
+  if (n_frames <= 0 || fas_get_frame_count(decoding) != n_frames)
+    fail("fail on frame count\n");
+
+  srand(1);
+  for (i=0;i<N_SEEKS;i++) {
+    int target = rand() % n_frames;
+
+    start = clock();
+    if (FAS_SUCCESS != fas_seek_to_frame(skipping, target))
+      fail("fail on seek\n");
+    skip_time += clock() - start;
+
+    start = clock();
+    if (FAS_SUCCESS != fas_seek_to_frame(decoding, target))
+      fail("fail on seek (reference)\n");
+    decode_time += clock() - start;
+
+    if (fas_get_frame_index(skipping) != target || fas_get_frame_index(decoding) != target)
+      fail("wrong frame index\n");
+
+    if (FAS_SUCCESS != fas_get_frame(skipping, &a) || FAS_SUCCESS != fas_get_frame(decoding, &b))
+      fail("fail on get_frame\n");
+    if (!same_frame(a, b))
+      fail("frame differs when skipping\n");
+    fas_free_frame(a);
+    fas_free_frame(b);
+  }
+
+  fprintf(stderr, "(%.2fs skipping, %.2fs decoding) ", (double) skip_time / CLOCKS_PER_SEC,
+          (double) decode_time / CLOCKS_PER_SEC);
+
+  fas_close_video(skipping);
+  fas_close_video(decoding);
+
+  success();
+}
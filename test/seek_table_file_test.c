@@ -0,0 +1,168 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+
+/* Round-trips a synthetic seek table through the text, binary and packed table formats. */
+
+static seek_table_type make_table(int num_entries)
+{
+  seek_table_type table = seek_init_table(-1);
+  seek_entry_type entry;
+  int i;
+
+  for (i=0;i<num_entries;i++)
+    {
+      entry.display_index    = i * 15 + (i % 3);
+      entry.first_packet_dts = (int64_t) entry.display_index * 3003 - 3003;
+      entry.last_packet_dts  = (int64_t) entry.display_index * 3003 + ((int64_t) 1 << 33);
+      seek_append_table_entry(&table, entry);
+    }
+
+  table.num_frames = num_entries * 15 + 7;
+  table.completed  = seek_true;
+  return table;
+}
+
+int main (int argc, char **argv)
+{
+  char *text_name   = "seek_table_file_test.txt";
+  char *binary_name = "seek_table_file_test.bin";
+  char *packed_name = "seek_table_file_test.pack";
+  seek_packed_table_type packed, mapped;
+  seek_table_type table = make_table(5000);
+  seek_table_type loaded;
+  FILE *file;
+
+  file = fopen(text_name, "w");
+  if (file == NULL || seek_no_error != seek_show_raw_table(file, table))
+    fail("writing text table\n");
+  fclose(file);
+
+  file = fopen(binary_name, "wb");
+  if (file == NULL || seek_no_error != seek_write_binary_table(file, table))
+    fail("writing binary table\n");
+  fclose(file);
+
+  if (seek_no_error != seek_pack_table(table, &packed, 16))
+    fail("packing table\n");
+
+  file = fopen(packed_name, "wb");
+  if (file == NULL || seek_no_error != seek_write_packed_table(file, packed))
+    fail("writing packed table\n");
+  fclose(file);
+
+  loaded = seek_unpack_table(&packed);
+  if (!compare_seek_tables(table, loaded))
+    fail("packed table does not unpack\n");
+  seek_release_table(&loaded);
+
+  loaded = read_table_file(packed_name);
+  if (!compare_seek_tables(table, loaded))
+    fail("packed table does not round-trip through read_table_file\n");
+  seek_release_table(&loaded);
+
+  if (seek_no_error != seek_map_packed_table_file(packed_name, &mapped))
+    fail("mapping packed table\n");
+
+  int i, offset;
+  for (i = table.array[0].display_index; i < table.num_frames; i += 7)
+    for (offset = 0; offset < 3; offset++)
+      {
+	seek_entry_type expected, found;
+	seek_error_type e1 = seek_get_nearest_entry(&table, &expected, i, offset);
+	seek_error_type e2 = seek_packed_get_nearest_entry(&mapped, &found, i, offset);
+
+	if (e1 != e2 || (e1 == seek_no_error &&
+			 (expected.display_index != found.display_index ||
+			  expected.first_packet_dts != found.first_packet_dts ||
+			  expected.last_packet_dts != found.last_packet_dts)))
+	  fail("packed lookup does not match table lookup\n");
+      }
+
+  seek_release_packed_table(&mapped);
+
+  /* decoding must stop at the end of a block whose deltas were cut short */
+  size_t data_size = packed.data_size;
+  packed.data_size = packed.blocks[packed.num_blocks - 1].offset + 1;
+  loaded = seek_unpack_table(&packed);
+  if (loaded.array != NULL)
+    fail("truncated packed block was unpacked\n");
+  seek_entry_type last;
+  if (seek_no_error == seek_packed_get_nearest_entry(&packed, &last, table.array[table.num_entries - 1].display_index, 0))
+    fail("truncated packed block was searched\n");
+  packed.data_size = data_size;
+
+  seek_release_packed_table(&packed);
+
+  loaded = read_table_file(text_name);
+  if (!compare_seek_tables(table, loaded))
+    fail("text table does not round-trip\n");
+  seek_release_table(&loaded);
+
+  loaded = read_table_file(binary_name);
+  if (!compare_seek_tables(table, loaded))
+    fail("binary table does not round-trip through read_table_file\n");
+  seek_release_table(&loaded);
+
+  loaded = seek_map_table_file(text_name);
+  if (!compare_seek_tables(table, loaded))
+    fail("seek_map_table_file does not fall back to the text format\n");
+  seek_release_table(&loaded);
+
+  loaded = seek_map_table_file(binary_name);
+  if (!compare_seek_tables(table, loaded))
+    fail("mapped binary table does not match\n");
+
+  /* appending to a mapped table moves it to the heap */
+  seek_entry_type entry = loaded.array[loaded.num_entries - 1];
+  entry.display_index += 100;
+  if (seek_no_error != seek_append_table_entry(&loaded, entry) || loaded.mapped_base != NULL ||
+      loaded.num_entries != table.num_entries + 1)
+    fail("append to mapped table\n");
+  seek_release_table(&loaded);
+
+  /* flip a record byte, the checksum must catch it */
+  file = fopen(binary_name, "r+b");
+  fseek(file, 100, SEEK_SET);
+  int byte = fgetc(file);
+  fseek(file, 100, SEEK_SET);
+  fputc(0x5a ^ byte, file);
+  fclose(file);
+
+  loaded = seek_map_table_file(binary_name);
+  if (loaded.array != NULL)
+    fail("corrupt binary table was accepted\n");
+
+  loaded = read_table_file(binary_name);
+  if (loaded.array != NULL)
+    fail("corrupt binary table was accepted by read_table_file\n");
+
+  remove(text_name);
+  remove(binary_name);
+  remove(packed_name);
+  seek_release_table(&table);
+
+  success();
+}
@@ -0,0 +1,138 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_FRAMES       400
+
+/* Plays the start of a video backwards with fas_step_backward (with and without read-ahead)
+   and checks every frame against a forward decode. Once the first GOP is decoded, the
+   background prefetch should make nearly every step a frame cache hit. */
+
+int same_frame(fas_raw_image_type a, fas_raw_image_type b)
+{
+  if (a.width != b.width || a.height != b.height || a.bytes_per_line != b.bytes_per_line)
+    return 0;
+
+  return !memcmp(a.data, b.data, a.bytes_per_line * a.height);
+}
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type context;
+  fas_open_options_type options = fas_default_open_options();
+  fas_frame_cache_stats_type stats;
+  fas_raw_image_type frames[N_FRAMES];
+  fas_raw_image_type image;
+  int n_frames = 0;
+  int pass, i;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  if (FAS_SUCCESS != fas_open_video(&context, argv[1]))
+    fail("fail on open (reference)\n");
+
+  while (n_frames < N_FRAMES && fas_frame_available(context))
+    {
+      if (FAS_SUCCESS != fas_get_frame(context, &frames[n_frames]))
+	fail("fail on get_frame (reference)\n");
+      n_frames++;
+
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step (reference)\n");
+    }
+  fas_close_video(context);
+
+  for (pass = 0; pass < 2; pass++)
+    {
+      options.read_ahead = pass ? 8 : 0;
+      if (FAS_SUCCESS != fas_open_video_with_options(&context, argv[1], options))
+	fail("fail on open\n");
+
+      /* builds the seek table up to the last frame */
+      while (fas_get_frame_index(context) < n_frames - 1)
+	if (FAS_SUCCESS != fas_step_forward(context))
+	  fail("fail on step\n");
+
+      clock_t start = clock();
+      for (i = n_frames - 2; i >= 0; i--)
+	{
+	  if (FAS_SUCCESS != fas_step_backward(context))
+	    fail("fail on step_backward\n");
+
+	  if (fas_get_frame_index(context) != i)
+	    fail("step_backward landed on the wrong index\n");
+
+	  if (FAS_SUCCESS != fas_get_frame(context, &image))
+	    fail("fail on get_frame\n");
+	  if (!same_frame(frames[i], image))
+	    fail("frame differs from forward decode\n");
+	  fas_free_frame(image);
+	}
+      double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+      if (fas_step_backward(context) != FAS_NO_MORE_FRAMES)
+	fail("step_backward past the first frame\n");
+
+      fas_get_frame_cache_stats(context, &stats);
+      fprintf(stderr, "(%s: %.2fs, %lld hits %lld misses) ", pass ? "read-ahead" : "plain", elapsed, stats.hits, stats.misses);
+      if (stats.hits < (n_frames - 1) / 2)
+	fail("too few cache hits stepping backward\n");
+
+      /* and forward again from the start */
+      for (i = 1; i < n_frames; i++)
+	{
+	  if (FAS_SUCCESS != fas_step_forward(context))
+	    fail("fail on step\n");
+	  if (FAS_SUCCESS != fas_get_frame(context, &image))
+	    fail("fail on get_frame\n");
+	  if (fas_get_frame_index(context) != i || !same_frame(frames[i], image))
+	    fail("forward step after reverse play is off\n");
+	  fas_free_frame(image);
+	}
+
+      /* past the GOPs stepping backward left in the cache, the default (no) frame cache is back */
+      int buffered = stats.num_frames;
+      fas_get_frame_cache_stats(context, &stats);
+      if (n_frames > buffered && stats.num_frames != 0)
+	fail("stepping backward left the frame cache raised\n");
+
+      fas_close_video(context);
+    }
+
+  for (i=0;i<n_frames;i++)
+    fas_free_frame(frames[i]);
+
+  success();
+}
@@ -0,0 +1,218 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ *
+ * This file is part of the Frame Accurate Seeking extension library to
+ * ffmpeg (ffmpeg-fas).
+ *
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "test_support.h"
+#include "frame_checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define N_THREADS      8
+#define N_ROUNDS       20
+#define N_FRAMES       100
+#define N_SEEKS        10
+#define N_TOGGLES      200
+#define CACHE_DIR      "thread_stress_test.dir"
+
+/* Threads open, step, seek and close their own contexts of one video at the same time, half of
+   them in GRAY8 and half in RGB24 (per-context formats), each checking every frame it sees
+   against checksums taken up front. Every thread calls fas_initialize too, and the main thread
+   turns the seek table cache on and off meanwhile. Meant to be run under ThreadSanitizer as
+   well (build the library and this test with -fsanitize=thread). */
+
+typedef struct
+{
+  char                *file_path;
+  int                  id;
+  fas_color_space_type format;
+  unsigned long       *checksums;   /* of this format */
+  int                  n_frames;
+  char                *failure;     /* NULL if all went well */
+} worker_type;
+
+int take_checksums(char *file_path, fas_color_space_type format, unsigned long *checksums)
+{
+  fas_context_ref_type context;
+  fas_open_options_type options = fas_default_open_options();
+  fas_raw_image_type image;
+  int n_frames = 0;
+
+  options.format = format;
+  if (FAS_SUCCESS != fas_open_video_with_options(&context, file_path, options))
+    fail("fail on open (reference)\n");
+
+  while (n_frames < N_FRAMES && fas_frame_available(context))
+    {
+      if (FAS_SUCCESS != fas_get_frame(context, &image))
+	fail("fail on get_frame (reference)\n");
+      checksums[n_frames++] = image_checksum(&image);
+      fas_free_frame(image);
+
+      if (FAS_SUCCESS != fas_step_forward(context))
+	fail("fail on step (reference)\n");
+    }
+
+  fas_close_video(context);
+  return n_frames;
+}
+
+char *check_frame(fas_context_ref_type context, worker_type *worker)
+{
+  fas_raw_image_type image;
+  int index = fas_get_frame_index(context);
+
+  if (index < 0 || index >= worker->n_frames)
+    return "index outside the reference frames";
+
+  if (FAS_SUCCESS != fas_get_frame(context, &image))
+    return "fail on get_frame";
+
+  if (image.color_space != worker->format)
+    {
+      fas_free_frame(image);
+      return "frame is not in the context's format";
+    }
+
+  if (image_checksum(&image) != worker->checksums[index])
+    {
+      fas_free_frame(image);
+      return "frame differs from the reference";
+    }
+
+  fas_free_frame(image);
+  return NULL;
+}
+
+char *run_round(worker_type *worker, unsigned int *seed, int round)
+{
+  fas_context_ref_type context;
+  fas_open_options_type options = fas_default_open_options();
+  char *failure = NULL;
+  int i, steps;
+
+  options.format     = worker->format;
+  options.logging    = FAS_FALSE;
+  options.read_ahead = ((worker->id + round) % 3 == 0) ? 4 : 0;
+
+  if (FAS_SUCCESS != fas_open_video_with_options(&context, worker->file_path, options))
+    return "fail on open";
+
+  if (fas_get_output_format(context) != worker->format)
+    failure = "context did not take the format option";
+
+  steps = rand_r(seed) % 10;
+  for (i=0;i<steps && NULL == failure;i++)
+    {
+      failure = check_frame(context, worker);
+      if (NULL == failure && FAS_SUCCESS != fas_step_forward(context))
+	failure = "fail on step";
+    }
+
+  for (i=0;i<N_SEEKS && NULL == failure;i++)
+    {
+      int target = rand_r(seed) % worker->n_frames;
+
+      if (FAS_SUCCESS != fas_seek_to_frame(context, target))
+	failure = "fail on seek";
+      else if (fas_get_frame_index(context) != target)
+	failure = "seek landed on the wrong index";
+      else
+	failure = check_frame(context, worker);
+    }
+
+  if (FAS_SUCCESS != fas_close_video(context) && NULL == failure)
+    failure = "fail on close";
+
+  return failure;
+}
+
+void *run_worker(void *worker_ptr)
+{
+  worker_type *worker = (worker_type *) worker_ptr;
+  unsigned int seed = 12345 + worker->id;
+  int round;
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  for (round=0;round<N_ROUNDS && NULL == worker->failure;round++)
+    worker->failure = run_round(worker, &seed, round);
+
+  return NULL;
+}
+
+int main (int argc, char **argv)
+{
+  pthread_t threads[N_THREADS];
+  worker_type workers[N_THREADS];
+  unsigned long gray_checksums[N_FRAMES], rgb_checksums[N_FRAMES];
+  int n_gray, n_rgb;
+  int i;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  n_gray = take_checksums(argv[1], FAS_GRAY8, gray_checksums);
+  n_rgb  = take_checksums(argv[1], FAS_RGB24, rgb_checksums);
+  if (n_gray != n_rgb || n_gray == 0)
+    fail("reference frame counts differ\n");
+
+  for (i=0;i<N_THREADS;i++)
+    {
+      workers[i].file_path = argv[1];
+      workers[i].id        = i;
+      workers[i].format    = (i % 2) ? FAS_GRAY8 : FAS_RGB24;
+      workers[i].checksums = (i % 2) ? gray_checksums : rgb_checksums;
+      workers[i].n_frames  = n_gray;
+      workers[i].failure   = NULL;
+
+      if (pthread_create(&threads[i], NULL, run_worker, &workers[i]))
+	fail("unable to start thread\n");
+    }
+
+  /* contexts copy the cache settings at open, so changing them under open videos is safe */
+  for (i=0;i<N_TOGGLES;i++)
+    {
+      fas_set_seek_table_cache((i % 2) ? NULL : CACHE_DIR, (i % 4) ? 0 : 1024 * 1024);
+      usleep(1000);
+    }
+  fas_set_seek_table_cache(NULL, 0);
+
+  for (i=0;i<N_THREADS;i++)
+    pthread_join(threads[i], NULL);
+
+  for (i=0;i<N_THREADS;i++)
+    if (workers[i].failure)
+      {
+	fprintf(stderr, "(thread %d) %s ", i, workers[i].failure);
+	fail("\n");
+      }
+
+  success();
+}
@@ -0,0 +1,118 @@
+/*****************************************************************************
+ * Copyright 2008. Pittsburgh Pattern Recognition, Inc.
+ * 
+ * This file is part of the Frame Accurate Seeking extension library to 
+ * ffmpeg (ffmpeg-fas).
+ * 
+ * ffmpeg-fas is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Lesser General Public License as published by 
+ * the Free Software Foundation; either version 3 of the License, or (at your 
+ * option) any later version.
+ *
+ * The ffmpeg-fas library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ffmpeg-fas library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include "ffmpeg_fas.h"
+#include "seek_indices.h"
+#include "test_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_THREADS      4
+#define N_FRAMES       300
+#define N_ITERATIONS   200
+
+/* Decodes the start of a video with and without frame threading: stepping must give the same
+   frames, and seeks in the threaded context (whose seek table records the pipeline delay) must
+   land on the same frames as the single-threaded reference. */
+
+int same_frame(fas_raw_image_type a, fas_raw_image_type b)
+{
+  if (a.width != b.width || a.height != b.height || a.bytes_per_line != b.bytes_per_line)
+    return 0;
+
+  return !memcmp(a.data, b.data, a.bytes_per_line * a.height);
+}
+
+int main (int argc, char **argv)
+{
+  fas_context_ref_type reference, threaded;
+  fas_open_options_type options = fas_default_open_options();
+  fas_raw_image_type frames[N_FRAMES];
+  fas_raw_image_type image;
+  int n_frames = 0;
+  int i;
+
+  if (argc < 2) {
+    fprintf (stderr, "usage: %s <video_file>\n", argv[0]);
+    fail("arguments\n");
+  }
+
+  fprintf(stderr, "%s : ", argv[1]);
+
+  fas_initialize (FAS_FALSE, FAS_RGB24);
+
+  options.thread_count = N_THREADS;
+  options.thread_type  = FAS_THREAD_FRAME | FAS_THREAD_SLICE;
+
+  if (FAS_SUCCESS != fas_open_video(&reference, argv[1]))
+    fail("fail on open (reference)\n");
+  if (FAS_SUCCESS != fas_open_video_with_options(&threaded, argv[1], options))
+    fail("fail on open (threaded)\n");
+
+  while (n_frames < N_FRAMES && fas_frame_available(reference))
+    {
+      if (!fas_frame_available(threaded))
+	fail("threaded decoder ran out of frames early\n");
+
+      if (fas_get_frame_index(reference) != fas_get_frame_index(threaded))
+	fail("frame indices differ\n");
+
+      if (FAS_SUCCESS != fas_get_frame(reference, &frames[n_frames]) ||
+	  FAS_SUCCESS != fas_get_frame(threaded, &image))
+	fail("fail on get_frame\n");
+
+      if (!same_frame(frames[n_frames], image))
+	fail("threaded frame differs while stepping\n");
+      fas_free_frame(image);
+      n_frames++;
+
+      if (FAS_SUCCESS != fas_step_forward(reference) || FAS_SUCCESS != fas_step_forward(threaded))
+	fail("fail on step\n");
+    }
+
+  srand(12345);
+  for (i=0;i<N_ITERATIONS;i++)
+    {
+      int target = rand() % n_frames;
+
+      if (FAS_SUCCESS != fas_seek_to_frame(threaded, target))
+	fail("fail on threaded seek\n");
+
+      if (fas_get_frame_index(threaded) != target)
+	fail("threaded seek landed on the wrong index\n");
+
+      if (FAS_SUCCESS != fas_get_frame(threaded, &image))
+	fail("fail on get_frame after seek\n");
+
+      if (!same_frame(frames[target], image))
+	fail("threaded seek landed on the wrong frame\n");
+      fas_free_frame(image);
+    }
+
+  for (i=0;i<n_frames;i++)
+    fas_free_frame(frames[i]);
+
+  fas_close_video(reference);
+  fas_close_video(threaded);
+
+  success();
+}